@@ -41,4 +41,16 @@ impl From<ffi::simon_error_t> for SimonError {
             _ => SimonError::Unknown,
         }
     }
+}
+
+/// Detail behind the last failed call on this thread, such as the OS error
+/// for a port that would not open
+pub fn last_error_message() -> Option<String> {
+    unsafe {
+        let info = ffi::simon_last_error();
+        if info.code == ffi::simon_error_t::SIMON_SUCCESS || info.message.is_null() {
+            return None;
+        }
+        Some(std::ffi::CStr::from_ptr(info.message).to_string_lossy().into_owned())
+    }
 }
\ No newline at end of file
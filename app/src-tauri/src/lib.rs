@@ -1,6 +1,6 @@
 mod ffi_lib;
 
-pub use ffi_lib::{SerialMonitor, KeyboardMiddleware, SimonError};
+pub use ffi_lib::{SerialMonitor, KeyboardMiddleware, SimonError, EventSubscription, SimonEvent};
 
 use tauri::Manager;
 use std::sync::{Arc, Mutex};
@@ -8,6 +8,24 @@ use std::sync::{Arc, Mutex};
 struct AppState {
     serial_monitor: Mutex<Option<Arc<Mutex<SerialMonitor>>>>,
     keyboard_middleware: Mutex<Option<Arc<Mutex<KeyboardMiddleware>>>>,
+    events: Mutex<Option<EventSubscription>>,
+}
+
+#[derive(serde::Serialize)]
+struct EventPayload {
+    sequence: u64,
+    time_ns: u64,
+    kind: i32,
+    key: i32,
+    value: i32,
+    detail: i32,
+    text: String,
+}
+
+#[derive(serde::Serialize)]
+struct EventBatch {
+    events: Vec<EventPayload>,
+    dropped: u64,
 }
 
 #[tauri::command]
@@ -170,6 +188,32 @@ fn register_keyboard_callbacks(state: tauri::State<'_, AppState>) -> Result<(),
     ).map_err(|e| format!("Failed to register callbacks: {:?}", e))
 }
 
+#[tauri::command]
+fn poll_events(state: tauri::State<'_, AppState>) -> Result<EventBatch, String> {
+    let mut events_guard = state.events.lock().map_err(|_| "Lock failed")?;
+    
+    // Subscribe on first poll; events before that are not replayed
+    if events_guard.is_none() {
+        *events_guard = Some(EventSubscription::new().map_err(|e| format!("{:?}", e))?);
+    }
+    let subscription = events_guard.as_ref().unwrap();
+    
+    let mut events = Vec::new();
+    while let Some(event) = subscription.next_event() {
+        events.push(EventPayload {
+            sequence: event.sequence,
+            time_ns: event.time_ns,
+            kind: event.kind,
+            key: event.key,
+            value: event.value,
+            detail: event.detail,
+            text: event.text,
+        });
+    }
+    
+    Ok(EventBatch { events, dropped: subscription.dropped() })
+}
+
 #[tauri::command]
 fn cleanup_keyboard_middleware(state: tauri::State<'_, AppState>) -> Result<(), String> {
     let middleware_guard = state.keyboard_middleware.lock().map_err(|_| "Lock failed")?;
@@ -188,6 +232,7 @@ pub fn run() {
     let app_state = AppState {
         serial_monitor: Mutex::new(None),
         keyboard_middleware: Mutex::new(None),
+        events: Mutex::new(None),
     };
 
     tauri::Builder::default()
@@ -214,6 +259,7 @@ pub fn run() {
             initialize_keyboard_middleware,
             register_key,
             register_keyboard_callbacks,
+            poll_events,
             cleanup_keyboard_middleware
         ])
         .run(tauri::generate_context!())
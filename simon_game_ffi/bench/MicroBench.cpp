@@ -0,0 +1,124 @@
+#include "LineFramer.hpp"
+#include "Logger.hpp"
+#include "TriggerMatcher.hpp"
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// Per-component benchmarks, so a regression in BM_GatedKeypress can be
+// pinned on the stage that caused it.
+
+namespace {
+    // Swallows console output while a logging benchmark runs
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+    };
+
+    class ConsoleSilencer {
+    public:
+        ConsoleSilencer() : previous(std::cout.rdbuf(&sink)) {}
+        ~ConsoleSilencer() { std::cout.rdbuf(previous); }
+
+    private:
+        NullBuffer sink;
+        std::streambuf* previous;
+    };
+
+    // Cost of a message below the log level, e.g. the hook's per-key debug lines
+    void BM_LoggerFiltered(benchmark::State& state) {
+        Logger::setLogLevel(Logger::LogLevel::WARNING);
+        for (auto _ : state) {
+            LOG_DEBUG("Key blocked: 83");
+        }
+    }
+    BENCHMARK(BM_LoggerFiltered);
+
+    // Cost of a message that is formatted and written to the console
+    void BM_LoggerEmitted(benchmark::State& state) {
+        Logger::setLogLevel(Logger::LogLevel::DEBUG);
+        ConsoleSilencer silencer;
+        for (auto _ : state) {
+            LOG_INFO("Hardware verification successful for key: 83");
+        }
+        Logger::setLogLevel(Logger::LogLevel::WARNING);
+    }
+    BENCHMARK(BM_LoggerEmitted);
+
+    // Board replies split into reads of range(0) bytes, as a tty delivers them
+    void BM_LineFramer(benchmark::State& state) {
+        std::string stream;
+        for (int i = 0; i < 64; i++) {
+            stream += (i % 3 == 0) ? "False\r\n" : "True\r\n";
+        }
+        size_t chunk = static_cast<size_t>(state.range(0));
+
+        LineFramer framer;
+        std::string line;
+        for (auto _ : state) {
+            for (size_t offset = 0; offset < stream.size(); offset += chunk) {
+                framer.append(stream.data() + offset, std::min(chunk, stream.size() - offset));
+                while (framer.nextLine(line)) {
+                    benchmark::DoNotOptimize(line.data());
+                }
+            }
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * stream.size()));
+        state.SetItemsProcessed(state.iterations() * 64);
+    }
+    BENCHMARK(BM_LineFramer)->Arg(1)->Arg(8)->Arg(256);
+
+    // One TriggerMatcher::advance + isFinalKey per event, as the hook does,
+    // over random typing against range(0) registered triggers
+    void BM_KeyLookup(benchmark::State& state) {
+        std::mt19937 rng(1);
+        std::uniform_int_distribution<int> letter(0x41, 0x5A);
+
+        std::vector<TriggerMatcher::Trigger> triggers;
+        for (int i = 0; i < state.range(0); i++) {
+            TriggerMatcher::Trigger trigger;
+            if (i % 2 == 0) {
+                trigger.steps.push_back({static_cast<uint16_t>(letter(rng)), TriggerMatcher::MOD_CTRL});
+            } else {
+                trigger.steps.push_back({static_cast<uint16_t>(letter(rng)), TriggerMatcher::MOD_NONE});
+                trigger.steps.push_back({static_cast<uint16_t>(letter(rng)), TriggerMatcher::MOD_NONE});
+            }
+            trigger.windowMs = 500;
+            trigger.targetCounter = 4;
+            triggers.push_back(trigger);
+        }
+        TriggerMatcher matcher(triggers);
+
+        std::vector<uint16_t> keys(4096);
+        for (uint16_t& key : keys) {
+            key = static_cast<uint16_t>(letter(rng));
+        }
+
+        TriggerMatcher::Cursor cursor;
+        uint32_t time = 0;
+        size_t next = 0;
+        for (auto _ : state) {
+            uint16_t key = keys[next++ & (keys.size() - 1)];
+            int fired = matcher.advance(cursor, key, true, time += 30);
+            benchmark::DoNotOptimize(fired);
+            benchmark::DoNotOptimize(matcher.isFinalKey(key));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+    BENCHMARK(BM_KeyLookup)->Arg(1)->Arg(16)->Arg(64);
+}
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    benchmark::AddCustomContext("simon_build", SIMON_BUILD_FLAVOR);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include "SimonSimulator.hpp"
+#include "LatencyHistogram.hpp"
+#include "Logger.hpp"
+#include "middleWhere.hpp"
+#include "simon_game.h"
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+// End-to-end latency of one gated keypress:
+//
+//   gate      ProcessKeyEvent on the hook thread
+//   dispatch  key event -> send callback running on the challenge thread
+//   write     sm_send_simon_game_length
+//   reply     length written -> sm_verify_simon_game_success returned
+//   release   verification -> buffered key replayed to the application
+//   total     key event -> key replayed
+//
+// Each stage is reported as p50/p99/p999 in microseconds. The board is a
+// pty simulator; its reply latency (ms) is the benchmark argument, so the
+// 0 ms run measures pure host overhead.
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const uint16_t TRIGGER_KEY = 0x53; // 'S'
+
+    uint64_t elapsedNs(Clock::time_point from, Clock::time_point to) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+    }
+
+    struct Stage {
+        const char* name;
+        LatencyHistogram histogram;
+    };
+
+    void reportStages(benchmark::State& state, Stage* stages, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const LatencyHistogram& histogram = stages[i].histogram;
+            std::string name = stages[i].name;
+            state.counters[name + "_p50_us"] = histogram.percentile(0.50) / 1000.0;
+            state.counters[name + "_p99_us"] = histogram.percentile(0.99) / 1000.0;
+            state.counters[name + "_p999_us"] = histogram.percentile(0.999) / 1000.0;
+        }
+    }
+
+    void BM_GatedKeypress(benchmark::State& state) {
+        SimonSimulator::Profile profile;
+        profile.latencyMs = static_cast<double>(state.range(0));
+        SimonSimulator board(profile);
+
+        serial_monitor_t monitor = sm_create(board.path().c_str());
+        if (sm_connect(monitor) != SIMON_SUCCESS) {
+            sm_destroy(monitor);
+            state.SkipWithError("could not connect to the simulated board");
+            return;
+        }
+
+        // Written by the challenge thread before `released` is set, read by
+        // the benchmark thread after it observes it
+        Clock::time_point sendStart, sendDone, replyDone, releasedAt;
+        std::atomic<bool> released(false);
+        std::atomic<bool> verified(true);
+
+        // No Initialize(): events are fed straight into ProcessKeyEvent
+        KeyboardMiddleware middleware;
+        middleware.SetKeyBuffering(true);
+        middleware.SetKeyInjector([&](const std::vector<KeyEvent>&) {
+            releasedAt = Clock::now();
+            released.store(true, std::memory_order_release);
+        });
+        middleware.RegisterHardwareCallbacks(
+            [&](int length) {
+                sendStart = Clock::now();
+                sm_send_simon_game_length(monitor, length);
+                sendDone = Clock::now();
+            },
+            [&]() {
+                bool success = sm_verify_simon_game_success(monitor, 1000) == 1;
+                replyDone = Clock::now();
+                verified = success;
+                return success;
+            });
+        middleware.RegisterKey(TRIGGER_KEY, 4);
+
+        Stage stages[] = {
+            {"gate", LatencyHistogram()},
+            {"dispatch", LatencyHistogram()},
+            {"write", LatencyHistogram()},
+            {"reply", LatencyHistogram()},
+            {"release", LatencyHistogram()},
+            {"total", LatencyHistogram()},
+        };
+
+        KeyEvent keyDown = {TRIGGER_KEY, 0x1F, 0, false, false};
+        KeyEvent keyUp = {TRIGGER_KEY, 0x1F, 0, true, false};
+
+        for (auto _ : state) {
+            released = false;
+            keyDown.time = keyUp.time = static_cast<uint32_t>(state.iterations());
+
+            Clock::time_point keyAt = Clock::now();
+            bool held = middleware.ProcessKeyEvent(keyDown);
+            Clock::time_point gated = Clock::now();
+            benchmark::DoNotOptimize(held);
+
+            while (!released.load(std::memory_order_acquire)) {
+                if (!verified) {
+                    break;
+                }
+                std::this_thread::yield();
+            }
+            if (!verified) {
+                state.SkipWithError("the simulated board rejected a challenge");
+                break;
+            }
+            middleware.ProcessKeyEvent(keyUp);
+
+            stages[0].histogram.record(elapsedNs(keyAt, gated));
+            stages[1].histogram.record(elapsedNs(keyAt, sendStart));
+            stages[2].histogram.record(elapsedNs(sendStart, sendDone));
+            stages[3].histogram.record(elapsedNs(sendDone, replyDone));
+            stages[4].histogram.record(elapsedNs(replyDone, releasedAt));
+            stages[5].histogram.record(elapsedNs(keyAt, releasedAt));
+        }
+
+        middleware.Cleanup();
+        sm_destroy(monitor);
+        reportStages(state, stages, sizeof(stages) / sizeof(stages[0]));
+    }
+}
+
+BENCHMARK(BM_GatedKeypress)->Arg(0)->Arg(2)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char** argv) {
+    // Per-challenge INFO logging would dominate the measurement
+    Logger::setLogLevel(Logger::LogLevel::WARNING);
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::AddCustomContext("simon_build", SIMON_BUILD_FLAVOR);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
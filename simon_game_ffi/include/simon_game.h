@@ -1,6 +1,9 @@
 #ifndef SIMON_GAME_H
 #define SIMON_GAME_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -8,6 +11,9 @@ extern "C" {
 // Opaque handle types
 typedef struct SerialMonitorHandle* serial_monitor_t;
 typedef struct KeyboardMiddlewareHandle* keyboard_middleware_t;
+typedef struct DevicePoolHandle* device_pool_t;
+typedef struct EventSubscriptionHandle* simon_subscription_t;
+typedef struct ScreenLockHandle* screen_lock_t;
 
 // Error codes
 typedef enum {
@@ -21,6 +27,35 @@ typedef enum {
     SIMON_ERROR_UNKNOWN = -99
 } simon_error_t;
 
+// Modifier masks for chorded triggers
+typedef enum {
+    SIMON_MOD_NONE = 0,
+    SIMON_MOD_CTRL = 1,
+    SIMON_MOD_SHIFT = 2,
+    SIMON_MOD_ALT = 4,
+    SIMON_MOD_WIN = 8,
+    SIMON_MOD_ANY = 0xFF
+} simon_modifier_t;
+
+// One step of a key sequence: a key plus the exact modifiers that must be held
+typedef struct {
+    int key_code;
+    int modifiers;
+} simon_key_step;
+
+// Detail for the last failure on the calling thread, like errno: failing
+// calls record it and successful ones leave it alone. The sm_*, dp_*, km_*
+// and lock_* functions record it. `message` includes the OS error text and
+// stays valid until the next simon_last_error call on the same thread.
+typedef struct {
+    simon_error_t code;     // SIMON_SUCCESS if nothing was recorded
+    int os_error;           // errno, or GetLastError() on Windows; 0 if none
+    const char* message;
+} simon_error_info_t;
+
+simon_error_info_t simon_last_error(void);
+void simon_clear_error(void);
+
 // SerialMonitor functions
 serial_monitor_t sm_create(const char* port_name);
 void sm_destroy(serial_monitor_t handle);
@@ -31,23 +66,288 @@ simon_error_t sm_send_simon_game_length(serial_monitor_t handle, int length);
 int sm_verify_simon_game_success(serial_monitor_t handle, int timeout_ms);
 int sm_is_connected(serial_monitor_t handle);
 
+// A line from the board, without its terminator and not NUL-terminated
+typedef struct {
+    const char* data;
+    size_t length;
+} simon_line_t;
+
+// Reads for streaming board output without a copy or allocation per line.
+// They wait for data until `deadline_ns` (simon_clock_ns clock; 0 polls)
+// and return a count, 0 if the deadline passed first, or a negative
+// simon_error_t. sm_read copies raw bytes into `buffer`. sm_read_lines
+// points `lines` into the handle's receive buffer; the views stay valid
+// until sm_release_lines or the next read of any kind on the handle,
+// including sm_verify_simon_game_success.
+int sm_read(serial_monitor_t handle, void* buffer, size_t capacity, uint64_t deadline_ns);
+int sm_read_lines(serial_monitor_t handle, simon_line_t* lines, size_t max_lines, uint64_t deadline_ns);
+simon_error_t sm_release_lines(serial_monitor_t handle);
+
+// DevicePool functions: several Simon boards serviced by one pool thread.
+// Each challenge goes to an idle healthy board; boards that stop answering
+// are dropped, their challenges failed over and the port retried.
+device_pool_t dp_create(int challenge_timeout_ms);
+void dp_destroy(device_pool_t handle);
+simon_error_t dp_add_device(device_pool_t handle, const char* port_name);
+simon_error_t dp_start(device_pool_t handle);
+simon_error_t dp_stop(device_pool_t handle);
+// Blocks until a board reports the result: 1 = success, 0 = failure/timeout.
+// Always 0 in reactor mode; use dp_submit_challenge there.
+int dp_run_challenge(device_pool_t handle, int length);
+int dp_healthy_count(device_pool_t handle);
+
+// Queues a challenge; `callback` runs on the pool thread (in reactor mode,
+// inside simon_process_events) with success = 1 or 0
+typedef void (*simon_challenge_callback_t)(void* user_data, int success);
+simon_error_t dp_submit_challenge(device_pool_t handle, int length, simon_challenge_callback_t callback, void* user_data);
+
 // KeyboardMiddleware functions
 keyboard_middleware_t km_create();
 void km_destroy(keyboard_middleware_t handle);
 simon_error_t km_initialize(keyboard_middleware_t handle);
 simon_error_t km_register_key(keyboard_middleware_t handle, int key_code, int target_count);
+simon_error_t km_register_chord(keyboard_middleware_t handle, int key_code, int modifiers, int target_count);
+// Up to 8 steps; window_ms bounds the time from first to last step (0 = no limit)
+simon_error_t km_register_sequence(
+    keyboard_middleware_t handle,
+    const simon_key_step* steps,
+    int step_count,
+    int window_ms,
+    int target_count
+);
+
+// A plain key (modifiers = SIMON_MOD_ANY) or a single-step chord
+typedef struct {
+    int key_code;
+    int modifiers;
+    int target_count;
+} simon_key_config;
+
+typedef struct {
+    const simon_key_step* steps;
+    int step_count;
+    int window_ms;
+    int target_count;
+} simon_sequence_config;
+
+// Every trigger and scope of an instance; see km_apply_config
+typedef struct {
+    const simon_key_config* keys;
+    size_t key_count;
+    const simon_sequence_config* sequences;
+    size_t sequence_count;
+    const char* const* processes;           // as km_add_process_scope
+    size_t process_count;
+    const char* const* window_classes;      // as km_add_window_class_scope
+    size_t window_class_count;
+} simon_config;
+
+// Adds `count` keys with one rebuild of the trigger matcher. Nothing is
+// added if any entry is invalid.
+simon_error_t km_register_keys(keyboard_middleware_t handle, const simon_key_config* keys, size_t count);
+// Replaces all registered triggers and scopes. The new trigger set is built
+// completely and then published in one swap, so key events see either the
+// old configuration or the new one; an invalid config changes nothing.
+simon_error_t km_apply_config(keyboard_middleware_t handle, const simon_config* config);
+
 simon_error_t km_cleanup(keyboard_middleware_t handle);
 
+// Only gate keys while the foreground window belongs to one of these
+// executables (e.g. "explorer.exe") or window classes. No scopes = gate everywhere.
+simon_error_t km_add_process_scope(keyboard_middleware_t handle, const char* exe_name);
+simon_error_t km_add_window_class_scope(keyboard_middleware_t handle, const char* window_class);
+simon_error_t km_clear_scopes(keyboard_middleware_t handle);
+
+// Hold keystrokes typed while a challenge is pending (up to `capacity` events)
+// and replay them in order on success; they are dropped on failure. Fails
+// with SIMON_ERROR_HOOK_FAILED, leaving buffering off, where keys cannot be
+// replayed (currently anywhere but Windows).
+simon_error_t km_set_key_buffering(keyboard_middleware_t handle, int enabled, int capacity);
+
+// After a passed challenge, let the same trigger (per_key) or any trigger
+// through without the device for ttl_ms (0 = off). Cached passes are dropped
+// after idle_ms without keyboard input (0 = never), after a failure and on
+// km_invalidate_verification, e.g. when the session locks. Hits and misses
+// are exported as simon_verification_cache_total.
+simon_error_t km_set_verification_cache(keyboard_middleware_t handle, int ttl_ms, int per_key, int idle_ms);
+simon_error_t km_invalidate_verification(keyboard_middleware_t handle);
+
+// Adapt challenge lengths to the last `window` challenges (0 = off): a step
+// longer while under 60% pass, a step shorter while at least 90% pass at no
+// more than 1.5 s per step, always within [min_length, max_length]. The
+// registered target count is the starting length for each key.
+simon_error_t km_set_adaptive_length(keyboard_middleware_t handle, int min_length, int max_length, int window);
+
+// Start the device round before the trigger when one looks imminent (a
+// chord's modifiers held, a sequence one key from done, focus entering a
+// gated scope). A finished round waits up to ttl_ms for its trigger; 0 = off.
+simon_error_t km_set_speculation(keyboard_middleware_t handle, int ttl_ms);
+
+// Escalating lockouts: once one trigger key fails key_threshold times, or
+// the instance fails device_threshold times, within window_ms, input is
+// locked as by lock_begin for the counter's next step of steps_ms (NULL =
+// 1 s, 5 s, 30 s, 5 min, 30 min). Each decay_ms without a failure steps
+// back down; 0 = never. A threshold of 0 disables that counter; at least
+// one must be set. Passed challenges do not end these locks, and a failed
+// trigger can be tried again instead of staying blocked.
+typedef struct {
+    int key_threshold;
+    int device_threshold;
+    int window_ms;
+    int decay_ms;
+    const int* steps_ms;
+    size_t step_count;
+} simon_lockout_policy;
+
+// NULL `policy` turns lockouts off. With a `state_path` (may be NULL) the
+// counts are saved after each failure and reloaded here, resuming a
+// lockout that was running when the process exited.
+simon_error_t km_set_lockout(keyboard_middleware_t handle, const simon_lockout_policy* policy, const char* state_path);
+
 // Callback type definitions
 typedef void (*simon_send_callback_t)(int counter);
 typedef int (*simon_receive_callback_t)(void);
 
-// Register callbacks
+// Callbacks that also receive the user_data pointer given at registration,
+// so each middleware instance can drive its own device
+typedef void (*simon_send_callback_ex_t)(void* user_data, int counter);
+typedef int (*simon_receive_callback_ex_t)(void* user_data);
+
+// Register callbacks (per handle; each handle is an independent instance).
+// In reactor mode they run inside simon_process_events, so a blocking
+// receive callback blocks the caller's loop; prefer km_use_device_pool.
 simon_error_t km_register_callbacks(
     keyboard_middleware_t handle,
     simon_send_callback_t send_callback,
     simon_receive_callback_t receive_callback
 );
+simon_error_t km_register_callbacks_ex(
+    keyboard_middleware_t handle,
+    simon_send_callback_ex_t send_callback,
+    simon_receive_callback_ex_t receive_callback,
+    void* user_data
+);
+
+// Run this instance's challenges on a device pool instead of callbacks.
+// The pool must outlive the binding (until km_cleanup or km_destroy).
+simon_error_t km_use_device_pool(keyboard_middleware_t handle, device_pool_t pool);
+
+// Screen lock: keyboard and mouse input is withheld from every application
+// for `seconds` (1 to 3600) without blocking the caller. Uses BlockInput on
+// Windows, which needs administrator rights, and an exclusive grab of the
+// /dev/input keyboards and pointers on Linux. With `release_on_success`
+// set, a challenge passed on that instance ends the lock early. Returns
+// NULL if input could not be locked; see simon_last_error. In reactor mode
+// the lock is released by a reactor timer instead of a thread of its own.
+screen_lock_t lock_begin(int seconds, keyboard_middleware_t release_on_success);
+// Releases input now; from any thread, and harmless once already released
+simon_error_t lock_end(screen_lock_t handle);
+// Waits until input is released or `deadline_ns` (simon_clock_ns clock;
+// UINT64_MAX waits indefinitely) and returns 1 if released, 0 if still
+// locked, or a negative simon_error_t. In reactor mode the lock is only
+// released inside simon_process_events, so wait from another thread or
+// pass a past deadline to poll.
+int lock_wait_until(screen_lock_t handle, uint64_t deadline_ns);
+// Releases input if still locked and frees the handle
+void lock_destroy(screen_lock_t handle);
+
+// Metrics (challenges, serial I/O, device pools, logging) in the Prometheus
+// text format. Writes at most `size` bytes including the terminating NUL and
+// returns the full length, so a call with a NULL buffer sizes it.
+size_t simon_metrics_dump(char* buffer, size_t size);
+// Serves the same text over HTTP on "host:port" (e.g. "127.0.0.1:9464") or
+// "unix:/path/to/socket". One endpoint per process; not available on Windows.
+simon_error_t simon_metrics_serve(const char* address);
+simon_error_t simon_metrics_stop_serving(void);
+
+// Tracing of the challenge lifecycle (hook, queue wait, serial write, device
+// wait, parse, callbacks) as Chrome trace JSON, viewable in chrome://tracing
+// or ui.perfetto.dev. Off by default; each thread keeps its most recent spans.
+simon_error_t simon_trace_enable(int enabled);
+simon_error_t simon_trace_clear(void);
+// Same contract as simon_metrics_dump
+size_t simon_trace_dump(char* buffer, size_t size);
+simon_error_t simon_trace_save(const char* path);
+
+// Event channel: challenge events, device state and headline counters in one
+// shared-memory region (memfd on Linux), written without locks. Each
+// subscription reads the ring at its own pace from the moment it subscribes;
+// events it falls a whole ring behind on are counted as dropped.
+typedef enum {
+    SIMON_EVENT_CHALLENGE_STARTED = 1,      // key, value = length, detail = 1 if speculative
+    SIMON_EVENT_CHALLENGE_FINISHED = 2,     // key, value = 1 pass / 0 fail, detail = duration in ms
+    SIMON_EVENT_DEVICE_CONNECTED = 3,       // text = port
+    SIMON_EVENT_DEVICE_DISCONNECTED = 4     // text = port
+} simon_event_type_t;
+
+typedef struct {
+    uint64_t sequence;
+    uint64_t time_ns;       // steady clock
+    int32_t type;           // simon_event_type_t
+    int32_t key;
+    int32_t value;
+    int32_t detail;
+    char text[32];
+} simon_event_t;
+
+// Counters kept since the channel was opened, plus current values
+typedef struct {
+    int64_t challenges_succeeded;
+    int64_t challenges_failed;
+    int64_t challenges_in_flight;
+    int64_t devices_connected;
+    int64_t last_challenge_length;
+} simon_status_t;
+
+// Opens the channel on first use
+simon_subscription_t simon_events_subscribe(void);
+void simon_events_unsubscribe(simon_subscription_t handle);
+// Returns 1 and fills `event` if one is waiting, 0 otherwise
+int simon_events_next(simon_subscription_t handle, simon_event_t* event);
+// Returns 1 once an event is waiting, 0 on timeout
+int simon_events_wait(simon_subscription_t handle, int timeout_ms);
+uint64_t simon_events_dropped(simon_subscription_t handle);
+simon_error_t simon_events_status(simon_status_t* status);
+// The raw region (layout in EventChannel.hpp) and, on Linux, its memfd for
+// mapping it into another process. NULL / -1 until the channel is open.
+const void* simon_events_region(size_t* size);
+int simon_events_fd(void);
+
+// Reactor mode: the library starts no threads of its own and does all its
+// work inside simon_process_events, on the caller's thread. Enable it before
+// creating any device pool, middleware, screen lock or metrics endpoint;
+// those must then be created, used and destroyed on the thread calling
+// simon_process_events.
+// It cannot be turned off again. The Windows keyboard hook still runs on a
+// thread of its own, since it is only called while that thread pumps
+// messages.
+simon_error_t simon_reactor_enable(void);
+
+// Descriptor to wait on; events is POLLIN
+typedef struct {
+    int fd;
+    short events;
+} simon_pollfd_t;
+
+// Fills up to `max` descriptors and returns how many there are, so a call
+// with max = 0 sizes the array. The set changes as boards come and go, so
+// fetch it again after each simon_process_events. Always 0 on Windows;
+// see simon_get_wake_handle there.
+int simon_get_poll_fds(simon_pollfd_t* fds, int max);
+// Windows only, NULL elsewhere or before simon_reactor_enable: an event
+// HANDLE signalled when work is queued, e.g. a challenge from the keyboard
+// hook thread. Wait on it with simon_next_timeout_ms as the timeout.
+void* simon_get_wake_handle(void);
+// Milliseconds until a timer is due (0 if work is already pending), or -1
+// if nothing happens until a descriptor becomes readable (on Windows, until
+// the wake handle is signalled)
+int simon_next_timeout_ms(void);
+// Steady clock in nanoseconds, the clock of simon_process_events deadlines
+uint64_t simon_clock_ns(void);
+// Dispatches ready descriptors, due timers and queued work, waiting for
+// them no later than `deadline_ns`. 0 (or any past deadline) never blocks,
+// as is usual when the caller has already polled the descriptors.
+simon_error_t simon_process_events(uint64_t deadline_ns);
 
 #ifdef __cplusplus
 }
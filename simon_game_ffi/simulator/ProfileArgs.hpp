@@ -0,0 +1,73 @@
+#pragma once
+#include "SimonSimulator.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Command-line options shared by simon_simulator and simon_stress
+namespace ProfileArgs {
+    inline const char* usage() {
+        return
+            "  --success-rate R      fraction of challenges answered True (default 1)\n"
+            "  --latency MS          base reply latency in ms (default 0)\n"
+            "  --model NAME          fixed | uniform | normal | exponential (default fixed)\n"
+            "  --spread MS           uniform width / normal stddev in ms\n"
+            "  --per-step MS         extra latency per challenge step\n"
+            "  --jitter MS           uniform +/- jitter on top of the model\n"
+            "  --silence-rate R      fraction of challenges never answered\n"
+            "  --disconnect-rate R   chance per challenge of hanging up instead\n"
+            "  --disconnect-after N  hang up on challenge N + 1\n"
+            "  --seed N              random seed (default random)\n";
+    }
+
+    // Consumes argv[i] (and its value) if it is a profile option. Exits on a
+    // malformed value.
+    inline bool parse(int argc, char** argv, int& i, SimonSimulator::Profile& profile) {
+        std::string option = argv[i];
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "missing value for " << option << std::endl;
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (option == "--success-rate") {
+            profile.successRate = std::atof(value());
+        } else if (option == "--latency") {
+            profile.latencyMs = std::atof(value());
+        } else if (option == "--model") {
+            std::string model = value();
+            if (model == "fixed") {
+                profile.latencyModel = SimonSimulator::LatencyModel::FIXED;
+            } else if (model == "uniform") {
+                profile.latencyModel = SimonSimulator::LatencyModel::UNIFORM;
+            } else if (model == "normal") {
+                profile.latencyModel = SimonSimulator::LatencyModel::NORMAL;
+            } else if (model == "exponential") {
+                profile.latencyModel = SimonSimulator::LatencyModel::EXPONENTIAL;
+            } else {
+                std::cerr << "unknown latency model: " << model << std::endl;
+                std::exit(2);
+            }
+        } else if (option == "--spread") {
+            profile.latencySpreadMs = std::atof(value());
+        } else if (option == "--per-step") {
+            profile.perStepMs = std::atof(value());
+        } else if (option == "--jitter") {
+            profile.jitterMs = std::atof(value());
+        } else if (option == "--silence-rate") {
+            profile.silenceRate = std::atof(value());
+        } else if (option == "--disconnect-rate") {
+            profile.disconnectRate = std::atof(value());
+        } else if (option == "--disconnect-after") {
+            profile.disconnectAfter = std::strtoull(value(), nullptr, 10);
+        } else if (option == "--seed") {
+            profile.seed = static_cast<uint32_t>(std::strtoul(value(), nullptr, 10));
+        } else {
+            return false;
+        }
+        return true;
+    }
+}
\ No newline at end of file
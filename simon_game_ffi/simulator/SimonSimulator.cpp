@@ -0,0 +1,247 @@
+#include "SimonSimulator.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <deque>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Upper bound on a poll so hangUp()/the destructor are noticed promptly
+    const std::chrono::milliseconds MAX_POLL_WAIT(20);
+
+    timespec toTimespec(Clock::duration duration) {
+        if (duration < Clock::duration::zero()) {
+            duration = Clock::duration::zero();
+        }
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(duration);
+        auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration - seconds);
+        timespec result;
+        result.tv_sec = static_cast<time_t>(seconds.count());
+        result.tv_nsec = static_cast<long>(nanoseconds.count());
+        return result;
+    }
+}
+
+SimonSimulator::SimonSimulator(const Profile& simulatorProfile)
+    : profile(simulatorProfile), rng(simulatorProfile.seed != 0 ? simulatorProfile.seed : std::random_device()()) {
+    script = [this](int length) { return profileReply(length); };
+    start();
+}
+
+SimonSimulator::SimonSimulator(Script replyScript) : script(std::move(replyScript)), rng(1) {
+    start();
+}
+
+SimonSimulator::~SimonSimulator() {
+    running = false;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    hangUp();
+    close(slave);
+}
+
+SimonSimulator::Reply SimonSimulator::answer(bool success, int delayMs) {
+    return Reply{ Reply::ANSWER, success, std::chrono::milliseconds(delayMs) };
+}
+
+SimonSimulator::Reply SimonSimulator::silent() {
+    return Reply{ Reply::SILENT, false, std::chrono::microseconds(0) };
+}
+
+SimonSimulator::Reply SimonSimulator::hangUpReply(int delayMs) {
+    return Reply{ Reply::HANG_UP, false, std::chrono::milliseconds(delayMs) };
+}
+
+void SimonSimulator::start() {
+    running = true;
+    challengeCount = 0;
+    successCount = 0;
+    failureCount = 0;
+    silenceCount = 0;
+    hungUp = false;
+
+    char name[128] = {0};
+    if (openpty(&master, &slave, name, nullptr, nullptr) != 0) {
+        throw std::runtime_error("openpty failed");
+    }
+    portPath = name;
+
+    // Raw until the host configures the port, so nothing is echoed back.
+    // The slave end stays open here so the master never sees EIO while the
+    // host reconnects.
+    termios tty = {};
+    tcgetattr(slave, &tty);
+    cfmakeraw(&tty);
+    tcsetattr(slave, TCSANOW, &tty);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    worker = std::thread(&SimonSimulator::serve, this);
+}
+
+void SimonSimulator::hangUp() {
+    std::lock_guard<std::mutex> lock(masterMutex);
+    if (master >= 0) {
+        close(master);
+        master = -1;
+        hungUp = true;
+    }
+}
+
+std::vector<int> SimonSimulator::received() {
+    std::lock_guard<std::mutex> lock(receivedMutex);
+    return lengths;
+}
+
+SimonSimulator::Stats SimonSimulator::stats() const {
+    return Stats{ challengeCount.load(), successCount.load(), failureCount.load(), silenceCount.load(), hungUp.load() };
+}
+
+SimonSimulator::Reply SimonSimulator::profileReply(int length) {
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    if (profile.disconnectAfter != 0 && challengeCount > profile.disconnectAfter) {
+        return hangUpReply();
+    }
+    if (profile.disconnectRate > 0 && unit(rng) < profile.disconnectRate) {
+        return hangUpReply();
+    }
+    if (profile.silenceRate > 0 && unit(rng) < profile.silenceRate) {
+        return silent();
+    }
+
+    double latencyMs = profile.latencyMs;
+    switch (profile.latencyModel) {
+        case LatencyModel::FIXED:
+            break;
+        case LatencyModel::UNIFORM:
+            latencyMs += unit(rng) * profile.latencySpreadMs;
+            break;
+        case LatencyModel::NORMAL:
+            latencyMs = std::normal_distribution<double>(profile.latencyMs, profile.latencySpreadMs)(rng);
+            break;
+        case LatencyModel::EXPONENTIAL:
+            if (profile.latencyMs > 0) {
+                latencyMs = std::exponential_distribution<double>(1.0 / profile.latencyMs)(rng);
+            }
+            break;
+    }
+    latencyMs += profile.perStepMs * length;
+    if (profile.jitterMs > 0) {
+        latencyMs += (unit(rng) * 2.0 - 1.0) * profile.jitterMs;
+    }
+    latencyMs = std::max(latencyMs, 0.0);
+
+    bool success = unit(rng) < profile.successRate;
+    return Reply{ Reply::ANSWER, success, std::chrono::microseconds(static_cast<int64_t>(latencyMs * 1000.0)) };
+}
+
+bool SimonSimulator::send(const std::string& text) {
+    std::lock_guard<std::mutex> lock(masterMutex);
+    if (master < 0) {
+        return false;
+    }
+
+    size_t written = 0;
+    while (written < text.size()) {
+        ssize_t n = write(master, text.data() + written, text.size() - written);
+        if (n > 0) {
+            written += static_cast<size_t>(n);
+        } else if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            pollfd pfd = { master, POLLOUT, 0 };
+            poll(&pfd, 1, 10);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SimonSimulator::serve() {
+    struct Pending {
+        Clock::time_point due;
+        Reply reply;
+    };
+
+    std::deque<Pending> pending;
+    Clock::time_point busyUntil = Clock::now();
+    std::string line;
+
+    while (running) {
+        int fd;
+        {
+            std::lock_guard<std::mutex> lock(masterMutex);
+            fd = master;
+        }
+        if (fd < 0) {
+            return;
+        }
+
+        Clock::time_point now = Clock::now();
+        Clock::duration wait = MAX_POLL_WAIT;
+        if (!pending.empty()) {
+            wait = std::min<Clock::duration>(wait, pending.front().due - now);
+        }
+        timespec timeout = toTimespec(wait);
+
+        pollfd pfd = { fd, POLLIN, 0 };
+        if (ppoll(&pfd, 1, &timeout, nullptr) > 0 && (pfd.revents & POLLIN)) {
+            char buffer[256];
+            ssize_t n = read(fd, buffer, sizeof(buffer));
+            for (ssize_t i = 0; i < n; i++) {
+                if (buffer[i] == '\r') {
+                    continue;
+                }
+                if (buffer[i] != '\n') {
+                    line += buffer[i];
+                    continue;
+                }
+
+                // int(input()) on the board would raise here; skip the line instead
+                int length = 0;
+                try {
+                    length = std::stoi(line);
+                } catch (const std::exception&) {
+                    line.clear();
+                    continue;
+                }
+                line.clear();
+
+                challengeCount++;
+                {
+                    std::lock_guard<std::mutex> lock(receivedMutex);
+                    lengths.push_back(length);
+                }
+
+                Reply reply = script(length);
+                Clock::time_point begin = std::max(Clock::now(), busyUntil);
+                busyUntil = begin + reply.delay;
+                pending.push_back(Pending{ busyUntil, reply });
+            }
+        }
+
+        now = Clock::now();
+        while (!pending.empty() && pending.front().due <= now) {
+            Reply reply = pending.front().reply;
+            pending.pop_front();
+
+            if (reply.kind == Reply::HANG_UP) {
+                hangUp();
+                return;
+            }
+            if (reply.kind == Reply::SILENT) {
+                silenceCount++;
+                continue;
+            }
+
+            (reply.success ? successCount : failureCount)++;
+            send(reply.success ? "True\r\n" : "False\r\n");
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A Simon board simulated on a pseudo-terminal, speaking the same protocol
+// as 2fa-device-firmware/main.py: it reads a challenge length per line and
+// answers "True" or "False". Open path() like a serial port.
+//
+// Challenges are played one at a time like on the board, so lines sent
+// while one is in progress queue behind it.
+class SimonSimulator {
+public:
+    enum class LatencyModel {
+        FIXED,          // latencyMs
+        UNIFORM,        // latencyMs .. latencyMs + latencySpreadMs
+        NORMAL,         // mean latencyMs, stddev latencySpreadMs
+        EXPONENTIAL     // mean latencyMs
+    };
+
+    struct Profile {
+        double successRate = 1.0;
+        LatencyModel latencyModel = LatencyModel::FIXED;
+        double latencyMs = 0.0;
+        double latencySpreadMs = 0.0;
+        double perStepMs = 0.0;         // added per step, like a player repeating the pattern
+        double jitterMs = 0.0;          // uniform +/- on top of the latency model
+        double silenceRate = 0.0;       // probability of never answering a challenge
+        double disconnectRate = 0.0;    // probability of hanging up instead of answering
+        uint64_t disconnectAfter = 0;   // hang up on challenge N + 1 (0 = never)
+        uint32_t seed = 0;              // 0 = random
+    };
+
+    struct Reply {
+        enum Kind { ANSWER, SILENT, HANG_UP } kind;
+        bool success;
+        std::chrono::microseconds delay;
+    };
+    using Script = std::function<Reply(int length)>;
+
+    struct Stats {
+        uint64_t challenges;
+        uint64_t successes;
+        uint64_t failures;
+        uint64_t silences;
+        bool hungUp;
+    };
+
+    explicit SimonSimulator(const Profile& profile);
+    // For deterministic tests: `script` decides every reply
+    explicit SimonSimulator(Script script);
+    ~SimonSimulator();
+
+    SimonSimulator(const SimonSimulator&) = delete;
+    SimonSimulator& operator=(const SimonSimulator&) = delete;
+
+    // Reply helpers for scripts
+    static Reply answer(bool success, int delayMs = 0);
+    static Reply silent();
+    static Reply hangUpReply(int delayMs = 0);
+
+    const std::string& path() const { return portPath; }
+
+    // Closes the terminal, as if the board were unplugged
+    void hangUp();
+
+    // Challenge lengths received so far, oldest first
+    std::vector<int> received();
+    Stats stats() const;
+
+private:
+    void start();
+    void serve();
+    Reply profileReply(int length);
+    bool send(const std::string& text);
+
+    Profile profile;
+    Script script;
+    std::mt19937 rng;
+
+    int master;
+    int slave;
+    std::string portPath;
+    std::mutex masterMutex;
+
+    std::atomic<bool> running;
+    std::thread worker;
+
+    std::mutex receivedMutex;
+    std::vector<int> lengths;
+
+    std::atomic<uint64_t> challengeCount;
+    std::atomic<uint64_t> successCount;
+    std::atomic<uint64_t> failureCount;
+    std::atomic<uint64_t> silenceCount;
+    std::atomic<bool> hungUp;
+};
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "SimonSimulator.hpp"
+#include "ProfileArgs.hpp"
+#include "LatencyHistogram.hpp"
+#include "Logger.hpp"
+#include "middleWhere.hpp"
+#include "simon_game.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Headless counterpart of testing/main.cpp: the same W/A/S/D/SPACE triggers
+// and pattern lengths, but fed to KeyboardMiddleware::ProcessKeyEvent from a
+// synthetic key stream instead of a Windows hook, with challenges going over
+// sm_* to a simulated board on a pty instead of a COM port. Each instance
+// gets its own board and driver thread, which
+//
+//   1. types --typing ordinary keys
+//   2. presses the next trigger, then types --type-ahead keys that are
+//      buffered behind the challenge
+//   3. waits for the verdict, then re-arms the triggers once the challenge
+//      has finished and its buffered keys were replayed or dropped
+//
+// and reports challenge throughput, trigger-to-rearmed latency and the cost
+// of each ProcessKeyEvent call.
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Trigger {
+        uint16_t key;
+        int length;
+    };
+
+    // testing/main.cpp keyPatterns: 'W', 'A', 'S', 'D' and VK_SPACE
+    const Trigger TRIGGERS[] = { { 0x57, 5 }, { 0x41, 4 }, { 0x53, 6 }, { 0x44, 4 }, { 0x20, 8 } };
+    const uint16_t FIRST_TYPING_KEY = 0x30;     // '0'..'9', never triggers
+
+    struct Options {
+        int instances = 1;
+        int triggers = 1000;
+        int typing = 16;
+        int typeAhead = 4;
+        int timeoutMs = 1000;
+    };
+
+    struct Results {
+        LatencyHistogram challengeUs;
+        LatencyHistogram keyEventNs;
+        uint64_t passed = 0;
+        uint64_t failed = 0;
+        uint64_t stalled = 0;
+
+        void merge(const Results& other) {
+            challengeUs.merge(other.challengeUs);
+            keyEventNs.merge(other.keyEventNs);
+            passed += other.passed;
+            failed += other.failed;
+            stalled += other.stalled;
+        }
+    };
+
+    class Driver {
+    public:
+        Driver(const std::string& port, const Options& options) : options(options), time(0) {
+            monitor = sm_create(port.c_str());
+            connected = sm_connect(monitor) == SIMON_SUCCESS;
+        }
+
+        ~Driver() {
+            sm_destroy(monitor);
+        }
+
+        bool run(Results& results) {
+            if (!connected) {
+                return false;
+            }
+
+            serial_monitor_t port = monitor;
+            int timeoutMs = options.timeoutMs;
+            bool lastVerdict = false;
+            bool* verdict = &lastVerdict;
+            std::atomic<int> verdictCount(0);
+            std::atomic<int>* verdicts = &verdictCount;
+
+            KeyboardMiddleware middleware;
+            middleware.SetKeyInjector([](const std::vector<KeyEvent>&) {});
+            middleware.SetKeyBuffering(true);
+            middleware.RegisterHardwareCallbacks(
+                [port](int length) { sm_send_simon_game_length(port, length); },
+                [port, timeoutMs, verdict, verdicts]() {
+                    *verdict = sm_verify_simon_game_success(port, timeoutMs) == 1;
+                    (*verdicts)++;
+                    return *verdict;
+                });
+            for (const Trigger& trigger : TRIGGERS) {
+                middleware.RegisterKey(trigger.key, trigger.length);
+            }
+
+            const size_t triggerCount = sizeof(TRIGGERS) / sizeof(TRIGGERS[0]);
+            for (int i = 0; i < options.triggers; i++) {
+                for (int k = 0; k < options.typing; k++) {
+                    tap(middleware, static_cast<uint16_t>(FIRST_TYPING_KEY + k % 10), results);
+                }
+
+                int before = verdictCount;
+                Clock::time_point start = Clock::now();
+                tap(middleware, TRIGGERS[i % triggerCount].key, results);
+                for (int k = 0; k < options.typeAhead; k++) {
+                    tap(middleware, static_cast<uint16_t>(FIRST_TYPING_KEY + k % 10), results);
+                }
+
+                // Rearm() succeeds once the challenge has ended, replay
+                // included; a pass needs it too, or the next trigger could
+                // land in the replay's capture instead of a challenge
+                Clock::time_point deadline = start + std::chrono::milliseconds(options.timeoutMs * 2);
+                bool armed = false;
+                while (!armed && Clock::now() < deadline) {
+                    armed = verdictCount != before && middleware.Rearm();
+                    if (!armed) {
+                        std::this_thread::yield();
+                    }
+                }
+                if (!armed) {
+                    results.stalled++;
+                    break;
+                }
+                results.challengeUs.record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count()));
+                (lastVerdict ? results.passed : results.failed)++;
+            }
+
+            middleware.Cleanup();
+            return true;
+        }
+
+    private:
+        void tap(KeyboardMiddleware& middleware, uint16_t key, Results& results) {
+            for (bool keyUp : { false, true }) {
+                Clock::time_point before = Clock::now();
+                middleware.ProcessKeyEvent(KeyEvent{ key, 0, ++time, keyUp, false });
+                results.keyEventNs.record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count()));
+            }
+        }
+
+        Options options;
+        serial_monitor_t monitor;
+        bool connected;
+        uint32_t time;
+    };
+}
+
+int main(int argc, char** argv) {
+    SimonSimulator::Profile profile;
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (ProfileArgs::parse(argc, argv, i, profile)) {
+            continue;
+        }
+        if (option == "--instances" && i + 1 < argc) {
+            options.instances = std::max(1, std::atoi(argv[++i]));
+        } else if (option == "--triggers" && i + 1 < argc) {
+            options.triggers = std::max(1, std::atoi(argv[++i]));
+        } else if (option == "--typing" && i + 1 < argc) {
+            options.typing = std::max(0, std::atoi(argv[++i]));
+        } else if (option == "--type-ahead" && i + 1 < argc) {
+            options.typeAhead = std::max(0, std::atoi(argv[++i]));
+        } else if (option == "--timeout" && i + 1 < argc) {
+            options.timeoutMs = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "usage: simon_harness [--instances N] [--triggers N] [--typing N]\n"
+                         "                     [--type-ahead N] [--timeout MS] [options]\n" << ProfileArgs::usage();
+            return option == "--help" ? 0 : 2;
+        }
+    }
+
+    // Per-challenge INFO logging would dominate the measurement
+    Logger::setLogLevel(Logger::LogLevel::ERROR_LEVEL);
+
+    std::vector<std::unique_ptr<SimonSimulator>> boards;
+    std::vector<std::unique_ptr<Driver>> drivers;
+    for (int i = 0; i < options.instances; i++) {
+        SimonSimulator::Profile boardProfile = profile;
+        if (boardProfile.seed != 0) {
+            boardProfile.seed += i;
+        }
+        boards.emplace_back(new SimonSimulator(boardProfile));
+        drivers.emplace_back(new Driver(boards.back()->path(), options));
+    }
+
+    Results total;
+    std::mutex totalMutex;
+    bool allConnected = true;
+    std::vector<std::thread> threads;
+    Clock::time_point start = Clock::now();
+    for (std::unique_ptr<Driver>& driver : drivers) {
+        threads.emplace_back([&driver, &total, &totalMutex, &allConnected]() {
+            Results results;
+            bool connected = driver->run(results);
+            std::lock_guard<std::mutex> lock(totalMutex);
+            allConnected = allConnected && connected;
+            total.merge(results);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    uint64_t challenges = total.passed + total.failed;
+    std::cout << std::fixed << std::setprecision(1)
+              << "harness: " << challenges << " challenges from " << options.instances << " instance(s) in "
+              << seconds << " s (" << challenges / seconds << " /s)\n"
+              << "  challenges: " << total.passed << " passed, " << total.failed << " failed, "
+              << total.stalled << " stalled\n"
+              << "  trigger to rearmed us: p50 " << total.challengeUs.percentile(0.50)
+              << ", p99 " << total.challengeUs.percentile(0.99)
+              << ", max " << total.challengeUs.max() << "\n"
+              << "  key events: " << total.keyEventNs.count() << " (" << total.keyEventNs.count() / seconds
+              << " /s), ProcessKeyEvent ns: p50 " << total.keyEventNs.percentile(0.50)
+              << ", p99 " << total.keyEventNs.percentile(0.99)
+              << ", max " << total.keyEventNs.max() << std::endl;
+
+    if (!allConnected) {
+        std::cerr << "a simulated board could not be opened" << std::endl;
+        return 1;
+    }
+    // A stall means a challenge never finished, which no profile explains
+    // short of a hang-up
+    bool faultFree = profile.silenceRate == 0 && profile.disconnectRate == 0 && profile.disconnectAfter == 0;
+    if (faultFree && (total.stalled > 0 || challenges != static_cast<uint64_t>(options.triggers) * options.instances)) {
+        std::cerr << "not every trigger completed a challenge" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#include "SimonSimulator.hpp"
+#include "ProfileArgs.hpp"
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Runs simulated Simon boards until interrupted, so the app or sm_* callers
+// can be pointed at the printed /dev/pts paths instead of real boards.
+
+namespace {
+    volatile std::sig_atomic_t stopRequested = 0;
+
+    void onSignal(int) {
+        stopRequested = 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    SimonSimulator::Profile profile;
+    int boardCount = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (ProfileArgs::parse(argc, argv, i, profile)) {
+            continue;
+        }
+        if (option == "--boards" && i + 1 < argc) {
+            boardCount = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "usage: simon_simulator [--boards N] [options]\n" << ProfileArgs::usage();
+            return option == "--help" ? 0 : 2;
+        }
+    }
+
+    std::vector<std::unique_ptr<SimonSimulator>> boards;
+    for (int i = 0; i < boardCount; i++) {
+        boards.emplace_back(new SimonSimulator(profile));
+        std::cout << "Board " << i << ": " << boards.back()->path() << std::endl;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    while (!stopRequested) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    for (size_t i = 0; i < boards.size(); i++) {
+        SimonSimulator::Stats stats = boards[i]->stats();
+        std::cout << "Board " << i << ": " << stats.challenges << " challenges, "
+                  << stats.successes << " True, " << stats.failures << " False, "
+                  << stats.silences << " unanswered" << (stats.hungUp ? ", hung up" : "") << std::endl;
+    }
+    return 0;
+}
\ No newline at end of file
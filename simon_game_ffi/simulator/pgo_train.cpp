@@ -0,0 +1,162 @@
+#include "SimonSimulator.hpp"
+#include "Logger.hpp"
+#include "middleWhere.hpp"
+#include "simon_game.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Training workload for SIMON_PGO=GENERATE builds. Runs the paths that
+// matter at runtime against simulated boards, so the profile reflects a
+// real session rather than start-up code:
+//
+//   keys    typing through ProcessKeyEvent with gated keypresses mixed in
+//   serial  sm_* challenges, including replies the host has to wait for
+//   pool    dp_* challenges from several client threads
+//
+// Exits non-zero if a stage did not complete, since a profile trained on a
+// broken run would optimise the error paths.
+
+namespace {
+    const uint16_t TRIGGER_KEY = 0x53; // 'S'
+
+    bool trainKeys(const std::string& path, int gatedPresses) {
+        serial_monitor_t monitor = sm_create(path.c_str());
+        if (sm_connect(monitor) != SIMON_SUCCESS) {
+            sm_destroy(monitor);
+            return false;
+        }
+
+        std::atomic<int> released(0);
+        std::atomic<bool> rejected(false);
+
+        KeyboardMiddleware middleware;
+        middleware.SetKeyInjector([&](const std::vector<KeyEvent>&) { released++; });
+        middleware.SetKeyBuffering(true);
+        middleware.RegisterHardwareCallbacks(
+            [monitor](int length) { sm_send_simon_game_length(monitor, length); },
+            [monitor, &rejected]() {
+                bool success = sm_verify_simon_game_success(monitor, 1000) == 1;
+                if (!success) {
+                    rejected = true;
+                }
+                return success;
+            });
+        middleware.RegisterKey(TRIGGER_KEY, 4);
+
+        uint32_t time = 0;
+        for (int i = 0; i < gatedPresses && !rejected; i++) {
+            // Ordinary typing between challenges is the common case
+            for (uint16_t key = 0x41; key < 0x41 + 16; key++) {
+                middleware.ProcessKeyEvent({key, 0, ++time, false, false});
+                middleware.ProcessKeyEvent({key, 0, ++time, true, false});
+            }
+            middleware.ProcessKeyEvent({TRIGGER_KEY, 0x1F, ++time, false, false});
+            // Until the replay is over too, or the next trigger is captured
+            while ((released < i + 1 || !middleware.Rearm()) && !rejected) {
+                std::this_thread::yield();
+            }
+            middleware.ProcessKeyEvent({TRIGGER_KEY, 0x1F, ++time, true, false});
+        }
+
+        middleware.Cleanup();
+        sm_destroy(monitor);
+        return !rejected;
+    }
+
+    bool trainSerial(SimonSimulator& board, int challenges) {
+        serial_monitor_t monitor = sm_create(board.path().c_str());
+        if (sm_connect(monitor) != SIMON_SUCCESS) {
+            sm_destroy(monitor);
+            return false;
+        }
+        for (int i = 0; i < challenges; i++) {
+            if (sm_send_simon_game_length(monitor, 1 + i % 8) != SIMON_SUCCESS) {
+                break;
+            }
+            sm_verify_simon_game_success(monitor, 1000);
+        }
+        sm_destroy(monitor);
+
+        SimonSimulator::Stats stats = board.stats();
+        return stats.successes + stats.failures == static_cast<uint64_t>(challenges);
+    }
+
+    bool trainPool(const std::vector<std::unique_ptr<SimonSimulator>>& boards, int challenges, int clients) {
+        device_pool_t pool = dp_create(1000);
+        for (const std::unique_ptr<SimonSimulator>& board : boards) {
+            dp_add_device(pool, board->path().c_str());
+        }
+        dp_start(pool);
+
+        std::atomic<int> remaining(challenges);
+        std::vector<std::thread> workers;
+        for (int c = 0; c < clients; c++) {
+            workers.emplace_back([pool, &remaining]() {
+                int n;
+                while ((n = remaining--) > 0) {
+                    dp_run_challenge(pool, 1 + n % 8);
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        dp_destroy(pool);
+
+        // A timeout also reads as 0, so check every challenge was answered
+        uint64_t answered = 0;
+        for (const std::unique_ptr<SimonSimulator>& board : boards) {
+            SimonSimulator::Stats stats = board->stats();
+            answered += stats.successes + stats.failures;
+        }
+        return answered == static_cast<uint64_t>(challenges);
+    }
+}
+
+int main(int argc, char** argv) {
+    // Scales the run; 1 takes about a second
+    int scale = argc > 1 ? std::max(1, std::atoi(argv[1])) : 1;
+
+    // Failed rounds log a warning each; console output would dominate the profile
+    Logger::setLogLevel(Logger::LogLevel::ERROR_LEVEL);
+
+    SimonSimulator keyBoard(SimonSimulator::Profile{});
+    if (!trainKeys(keyBoard.path(), 500 * scale)) {
+        std::cerr << "pgo_train: keyboard stage failed" << std::endl;
+        return 1;
+    }
+
+    // A mix of passes and failures with a little reply latency, so the
+    // host sees both verdicts and waits on the port
+    SimonSimulator::Profile mixed;
+    mixed.successRate = 0.7;
+    mixed.latencyMs = 0.2;
+    mixed.jitterMs = 0.1;
+    mixed.seed = 1;
+
+    SimonSimulator serialBoard(mixed);
+    if (!trainSerial(serialBoard, 2000 * scale)) {
+        std::cerr << "pgo_train: serial stage failed" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<SimonSimulator>> boards;
+    for (int i = 0; i < 4; i++) {
+        SimonSimulator::Profile boardProfile = mixed;
+        boardProfile.seed += i + 1;
+        boards.emplace_back(new SimonSimulator(boardProfile));
+    }
+    if (!trainPool(boards, 4000 * scale, 8)) {
+        std::cerr << "pgo_train: pool stage failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "pgo_train: done" << std::endl;
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "SimonSimulator.hpp"
+#include "ProfileArgs.hpp"
+#include "Logger.hpp"
+#include "simon_game.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pushes challenges through the C API against simulated boards and reports
+// throughput and round-trip latency.
+//
+//   serial: one sm_* handle and thread per board (send length, verify)
+//   pool:   every board in one dp_* pool, driven by --clients threads
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Results {
+        std::mutex mutex;
+        std::vector<double> latenciesUs;
+        std::atomic<uint64_t> successes{0};
+        std::atomic<uint64_t> failures{0};
+
+        void record(bool success, Clock::time_point start) {
+            double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+            (success ? successes : failures)++;
+            std::lock_guard<std::mutex> lock(mutex);
+            latenciesUs.push_back(us);
+        }
+    };
+
+    double percentile(std::vector<double>& sorted, double p) {
+        if (sorted.empty()) {
+            return 0.0;
+        }
+        size_t index = static_cast<size_t>(p * (sorted.size() - 1));
+        return sorted[index];
+    }
+
+    void runSerial(const std::vector<std::unique_ptr<SimonSimulator>>& boards, int perBoard, int timeoutMs, Results& results) {
+        std::vector<std::thread> workers;
+        for (const std::unique_ptr<SimonSimulator>& board : boards) {
+            std::string path = board->path();
+            workers.emplace_back([path, perBoard, timeoutMs, &results]() {
+                serial_monitor_t monitor = sm_create(path.c_str());
+                if (sm_connect(monitor) != SIMON_SUCCESS) {
+                    sm_destroy(monitor);
+                    return;
+                }
+                for (int i = 0; i < perBoard; i++) {
+                    Clock::time_point start = Clock::now();
+                    bool success = sm_send_simon_game_length(monitor, 1 + i % 8) == SIMON_SUCCESS &&
+                                   sm_verify_simon_game_success(monitor, timeoutMs) == 1;
+                    results.record(success, start);
+                }
+                sm_destroy(monitor);
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void runPool(const std::vector<std::unique_ptr<SimonSimulator>>& boards, int total, int clients, int timeoutMs, Results& results) {
+        device_pool_t pool = dp_create(timeoutMs);
+        for (const std::unique_ptr<SimonSimulator>& board : boards) {
+            dp_add_device(pool, board->path().c_str());
+        }
+        dp_start(pool);
+
+        std::atomic<int> remaining(total);
+        std::vector<std::thread> workers;
+        for (int c = 0; c < clients; c++) {
+            workers.emplace_back([pool, &remaining, &results]() {
+                int n;
+                while ((n = remaining--) > 0) {
+                    Clock::time_point start = Clock::now();
+                    results.record(dp_run_challenge(pool, 1 + n % 8) == 1, start);
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        dp_destroy(pool);
+    }
+}
+
+int main(int argc, char** argv) {
+    SimonSimulator::Profile profile;
+    std::string mode = "serial";
+    int boardCount = 4;
+    int challenges = 10000;
+    int clients = 0;
+    int timeoutMs = 1000;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (ProfileArgs::parse(argc, argv, i, profile)) {
+            continue;
+        }
+        if (option == "--mode" && i + 1 < argc) {
+            mode = argv[++i];
+        } else if (option == "--boards" && i + 1 < argc) {
+            boardCount = std::max(1, std::atoi(argv[++i]));
+        } else if (option == "--challenges" && i + 1 < argc) {
+            challenges = std::max(1, std::atoi(argv[++i]));
+        } else if (option == "--clients" && i + 1 < argc) {
+            clients = std::atoi(argv[++i]);
+        } else if (option == "--timeout" && i + 1 < argc) {
+            timeoutMs = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "usage: simon_stress [--mode serial|pool] [--boards N] [--challenges N]\n"
+                         "                    [--clients N] [--timeout MS] [options]\n" << ProfileArgs::usage();
+            return option == "--help" ? 0 : 2;
+        }
+    }
+    if (mode != "serial" && mode != "pool") {
+        std::cerr << "unknown mode: " << mode << std::endl;
+        return 2;
+    }
+
+    // Per-challenge INFO logging would dominate the measurement
+    Logger::setLogLevel(Logger::LogLevel::WARNING);
+
+    std::vector<std::unique_ptr<SimonSimulator>> boards;
+    for (int i = 0; i < boardCount; i++) {
+        SimonSimulator::Profile boardProfile = profile;
+        if (boardProfile.seed != 0) {
+            boardProfile.seed += i;
+        }
+        boards.emplace_back(new SimonSimulator(boardProfile));
+    }
+
+    Results results;
+    Clock::time_point start = Clock::now();
+    if (mode == "serial") {
+        runSerial(boards, (challenges + boardCount - 1) / boardCount, timeoutMs, results);
+    } else {
+        runPool(boards, challenges, clients > 0 ? clients : boardCount, timeoutMs, results);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::sort(results.latenciesUs.begin(), results.latenciesUs.end());
+    uint64_t completed = results.successes + results.failures;
+
+    uint64_t boardSuccesses = 0;
+    uint64_t boardAnswers = 0;
+    for (const std::unique_ptr<SimonSimulator>& board : boards) {
+        SimonSimulator::Stats stats = board->stats();
+        boardSuccesses += stats.successes;
+        boardAnswers += stats.successes + stats.failures;
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << mode << ": " << completed << " challenges on " << boardCount << " board(s) in "
+              << seconds << " s (" << completed / seconds << " /s)\n"
+              << "  host: " << results.successes << " True, " << results.failures << " False/timeout\n"
+              << "  boards: " << boardSuccesses << " True of " << boardAnswers << " answered\n"
+              << "  latency us: p50 " << percentile(results.latenciesUs, 0.50)
+              << ", p99 " << percentile(results.latenciesUs, 0.99)
+              << ", max " << (results.latenciesUs.empty() ? 0.0 : results.latenciesUs.back()) << std::endl;
+
+    // With no scripted faults every board answer must reach the host intact
+    bool faultFree = profile.silenceRate == 0 && profile.disconnectRate == 0 && profile.disconnectAfter == 0;
+    if (faultFree && (results.successes != boardSuccesses || boardAnswers != completed)) {
+        std::cerr << "host and boards disagree on the results" << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "AdaptiveLength.hpp"
+#include <algorithm>
+
+AdaptiveLength::AdaptiveLength()
+    : enabled(false), minLength(1), maxLength(1), lengthOffset(0), next(0), count(0), successes(0),
+      stepSecondsSum(0.0) {
+}
+
+bool AdaptiveLength::configure(int minimum, int maximum, size_t window) {
+    if (minimum < 1 || maximum < minimum || window == 0) {
+        return false;
+    }
+
+    enabled = true;
+    minLength = minimum;
+    maxLength = maximum;
+    lengthOffset = 0;
+    results.assign(window, Result{ false, 0.0 });
+    next = 0;
+    count = 0;
+    successes = 0;
+    stepSecondsSum = 0.0;
+    return true;
+}
+
+void AdaptiveLength::disable() {
+    enabled = false;
+    lengthOffset = 0;
+}
+
+int AdaptiveLength::nextLength(int baseLength) const {
+    if (!enabled) {
+        return baseLength;
+    }
+    return std::min(std::max(baseLength + lengthOffset, minLength), maxLength);
+}
+
+void AdaptiveLength::record(bool success, double seconds, int length) {
+    if (!enabled) {
+        return;
+    }
+
+    // Evict the oldest result from the running sums once the ring is full
+    if (count == results.size()) {
+        const Result& oldest = results[next];
+        successes -= oldest.success ? 1 : 0;
+        stepSecondsSum -= oldest.stepSeconds;
+    } else {
+        count++;
+    }
+
+    Result result = { success, success && length > 0 ? seconds / length : 0.0 };
+    results[next] = result;
+    next = (next + 1) % results.size();
+    successes += success ? 1 : 0;
+    stepSecondsSum += result.stepSeconds;
+
+    // The offset never needs to go past what the bounds can express
+    int span = maxLength - minLength;
+    double rate = successRate();
+    if (rate < LOW_SUCCESS_RATE) {
+        lengthOffset = std::min(lengthOffset + 1, span);
+    } else if (rate >= HIGH_SUCCESS_RATE && averageStepSeconds() <= MAX_FLUENT_STEP_SECONDS) {
+        lengthOffset = std::max(lengthOffset - 1, -span);
+    }
+}
+
+double AdaptiveLength::successRate() const {
+    return count == 0 ? 0.0 : static_cast<double>(successes) / count;
+}
+
+double AdaptiveLength::averageStepSeconds() const {
+    // Only passes are timed; a failure says nothing about pace
+    return successes == 0 ? 0.0 : stepSecondsSum / successes;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Scales challenge length to how the user has been doing over the last
+// `window` challenges. Each trigger keeps its registered length as a base;
+// the policy holds one offset that moves a step at a time:
+//
+//   - success rate below LOW_SUCCESS_RATE: one step longer, since repeated
+//     failures are what guessing looks like
+//   - success rate at or above HIGH_SUCCESS_RATE and an average pace of at
+//     most MAX_FLUENT_STEP_SECONDS per step: one step shorter
+//
+// The result is clamped to [minLength, maxLength]. Rates and pace come from
+// running sums over a ring of results, so each challenge costs O(1).
+// Not thread-safe: device and speculative challenges finish concurrently, so
+// callers must hold a lock around every call (the middleware's counterMutex).
+class AdaptiveLength {
+public:
+    static constexpr double LOW_SUCCESS_RATE = 0.6;
+    static constexpr double HIGH_SUCCESS_RATE = 0.9;
+    static constexpr double MAX_FLUENT_STEP_SECONDS = 1.5;
+
+    AdaptiveLength();
+
+    // Turns the policy on with the given bounds and window (challenges).
+    // Returns false (and changes nothing) on invalid settings.
+    bool configure(int minLength, int maxLength, size_t window);
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Length to ask the device for, given the trigger's registered length
+    int nextLength(int baseLength) const;
+
+    // Feeds back one finished challenge
+    void record(bool success, double seconds, int length);
+
+    double successRate() const;
+    double averageStepSeconds() const;
+    int offset() const { return lengthOffset; }
+
+private:
+    struct Result {
+        bool success;
+        double stepSeconds;
+    };
+
+    bool enabled;
+    int minLength;
+    int maxLength;
+    int lengthOffset;
+
+    std::vector<Result> results;
+    size_t next;
+    size_t count;
+    size_t successes;
+    double stepSecondsSum;
+};
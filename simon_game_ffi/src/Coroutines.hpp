@@ -0,0 +1,271 @@
+#pragma once
+// C++20 coroutines over EventLoop, for driving many challenges from one
+// thread without a blocked thread per board:
+//
+//     simon::task<bool> play(simon::device& board) {
+//         bool passed = co_await simon::run_challenge(board, 4);
+//         ...
+//     }
+//     simon::spawn(play(board), [](bool passed) { ... });
+//     loop.run();
+//
+// Header-only so the library itself stays C++17; include it from a C++20
+// translation unit. Everything runs on the thread driving the loop, and a
+// coroutine suspended on a loop must finish (or time out) before that loop
+// or its device is destroyed.
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+
+#include "EventLoop.hpp"
+#include "LineFramer.hpp"
+#include "SerialMonitor.hpp"
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace simon {
+
+template <typename T>
+class task;
+
+namespace detail {
+    // Resumes whoever awaited the task once it finishes
+    struct final_awaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> finished) noexcept {
+            std::coroutine_handle<> next = finished.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    struct promise_base {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        final_awaiter final_suspend() const noexcept { return {}; }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    template <typename T>
+    struct promise : promise_base {
+        std::optional<T> value;
+
+        task<T> get_return_object();
+        template <typename U>
+        void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+        T take() {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            return std::move(*value);
+        }
+    };
+
+    template <>
+    struct promise<void> : promise_base {
+        task<void> get_return_object();
+        void return_void() {}
+        void take() {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    };
+
+    // Started by spawn(); frees itself when done
+    struct detached {
+        struct promise_type {
+            detached get_return_object() const noexcept { return {}; }
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+    };
+}
+
+// A lazily started coroutine producing a T. Runs when first awaited and
+// resumes its awaiter directly when it finishes; awaited at most once.
+template <typename T>
+class [[nodiscard]] task {
+public:
+    using promise_type = detail::promise<T>;
+
+    task(task&& other) noexcept : coroutine(std::exchange(other.coroutine, nullptr)) {}
+    task& operator=(task&& other) noexcept {
+        if (this != &other) {
+            if (coroutine) {
+                coroutine.destroy();
+            }
+            coroutine = std::exchange(other.coroutine, nullptr);
+        }
+        return *this;
+    }
+    ~task() {
+        if (coroutine) {
+            coroutine.destroy();
+        }
+    }
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        coroutine.promise().continuation = awaiting;
+        return coroutine;
+    }
+    T await_resume() { return coroutine.promise().take(); }
+
+private:
+    friend promise_type;
+    explicit task(std::coroutine_handle<promise_type> handle) : coroutine(handle) {}
+
+    std::coroutine_handle<promise_type> coroutine;
+};
+
+template <typename T>
+task<T> detail::promise<T>::get_return_object() {
+    return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+}
+
+inline task<void> detail::promise<void>::get_return_object() {
+    return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+}
+
+// Runs `work` to completion in the background and hands its result to
+// `done`. An exception escaping `work` terminates, as on a plain thread.
+template <typename T, typename Done>
+detail::detached spawn(task<T> work, Done done) {
+    if constexpr (std::is_void_v<T>) {
+        co_await std::move(work);
+        done();
+    } else {
+        done(co_await std::move(work));
+    }
+}
+
+// Waits on the loop for `handle` to become readable. Resumes with false if
+// `deadline` passes first.
+class readable {
+public:
+    readable(EventLoop& loop, SerialMonitor::NativeHandle handle,
+             EventLoop::Clock::time_point deadline = EventLoop::Clock::time_point::max())
+        : loop(loop), handle(handle), deadline(deadline), timer(0), ready(false) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> waiting) {
+        // Each side clears the other before resuming, since the awaiter
+        // lives in the frame being resumed
+        loop.watch(handle, [this, waiting]() {
+            loop.cancelTimer(timer);
+            loop.unwatch(handle);
+            ready = true;
+            waiting.resume();
+        });
+        if (deadline != EventLoop::Clock::time_point::max()) {
+            timer = loop.addTimer(deadline, [this, waiting]() {
+                loop.unwatch(handle);
+                waiting.resume();
+            });
+        }
+    }
+    bool await_resume() const noexcept { return ready; }
+
+private:
+    EventLoop& loop;
+    SerialMonitor::NativeHandle handle;
+    EventLoop::Clock::time_point deadline;
+    EventLoop::TimerId timer;
+    bool ready;
+};
+
+// Resumes on the loop once `when` has passed
+class sleep_until {
+public:
+    sleep_until(EventLoop& loop, EventLoop::Clock::time_point when) : loop(loop), when(when) {}
+
+    bool await_ready() const noexcept { return when <= EventLoop::Clock::now(); }
+    void await_suspend(std::coroutine_handle<> waiting) {
+        loop.addTimer(when, [waiting]() { waiting.resume(); });
+    }
+    void await_resume() const noexcept {}
+
+private:
+    EventLoop& loop;
+    EventLoop::Clock::time_point when;
+};
+
+// A connected board on a loop, with its own line buffer. One coroutine at a
+// time may read from it.
+class device {
+public:
+    device(EventLoop& loop, SerialMonitor& port) : eventLoop(loop), serial(port) {}
+
+    EventLoop& loop() { return eventLoop; }
+    SerialMonitor& port() { return serial; }
+
+    // A challenge line fits the driver's buffer, so writes complete without
+    // suspending (bounded by the port's write timeout)
+    bool write(const std::string& line) { return serial.sendCommand(line).ok(); }
+
+    // The next line from the board, or nothing on timeout or a failed port
+    task<std::optional<std::string>> read_line(EventLoop::Clock::time_point deadline) {
+        std::string line;
+        while (!framer.nextLine(line)) {
+            if (!co_await readable(eventLoop, serial.nativeHandle(), deadline)) {
+                co_return std::nullopt;
+            }
+            char buffer[256];
+            Result<size_t> bytesRead = 0;
+            while ((bytesRead = serial.readAvailable(buffer, sizeof(buffer))) && bytesRead.value() > 0) {
+                framer.append(buffer, bytesRead.value());
+            }
+            if (!bytesRead) {
+                co_return std::nullopt;
+            }
+        }
+        co_return line;
+    }
+
+    // Drops buffered replies that belong to no one, e.g. after a timeout
+    void discard() { framer.clear(); }
+
+private:
+    EventLoop& eventLoop;
+    SerialMonitor& serial;
+    LineFramer framer;
+};
+
+// One Simon round: sends the length and waits for the board's True/False.
+// A board that stays silent until `timeout` fails the challenge, like
+// SerialMonitor::verifySimonGameSuccess.
+inline task<bool> run_challenge(device& board, int length,
+                                std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+    board.discard();
+    if (!board.write(std::to_string(length))) {
+        co_return false;
+    }
+
+    EventLoop::Clock::time_point deadline = EventLoop::Clock::now() + timeout;
+    while (std::optional<std::string> line = co_await board.read_line(deadline)) {
+        if (line->find("True") != std::string::npos) {
+            co_return true;
+        }
+        if (line->find("False") != std::string::npos) {
+            co_return false;
+        }
+    }
+    co_return false;
+}
+
+} // namespace simon
+
+#endif
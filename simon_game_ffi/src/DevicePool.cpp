@@ -0,0 +1,409 @@
+#include "DevicePool.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "Trace.hpp"
+
+namespace {
+    // Bytes kept while waiting for a newline before the board is assumed to
+    // be sending garbage
+    const size_t MAX_LINE_LENGTH = 1024;
+
+    struct PoolMetrics {
+        Metrics::Counter& succeeded = Metrics::counter("simon_pool_replies_total{result=\"success\"}",
+                                                       "Board replies received by device pools, by result");
+        Metrics::Counter& failed = Metrics::counter("simon_pool_replies_total{result=\"failure\"}",
+                                                    "Board replies received by device pools, by result");
+        Metrics::Counter& timeouts = Metrics::counter("simon_pool_timeouts_total",
+                                                      "Challenges a board did not answer in time");
+        Metrics::Counter& failovers = Metrics::counter("simon_pool_failovers_total",
+                                                       "Challenges moved to another board after an I/O error");
+        Metrics::Counter& dropped = Metrics::counter("simon_pool_boards_dropped_total",
+                                                     "Boards taken out of service");
+        Metrics::Histogram& latency = Metrics::histogram("simon_pool_reply_latency_seconds",
+                                                         "Time from sending a challenge to the board's reply");
+    };
+
+    PoolMetrics& metrics() {
+        static PoolMetrics instance;
+        return instance;
+    }
+}
+
+DevicePool::DevicePool() : DevicePool(Options()) {
+}
+
+DevicePool::DevicePool(const Options& poolOptions, EventLoop* sharedLoop)
+    : options(poolOptions), ownedLoop(sharedLoop ? nullptr : new EventLoop()),
+      loop(sharedLoop ? *sharedLoop : *ownedLoop), running(false) {
+}
+
+DevicePool::~DevicePool() {
+    stop();
+
+    // A shared loop outlives the pool, so nothing of ours may stay on it
+    for (const std::unique_ptr<Device>& device : devices) {
+        loop.unwatch(device->monitor->nativeHandle());
+        loop.cancelTimer(device->reconnectTimer);
+        loop.cancelTimer(device->graceTimer);
+    }
+}
+
+bool DevicePool::onLoopThread() const {
+    return !ownedLoop || std::this_thread::get_id() == loopThread.get_id();
+}
+
+bool DevicePool::addDevice(const std::string& portName) {
+    std::unique_ptr<Device> device(new Device{
+        std::unique_ptr<SerialMonitor>(new SerialMonitor(portName)), LineFramer(), true, nullptr, {}, 0, 0, 0, 0, 0, 0, 0, 0.0 });
+
+    if (!device->monitor->connect()) {
+        return false;
+    }
+
+    auto insert = [this, &device]() {
+        devices.push_back(std::move(device));
+        attach(*devices.back());
+        LOG_INFO("Device pool added board: " + devices.back()->monitor->getPortName() +
+                 " (" + std::to_string(devices.size()) + " total)");
+        dispatch();
+    };
+
+    if (running && !onLoopThread()) {
+        std::promise<void> added;
+        loop.post([&insert, &added]() {
+            insert();
+            added.set_value();
+        });
+        added.get_future().wait();
+    } else {
+        insert();
+    }
+    return true;
+}
+
+bool DevicePool::start() {
+    if (running) {
+        return true;
+    }
+
+    running = true;
+    if (!ownedLoop) {
+        dispatch();
+        return true;
+    }
+    loopThread = std::thread([this]() {
+        Trace::setThreadName("device pool");
+        LOG_INFO("Device pool thread running");
+        dispatch();
+        loop.run();
+        LOG_INFO("Device pool thread stopped");
+    });
+    return true;
+}
+
+void DevicePool::stop() {
+    if (!ownedLoop) {
+        running = false;
+        failAll();
+        return;
+    }
+
+    if (running) {
+        loop.stop();
+        loopThread.join();
+        running = false;
+    }
+
+    // Pick up challenges that were posted but never reached the queue, so
+    // every caller gets an answer
+    loop.runOnce(EventLoop::Clock::now());
+    failAll();
+}
+
+void DevicePool::submit(int length, ChallengeCallback done) {
+    auto enqueue = [this, length, done]() {
+        queue.push_back(std::unique_ptr<Challenge>(new Challenge{ length, done, 0, Trace::isEnabled() ? Trace::now() : 0 }));
+        if (running) {
+            dispatch();
+        }
+    };
+
+    // Nothing posted to a shared loop may outlive the pool, and callers are
+    // on the loop thread anyway
+    if (!ownedLoop) {
+        enqueue();
+    } else {
+        loop.post(enqueue);
+    }
+}
+
+std::future<bool> DevicePool::submit(int length) {
+    auto result = std::make_shared<std::promise<bool>>();
+    submit(length, [result](bool success) { result->set_value(success); });
+    return result->get_future();
+}
+
+bool DevicePool::runChallenge(int length) {
+    if (!ownedLoop) {
+        LOG_ERROR("Blocking challenges are not available on a shared event loop, use submit()");
+        return false;
+    }
+    return submit(length).get();
+}
+
+std::vector<DevicePool::DeviceStatus> DevicePool::status() {
+    auto collect = [this]() {
+        std::vector<DeviceStatus> result;
+        for (const std::unique_ptr<Device>& device : devices) {
+            result.push_back(DeviceStatus{
+                device->monitor->getPortName(), device->healthy, device->active != nullptr,
+                device->completed, device->failed, device->missed, device->averageLatencyMs });
+        }
+        return result;
+    };
+
+    if (!running || onLoopThread()) {
+        return collect();
+    }
+
+    std::promise<std::vector<DeviceStatus>> snapshot;
+    loop.post([&snapshot, &collect]() { snapshot.set_value(collect()); });
+    return snapshot.get_future().get();
+}
+
+int DevicePool::healthyCount() {
+    int count = 0;
+    for (const DeviceStatus& device : status()) {
+        if (device.healthy) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void DevicePool::attach(Device& device) {
+    loop.watch(device.monitor->nativeHandle(), [this, &device]() { onReadable(device); });
+}
+
+DevicePool::Device* DevicePool::pickDevice() {
+    // Boards play one challenge at a time, so "least busy" is any idle board;
+    // among those prefer the one that has been answering fastest, then the
+    // one used least. Unused boards start at 0 ms and are tried first.
+    Device* best = nullptr;
+    for (const std::unique_ptr<Device>& device : devices) {
+        if (!device->healthy || device->active || device->graceTimer != 0) {
+            continue;
+        }
+        if (best == nullptr ||
+            device->averageLatencyMs < best->averageLatencyMs ||
+            (device->averageLatencyMs == best->averageLatencyMs && device->completed < best->completed)) {
+            best = device.get();
+        }
+    }
+    return best;
+}
+
+void DevicePool::dispatch() {
+    while (!queue.empty()) {
+        Device* device = pickDevice();
+        if (device == nullptr) {
+            bool anyHealthy = false;
+            for (const std::unique_ptr<Device>& d : devices) {
+                anyHealthy = anyHealthy || d->healthy;
+            }
+            if (anyHealthy) {
+                return;
+            }
+
+            LOG_WARNING("No healthy Simon board available, failing " + std::to_string(queue.size()) + " challenge(s)");
+            while (!queue.empty()) {
+                std::unique_ptr<Challenge> challenge = std::move(queue.front());
+                queue.pop_front();
+                challenge->done(false);
+            }
+            return;
+        }
+
+        std::unique_ptr<Challenge> challenge = std::move(queue.front());
+        queue.pop_front();
+        startOn(*device, std::move(challenge));
+    }
+}
+
+void DevicePool::startOn(Device& device, std::unique_ptr<Challenge> challenge) {
+    Trace::Span span("pool", "serial write", challenge->length);
+    if (challenge->queuedAt != 0) {
+        Trace::record("pool", "queue wait", challenge->queuedAt, Trace::now());
+    }
+    challenge->attempts++;
+    device.active = std::move(challenge);
+    device.framer.clear();
+
+    if (!device.monitor->sendSimonGameLength(device.active->length)) {
+        dropDevice(device, "write failed");
+        return;
+    }
+
+    device.sentAt = EventLoop::Clock::now();
+    device.timeoutTimer = loop.addTimer(device.sentAt + std::chrono::milliseconds(options.challengeTimeoutMs),
+                                        [this, &device]() { onTimeout(device); });
+    LOG_DEBUG("Challenge of length " + std::to_string(device.active->length) +
+              " sent to board: " + device.monitor->getPortName());
+}
+
+void DevicePool::onReadable(Device& device) {
+    char buffer[256];
+    while (true) {
+        Result<size_t> bytesRead = device.monitor->readAvailable(buffer, sizeof(buffer));
+        if (!bytesRead) {
+            dropDevice(device, "read failed");
+            dispatch();
+            return;
+        }
+        if (bytesRead.value() == 0) {
+            break;
+        }
+        device.framer.append(buffer, bytesRead.value());
+    }
+
+    std::string line;
+    while (device.framer.nextLine(line)) {
+        handleLine(device, line);
+        if (!device.healthy) {
+            return;
+        }
+    }
+
+    if (device.framer.pending() > MAX_LINE_LENGTH) {
+        LOG_WARNING("Discarding unterminated data from board: " + device.monitor->getPortName());
+        device.framer.clear();
+    }
+}
+
+void DevicePool::handleLine(Device& device, const std::string& line) {
+    Trace::Span span("pool", "parse");
+    LOG_DEBUG("Board " + device.monitor->getPortName() + ": " + line);
+
+    // Replies that arrive while idle (e.g. after a timeout) belong to no one
+    if (!device.active) {
+        return;
+    }
+
+    if (line.find("True") != std::string::npos) {
+        complete(device, true);
+    } else if (line.find("False") != std::string::npos) {
+        complete(device, false);
+    }
+}
+
+void DevicePool::complete(Device& device, bool success) {
+    loop.cancelTimer(device.timeoutTimer);
+
+    EventLoop::Clock::time_point repliedAt = EventLoop::Clock::now();
+    double latencyMs = std::chrono::duration<double, std::milli>(repliedAt - device.sentAt).count();
+    Trace::record("pool", "device wait", Trace::at(device.sentAt), Trace::at(repliedAt));
+    device.averageLatencyMs = device.completed == 0 ? latencyMs : device.averageLatencyMs * 0.8 + latencyMs * 0.2;
+    device.completed++;
+    if (!success) {
+        device.failed++;
+    }
+    device.missedReplies = 0;
+    metrics().latency.observe(latencyMs / 1000.0);
+    (success ? metrics().succeeded : metrics().failed).inc();
+
+    std::unique_ptr<Challenge> challenge = std::move(device.active);
+    LOG_INFO("Board " + device.monitor->getPortName() + " reported " + (success ? "success" : "failure") +
+             " after " + std::to_string(static_cast<int>(latencyMs)) + " ms");
+    challenge->done(success);
+    dispatch();
+}
+
+void DevicePool::onTimeout(Device& device) {
+    device.missed++;
+    device.missedReplies++;
+    metrics().timeouts.inc();
+
+    std::unique_ptr<Challenge> challenge = std::move(device.active);
+    LOG_WARNING("Board " + device.monitor->getPortName() + " did not answer within " +
+                std::to_string(options.challengeTimeoutMs) + " ms (" + std::to_string(device.missedReplies) +
+                " in a row)");
+
+    if (device.missedReplies >= options.maxMissedReplies) {
+        dropDevice(device, "stopped answering");
+    } else if (options.lateReplyGraceMs > 0) {
+        device.graceTimer = loop.addTimer(EventLoop::Clock::now() + std::chrono::milliseconds(options.lateReplyGraceMs),
+                                          [this, &device]() { endGrace(device); });
+    } else {
+        device.monitor->discardInput();
+        device.framer.clear();
+    }
+    challenge->done(false);
+    dispatch();
+}
+
+void DevicePool::endGrace(Device& device) {
+    device.graceTimer = 0;
+    device.monitor->discardInput();
+    device.framer.clear();
+    dispatch();
+}
+
+void DevicePool::dropDevice(Device& device, const std::string& reason) {
+    LOG_WARNING("Dropping board " + device.monitor->getPortName() + ": " + reason);
+    metrics().dropped.inc();
+
+    loop.unwatch(device.monitor->nativeHandle());
+    device.monitor->disconnect();
+    device.healthy = false;
+    device.framer.clear();
+    device.missedReplies = 0;
+    loop.cancelTimer(device.graceTimer);
+    device.graceTimer = 0;
+
+    // Fail the challenge over to another board, unless it has already been
+    // tried on as many boards as there are
+    if (device.active) {
+        loop.cancelTimer(device.timeoutTimer);
+        std::unique_ptr<Challenge> challenge = std::move(device.active);
+        if (challenge->attempts < static_cast<int>(devices.size())) {
+            LOG_INFO("Failing challenge over from board: " + device.monitor->getPortName());
+            metrics().failovers.inc();
+            queue.push_front(std::move(challenge));
+        } else {
+            challenge->done(false);
+        }
+    }
+
+    scheduleReconnect(device);
+}
+
+void DevicePool::scheduleReconnect(Device& device) {
+    device.reconnectTimer = loop.addTimer(
+        EventLoop::Clock::now() + std::chrono::milliseconds(options.reconnectIntervalMs),
+        [this, &device]() {
+            device.reconnectTimer = 0;
+            if (!device.monitor->connect()) {
+                scheduleReconnect(device);
+                return;
+            }
+            device.healthy = true;
+            attach(device);
+            LOG_INFO("Board back online: " + device.monitor->getPortName());
+            dispatch();
+        });
+}
+
+void DevicePool::failAll() {
+    for (const std::unique_ptr<Device>& device : devices) {
+        if (device->active) {
+            loop.cancelTimer(device->timeoutTimer);
+            std::unique_ptr<Challenge> challenge = std::move(device->active);
+            challenge->done(false);
+        }
+    }
+    while (!queue.empty()) {
+        std::unique_ptr<Challenge> challenge = std::move(queue.front());
+        queue.pop_front();
+        challenge->done(false);
+    }
+}
\ No newline at end of file
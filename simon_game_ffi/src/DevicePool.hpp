@@ -0,0 +1,131 @@
+#pragma once
+#include "EventLoop.hpp"
+#include "LineFramer.hpp"
+#include "SerialMonitor.hpp"
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fans Simon challenges out over several boards. Every board is serviced by
+// one EventLoop on a single pool thread; a board plays one challenge at a
+// time and the rest wait in a FIFO queue.
+//
+// A board that fails an I/O operation is dropped immediately and its
+// challenge handed to another board. A board that stays silent until the
+// challenge times out fails that challenge (the player may simply not have
+// finished) and is dropped after `maxMissedReplies` silent challenges in a
+// row. Dropped boards are reopened every `reconnectIntervalMs`.
+//
+// Replies carry no round number, so a board that timed out sits out
+// `lateReplyGraceMs` before its next challenge: a late answer to the round
+// that was given up on lands while it is idle and is ignored, and whatever
+// is still unread when the grace period ends is flushed.
+//
+// Given a shared EventLoop the pool starts no thread of its own: it runs on
+// whichever thread drives that loop, and must be created, used and
+// destroyed on that thread.
+class DevicePool {
+public:
+    using ChallengeCallback = std::function<void(bool success)>;
+
+    struct Options {
+        int challengeTimeoutMs = 5000;
+        int maxMissedReplies = 2;
+        int reconnectIntervalMs = 1000;
+        int lateReplyGraceMs = 1000;
+    };
+
+    struct DeviceStatus {
+        std::string port;
+        bool healthy;
+        bool busy;
+        uint64_t completed;
+        uint64_t failed;
+        uint64_t missed;
+        double averageLatencyMs;
+    };
+
+    DevicePool();
+    explicit DevicePool(const Options& options, EventLoop* sharedLoop = nullptr);
+    ~DevicePool();
+
+    DevicePool(const DevicePool&) = delete;
+    DevicePool& operator=(const DevicePool&) = delete;
+
+    // Opens the port and adds the board. Returns false, without adding it,
+    // if the port cannot be opened.
+    bool addDevice(const std::string& portName);
+
+    // Starts/stops the pool thread, or servicing the shared loop. Challenges
+    // submitted before start() wait for it; stop() fails every queued and
+    // running challenge.
+    bool start();
+    void stop();
+    bool isRunning() const { return running.load(); }
+
+    // Queues a challenge. `done` runs on the pool thread; on a shared loop it
+    // may run before submit() returns if no board is left.
+    void submit(int length, ChallengeCallback done);
+    std::future<bool> submit(int length);
+
+    // Blocks until the challenge completes. Must not be called from a
+    // ChallengeCallback, and always fails on a shared loop.
+    bool runChallenge(int length);
+
+    std::vector<DeviceStatus> status();
+    int healthyCount();
+
+private:
+    struct Challenge {
+        int length;
+        ChallengeCallback done;
+        int attempts;
+        uint64_t queuedAt;      // Trace::now() when queued, 0 if not tracing
+    };
+
+    struct Device {
+        std::unique_ptr<SerialMonitor> monitor;
+        LineFramer framer;
+        bool healthy;
+        std::unique_ptr<Challenge> active;
+        EventLoop::Clock::time_point sentAt;
+        EventLoop::TimerId timeoutTimer;
+        EventLoop::TimerId reconnectTimer;
+        EventLoop::TimerId graceTimer;      // non-zero while sitting out a timeout
+        int missedReplies;
+        uint64_t completed;
+        uint64_t failed;
+        uint64_t missed;
+        double averageLatencyMs;
+    };
+
+    bool onLoopThread() const;
+
+    // Everything below runs on the loop thread only
+    void attach(Device& device);
+    void dispatch();
+    Device* pickDevice();
+    void startOn(Device& device, std::unique_ptr<Challenge> challenge);
+    void onReadable(Device& device);
+    void handleLine(Device& device, const std::string& line);
+    void complete(Device& device, bool success);
+    void onTimeout(Device& device);
+    void endGrace(Device& device);
+    void dropDevice(Device& device, const std::string& reason);
+    void scheduleReconnect(Device& device);
+    void failAll();
+
+    Options options;
+    std::unique_ptr<EventLoop> ownedLoop;   // null on a shared loop
+    EventLoop& loop;
+    std::thread loopThread;
+    std::atomic<bool> running;
+
+    std::vector<std::unique_ptr<Device>> devices;
+    std::deque<std::unique_ptr<Challenge>> queue;
+};
\ No newline at end of file
@@ -0,0 +1,291 @@
+#include "EventChannel.hpp"
+#include "Logger.hpp"
+#include "Trace.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__) && !defined(_WIN32)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+
+namespace {
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared counters must be lock-free");
+    static_assert((EventChannel::CAPACITY & (EventChannel::CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+    const size_t PAYLOAD_WORDS = 7;
+    static_assert(sizeof(EventChannel::Event) == 64 && sizeof(EventChannel::Event) - 8 == PAYLOAD_WORDS * 8,
+                  "event payload must fill a slot");
+
+    struct SharedHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t capacity;
+        uint32_t slotSize;
+        std::atomic<uint32_t> wake;         // bumped on every publish; readers wait on it
+        std::atomic<uint32_t> waiters;
+    };
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> state;
+        std::atomic<uint64_t> words[PAYLOAD_WORDS];
+    };
+
+    struct Layout {
+        alignas(64) SharedHeader header;
+        alignas(64) std::atomic<uint64_t> head;
+        alignas(64) std::atomic<int64_t> status[EventChannel::STATUS_FIELDS];
+        Slot slots[EventChannel::CAPACITY];
+    };
+    static_assert(sizeof(Layout) == 64 * (3 + EventChannel::CAPACITY), "layout is part of the shared format");
+
+    uint64_t publishedState(uint64_t sequence) {
+        return 2 * (sequence + 1);
+    }
+
+    void wakeWaiters(std::atomic<uint32_t>& word) {
+#if defined(__linux__) && !defined(_WIN32)
+        // Not FUTEX_PRIVATE: readers may be in another process
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+#else
+        (void)word;
+#endif
+    }
+
+    void waitForWake(std::atomic<uint32_t>& word, uint32_t seen, int timeoutMs) {
+#if defined(__linux__) && !defined(_WIN32)
+        struct timespec timeout = { timeoutMs / 1000, (timeoutMs % 1000) * 1000000L };
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, seen, &timeout, nullptr, 0);
+#else
+        // No cross-process wait primitive to lean on; poll
+        (void)seen;
+        if (word.load() == seen) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeoutMs, 1)));
+        }
+#endif
+    }
+}
+
+struct EventChannel::Region {
+    Layout* layout;
+    size_t size;
+    int fd;
+};
+
+std::atomic<EventChannel::Region*> EventChannel::channel(nullptr);
+
+bool EventChannel::open() {
+    static std::mutex openMutex;
+    std::lock_guard<std::mutex> lock(openMutex);
+    if (channel.load() != nullptr) {
+        return true;
+    }
+
+    size_t size = sizeof(Layout);
+    void* memory = nullptr;
+    int fd = -1;
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, static_cast<DWORD>(size), NULL);
+    if (mapping == NULL) {
+        LOG_ERROR("Failed to create event channel mapping, GetLastError: " + std::to_string(GetLastError()));
+        return false;
+    }
+    memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (memory == NULL) {
+        LOG_ERROR("Failed to map event channel, GetLastError: " + std::to_string(GetLastError()));
+        CloseHandle(mapping);
+        return false;
+    }
+#else
+#ifdef __linux__
+    fd = static_cast<int>(syscall(SYS_memfd_create, "simon-events", 1u /* MFD_CLOEXEC */));
+    if (fd >= 0 && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+#endif
+    memory = fd >= 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                     : mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        LOG_ERROR("Failed to map event channel: " + std::string(strerror(errno)));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+#endif
+
+    // Fresh mappings are zeroed, which is the empty state of every slot
+    Layout* layout = new (memory) Layout;
+    layout->header.magic = MAGIC;
+    layout->header.version = VERSION;
+    layout->header.capacity = CAPACITY;
+    layout->header.slotSize = sizeof(Slot);
+
+    channel.store(new Region{ layout, size, fd }, std::memory_order_release);
+    LOG_INFO("Event channel open: " + std::to_string(CAPACITY) + " slots, " + std::to_string(size) + " bytes" +
+             (fd >= 0 ? ", memfd " + std::to_string(fd) : std::string()));
+    return true;
+}
+
+void EventChannel::publish(Type type, int32_t key, int32_t value, int32_t detail, const char* text) {
+    Region* region = channel.load(std::memory_order_acquire);
+    if (region == nullptr) {
+        return;
+    }
+    Layout& layout = *region->layout;
+
+    Event event;
+    event.timeNs = Trace::now();
+    event.type = type;
+    event.key = key;
+    event.value = value;
+    event.detail = detail;
+    std::memset(event.text, 0, TEXT_SIZE);
+    if (text != nullptr) {
+        std::strncpy(event.text, text, TEXT_SIZE - 1);
+    }
+    uint64_t words[PAYLOAD_WORDS];
+    std::memcpy(words, reinterpret_cast<const char*>(&event) + 8, sizeof(words));
+
+    uint64_t sequence = layout.head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = layout.slots[sequence & (CAPACITY - 1)];
+
+    // The slot's previous lap must be fully written before it is reused; a
+    // producer only waits here if another one is a whole ring behind
+    uint64_t previous = sequence < CAPACITY ? 0 : publishedState(sequence - CAPACITY);
+    while (!slot.state.compare_exchange_weak(previous, publishedState(sequence) - 1, std::memory_order_relaxed)) {
+        previous = sequence < CAPACITY ? 0 : publishedState(sequence - CAPACITY);
+        std::this_thread::yield();
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < PAYLOAD_WORDS; i++) {
+        slot.words[i].store(words[i], std::memory_order_relaxed);
+    }
+    slot.state.store(publishedState(sequence), std::memory_order_release);
+
+    layout.header.wake.fetch_add(1);
+    if (layout.header.waiters.load() > 0) {
+        wakeWaiters(layout.header.wake);
+    }
+}
+
+void EventChannel::addStatus(Status field, int64_t delta) {
+    Region* region = channel.load(std::memory_order_acquire);
+    if (region != nullptr) {
+        region->layout->status[field].fetch_add(delta, std::memory_order_relaxed);
+    }
+}
+
+void EventChannel::setStatus(Status field, int64_t value) {
+    Region* region = channel.load(std::memory_order_acquire);
+    if (region != nullptr) {
+        region->layout->status[field].store(value, std::memory_order_relaxed);
+    }
+}
+
+int64_t EventChannel::status(Status field) {
+    Region* region = channel.load(std::memory_order_acquire);
+    return region ? region->layout->status[field].load(std::memory_order_relaxed) : 0;
+}
+
+int EventChannel::fd() {
+    Region* region = channel.load(std::memory_order_acquire);
+    return region ? region->fd : -1;
+}
+
+const void* EventChannel::region(size_t& size) {
+    Region* region = channel.load(std::memory_order_acquire);
+    size = region ? region->size : 0;
+    return region ? region->layout : nullptr;
+}
+
+EventChannel::Subscription::Subscription() : cursor(0), missed(0) {
+    if (open()) {
+        cursor = channel.load()->layout->head.load(std::memory_order_acquire);
+    }
+}
+
+bool EventChannel::Subscription::next(Event& event) {
+    Region* region = channel.load(std::memory_order_acquire);
+    if (region == nullptr) {
+        return false;
+    }
+    Layout& layout = *region->layout;
+
+    while (true) {
+        uint64_t head = layout.head.load(std::memory_order_acquire);
+        if (cursor >= head) {
+            return false;
+        }
+        if (head - cursor > CAPACITY) {
+            missed += head - CAPACITY - cursor;
+            cursor = head - CAPACITY;
+        }
+
+        Slot& slot = layout.slots[cursor & (CAPACITY - 1)];
+        uint64_t expected = publishedState(cursor);
+        uint64_t before = slot.state.load(std::memory_order_acquire);
+        if (before < expected) {
+            // Claimed but not written yet; events are delivered in order
+            return false;
+        }
+
+        uint64_t words[PAYLOAD_WORDS];
+        for (size_t i = 0; i < PAYLOAD_WORDS; i++) {
+            words[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = slot.state.load(std::memory_order_relaxed);
+
+        if (before != expected || after != expected) {
+            // Overwritten by a later lap before or while we read it
+            missed++;
+            cursor++;
+            continue;
+        }
+
+        event.sequence = cursor++;
+        std::memcpy(reinterpret_cast<char*>(&event) + 8, words, sizeof(words));
+        return true;
+    }
+}
+
+bool EventChannel::Subscription::wait(int timeoutMs) {
+    Region* region = channel.load(std::memory_order_acquire);
+    if (region == nullptr) {
+        return false;
+    }
+    SharedHeader& header = region->layout->header;
+    std::atomic<uint64_t>& head = region->layout->head;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(timeoutMs, 0));
+    header.waiters.fetch_add(1);
+    bool ready = false;
+    while (true) {
+        uint32_t seen = header.wake.load();
+        if (head.load(std::memory_order_acquire) > cursor) {
+            ready = true;
+            break;
+        }
+        auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+            break;
+        }
+        waitForWake(header.wake, seen, static_cast<int>(remaining));
+    }
+    header.waiters.fetch_sub(1);
+    return ready;
+}
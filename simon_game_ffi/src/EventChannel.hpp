@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Challenge events, device state and headline counters published into one
+// shared-memory region (a memfd on Linux), so a UI can follow them with
+// plain loads instead of FFI calls and callbacks.
+//
+// Events go into a ring of CAPACITY slots. A producer claims a sequence
+// number with one fetch_add and writes its slot seqlock-style; readers keep
+// their own cursor and only touch the region to register as a waiter, so a
+// slow reader misses events but never holds up the middleware. Until open()
+// is called publishing costs one load.
+//
+// Region layout (version 1), all integers little-endian as in memory:
+//
+//   Header   64 bytes: magic "SIMV", version, capacity, slot size, then the
+//            futex word and waiter count
+//   head     64 bytes: next sequence to claim (uint64)
+//   status   64 bytes: STATUS_FIELDS int64 counters (see Status)
+//   slots    CAPACITY x 64 bytes: uint64 state, then the Event payload.
+//            state is 2 * (sequence + 1) once sequence is written, odd
+//            while a producer is writing it.
+class EventChannel {
+public:
+    static constexpr uint32_t MAGIC = 0x564D4953;      // "SIMV"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t CAPACITY = 4096;
+    static constexpr size_t TEXT_SIZE = 32;
+
+    enum Type : int32_t {
+        CHALLENGE_STARTED = 1,      // key, value = length, detail = 1 if speculative
+        CHALLENGE_FINISHED = 2,     // key, value = 1 pass / 0 fail, detail = duration in ms
+        DEVICE_CONNECTED = 3,       // text = port
+        DEVICE_DISCONNECTED = 4     // text = port
+    };
+
+    enum Status {
+        CHALLENGES_SUCCEEDED = 0,
+        CHALLENGES_FAILED = 1,
+        CHALLENGES_IN_FLIGHT = 2,
+        DEVICES_CONNECTED = 3,
+        LAST_CHALLENGE_LENGTH = 4,
+        STATUS_FIELDS = 8
+    };
+
+    // Mirrors simon_event_t
+    struct Event {
+        uint64_t sequence;
+        uint64_t timeNs;            // steady clock, as Trace::now()
+        int32_t type;
+        int32_t key;
+        int32_t value;
+        int32_t detail;
+        char text[TEXT_SIZE];
+    };
+
+    // Maps the region on first call; later calls return the same one. It is
+    // never unmapped, since producers may be writing to it at any time.
+    static bool open();
+    static bool isOpen() { return channel.load(std::memory_order_relaxed) != nullptr; }
+
+    static void publish(Type type, int32_t key, int32_t value, int32_t detail = 0, const char* text = nullptr);
+    static void addStatus(Status field, int64_t delta);
+    static void setStatus(Status field, int64_t value);
+    static int64_t status(Status field);
+
+    // The memfd backing the region, for handing to another process (Linux
+    // only, -1 elsewhere), and the mapping itself
+    static int fd();
+    static const void* region(size_t& size);
+
+    // One reader's position in the ring; starts at the next event published
+    class Subscription {
+    public:
+        Subscription();
+
+        // Copies out the next event, if one has been published
+        bool next(Event& event);
+        // Blocks until an event is available or `timeoutMs` passes
+        bool wait(int timeoutMs);
+        // Events overwritten before this reader got to them
+        uint64_t dropped() const { return missed; }
+
+    private:
+        uint64_t cursor;
+        uint64_t missed;
+    };
+
+private:
+    struct Region;
+    static std::atomic<Region*> channel;
+};
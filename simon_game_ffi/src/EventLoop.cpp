@@ -0,0 +1,212 @@
+#include "EventLoop.hpp"
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+EventLoop::EventLoop() : nextTimerId(1), stopRequested(false) {
+#ifdef _WIN32
+    wakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (wakeEvent == NULL) {
+        throw std::runtime_error("failed to create event loop wake event");
+    }
+#else
+    if (pipe(wakePipe) != 0) {
+        throw std::runtime_error("failed to create event loop wake pipe");
+    }
+    for (int fd : wakePipe) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+}
+
+EventLoop::~EventLoop() {
+#ifdef _WIN32
+    CloseHandle(wakeEvent);
+#else
+    close(wakePipe[0]);
+    close(wakePipe[1]);
+#endif
+}
+
+void EventLoop::watch(SerialMonitor::NativeHandle handle, Callback onReady) {
+    unwatch(handle);
+    watches.push_back(Watch{ handle, std::move(onReady) });
+}
+
+void EventLoop::unwatch(SerialMonitor::NativeHandle handle) {
+    watches.erase(std::remove_if(watches.begin(), watches.end(),
+        [handle](const Watch& w) { return w.handle == handle; }), watches.end());
+}
+
+EventLoop::TimerId EventLoop::addTimer(Clock::time_point when, Callback callback) {
+    TimerId id = nextTimerId++;
+    timers.emplace(std::make_pair(when, id), std::move(callback));
+    timerIndex.emplace(id, when);
+    return id;
+}
+
+void EventLoop::cancelTimer(TimerId id) {
+    auto it = timerIndex.find(id);
+    if (it == timerIndex.end()) {
+        return;
+    }
+    timers.erase(std::make_pair(it->second, id));
+    timerIndex.erase(it);
+}
+
+void EventLoop::post(Callback callback) {
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        posted.push_back(std::move(callback));
+    }
+    signalWake();
+}
+
+void EventLoop::signalWake() {
+#ifdef _WIN32
+    SetEvent(wakeEvent);
+#else
+    char byte = 1;
+    // A full pipe already guarantees a wake-up
+    ssize_t ignored = write(wakePipe[1], &byte, 1);
+    (void)ignored;
+#endif
+}
+
+void EventLoop::drainWake() {
+#ifndef _WIN32
+    char buffer[64];
+    while (read(wakePipe[0], buffer, sizeof(buffer)) > 0) {
+    }
+#endif
+}
+
+void EventLoop::pollHandles(std::vector<SerialMonitor::NativeHandle>& handles) const {
+    handles.clear();
+#ifndef _WIN32
+    handles.push_back(wakePipe[0]);
+    for (const Watch& w : watches) {
+        handles.push_back(w.handle);
+    }
+#endif
+}
+
+EventLoop::Clock::time_point EventLoop::nextDeadline() {
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        if (!posted.empty()) {
+            return Clock::time_point::min();
+        }
+    }
+    Clock::time_point until = timers.empty() ? Clock::time_point::max() : timers.begin()->first.first;
+#ifdef _WIN32
+    // Ports cannot be waited on here either, so they are polled
+    if (!watches.empty()) {
+        until = std::min(until, Clock::now() + std::chrono::milliseconds(POLL_INTERVAL_MS));
+    }
+#endif
+    return until;
+}
+
+void EventLoop::wait(Clock::time_point deadline) {
+    Clock::time_point until = std::min(deadline, nextDeadline());
+
+    // Rounded up so a timer is never woken for early
+    int timeoutMs = -1;
+    if (until != Clock::time_point::max()) {
+        Clock::time_point now = Clock::now();
+        long long us = until > now ? std::chrono::duration_cast<std::chrono::microseconds>(until - now).count() : 0;
+        timeoutMs = static_cast<int>(std::min<long long>((us + 999) / 1000, INT_MAX));
+    }
+
+    readyHandles.clear();
+
+#ifdef _WIN32
+    DWORD waitMs = timeoutMs < 0 ? INFINITE : static_cast<DWORD>(timeoutMs);
+    if (!watches.empty() && (waitMs == INFINITE || waitMs > POLL_INTERVAL_MS)) {
+        waitMs = POLL_INTERVAL_MS;
+    }
+    WaitForSingleObject(wakeEvent, waitMs);
+    for (const Watch& w : watches) {
+        readyHandles.push_back(w.handle);
+    }
+#else
+    std::vector<pollfd> fds;
+    fds.reserve(watches.size() + 1);
+    fds.push_back(pollfd{ wakePipe[0], POLLIN, 0 });
+    for (const Watch& w : watches) {
+        fds.push_back(pollfd{ w.handle, POLLIN, 0 });
+    }
+
+    int ready = poll(fds.data(), fds.size(), timeoutMs);
+    if (ready <= 0) {
+        return;
+    }
+    if (fds[0].revents) {
+        drainWake();
+    }
+    for (size_t i = 1; i < fds.size(); i++) {
+        if (fds[i].revents) {
+            readyHandles.push_back(fds[i].fd);
+        }
+    }
+#endif
+}
+
+void EventLoop::runPosted() {
+    std::vector<Callback> batch;
+    {
+        std::lock_guard<std::mutex> lock(postedMutex);
+        batch.swap(posted);
+    }
+    for (Callback& callback : batch) {
+        callback();
+    }
+}
+
+void EventLoop::runTimers() {
+    Clock::time_point now = Clock::now();
+    while (!timers.empty() && timers.begin()->first.first <= now) {
+        auto due = timers.begin();
+        Callback callback = std::move(due->second);
+        timerIndex.erase(due->first.second);
+        timers.erase(due);
+        callback();
+    }
+}
+
+void EventLoop::runOnce(Clock::time_point deadline) {
+    wait(deadline);
+    runPosted();
+
+    // Callbacks may unwatch other ports, so re-check each one and call a copy
+    for (SerialMonitor::NativeHandle handle : std::vector<SerialMonitor::NativeHandle>(readyHandles)) {
+        auto it = std::find_if(watches.begin(), watches.end(),
+            [handle](const Watch& w) { return w.handle == handle; });
+        if (it != watches.end()) {
+            Callback callback = it->callback;
+            callback();
+        }
+    }
+
+    runTimers();
+}
+
+void EventLoop::run() {
+    while (!stopRequested) {
+        runOnce(Clock::time_point::max());
+    }
+    stopRequested = false;
+}
+
+void EventLoop::stop() {
+    stopRequested = true;
+    signalWake();
+}
\ No newline at end of file
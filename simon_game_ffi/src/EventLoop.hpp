@@ -0,0 +1,94 @@
+#pragma once
+#include "SerialMonitor.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Single-threaded reactor over serial ports and timers. Callbacks run on the
+// thread calling run()/runOnce(); post() and stop() are the only members
+// that may be called from other threads.
+//
+// On POSIX the ports are multiplexed with poll(). Windows serial handles are
+// not waitable for "data available" without overlapped I/O, so there the
+// loop wakes every POLL_INTERVAL_MS while ports are watched and lets each
+// callback do a non-blocking read.
+class EventLoop {
+public:
+    using Callback = std::function<void()>;
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint64_t;
+
+    static constexpr int POLL_INTERVAL_MS = 2;
+
+    EventLoop();
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // `onReady` runs when the port has data or has failed; it is expected to
+    // drain the port with SerialMonitor::readAvailable.
+    void watch(SerialMonitor::NativeHandle handle, Callback onReady);
+    void unwatch(SerialMonitor::NativeHandle handle);
+
+    TimerId addTimer(Clock::time_point when, Callback callback);
+    void cancelTimer(TimerId id);
+
+    // Queues `callback` to run on the loop thread and wakes the loop
+    void post(Callback callback);
+
+    // Waits for ready ports, due timers or posted work, but no later than
+    // `deadline`, and dispatches everything that is ready.
+    void runOnce(Clock::time_point deadline);
+
+    // Dispatches until stop() is called
+    void run();
+    void stop();
+
+    // For running the loop from a caller's own poll/epoll loop: wait for
+    // these handles to become readable (POSIX only; the wake pipe comes
+    // first) or for nextDeadline(), then call runOnce() with a deadline that
+    // has already passed. The set changes as ports come and go, so fetch it
+    // again after each dispatch.
+    void pollHandles(std::vector<SerialMonitor::NativeHandle>& handles) const;
+    Clock::time_point nextDeadline();
+#ifdef _WIN32
+    // The Windows counterpart of the wake pipe: an auto-reset event that
+    // post() signals, for WaitForMultipleObjects next to nextDeadline()
+    HANDLE wakeHandle() const { return wakeEvent; }
+#endif
+
+private:
+    struct Watch {
+        SerialMonitor::NativeHandle handle;
+        Callback callback;
+    };
+
+    void wait(Clock::time_point deadline);
+    void signalWake();
+    void drainWake();
+    void runPosted();
+    void runTimers();
+
+    std::vector<Watch> watches;
+    std::vector<SerialMonitor::NativeHandle> readyHandles;
+
+    std::map<std::pair<Clock::time_point, TimerId>, Callback> timers;
+    std::unordered_map<TimerId, Clock::time_point> timerIndex;
+    TimerId nextTimerId;
+
+    std::mutex postedMutex;
+    std::vector<Callback> posted;
+    std::atomic<bool> stopRequested;
+
+#ifdef _WIN32
+    HANDLE wakeEvent;
+#else
+    int wakePipe[2];
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "ForegroundScope.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <cctype>
+
+#ifdef _WIN32
+ForegroundScope::ForegroundScope() : currentWindow(NULL), gated(true) {
+}
+#else
+ForegroundScope::ForegroundScope() : gated(true) {
+}
+#endif
+
+std::string ForegroundScope::toLower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return value;
+}
+
+void ForegroundScope::addProcess(const std::string& exeName) {
+    std::lock_guard<std::mutex> lock(mutex);
+    processNames.push_back(toLower(exeName));
+    evaluateLocked();
+    LOG_INFO("Key gating scoped to process: " + exeName);
+}
+
+void ForegroundScope::addWindowClass(const std::string& className) {
+    std::lock_guard<std::mutex> lock(mutex);
+    windowClasses.push_back(toLower(className));
+    evaluateLocked();
+    LOG_INFO("Key gating scoped to window class: " + className);
+}
+
+void ForegroundScope::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    processNames.clear();
+    windowClasses.clear();
+    evaluateLocked();
+    LOG_INFO("Key gating scopes cleared");
+}
+
+void ForegroundScope::replace(const std::vector<std::string>& exeNames, const std::vector<std::string>& classNames) {
+    std::vector<std::string> processes;
+    std::vector<std::string> classes;
+    for (const std::string& name : exeNames) {
+        processes.push_back(toLower(name));
+    }
+    for (const std::string& name : classNames) {
+        classes.push_back(toLower(name));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    processNames.swap(processes);
+    windowClasses.swap(classes);
+    evaluateLocked();
+    LOG_INFO("Key gating scoped to " + std::to_string(processNames.size()) + " process(es) and " +
+             std::to_string(windowClasses.size()) + " window class(es)");
+}
+
+#ifdef _WIN32
+void ForegroundScope::update(HWND foreground) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (foreground == currentWindow && foreground != NULL) {
+            return;
+        }
+    }
+
+    std::string process;
+    std::string windowClass;
+
+    if (foreground != NULL) {
+        DWORD pid = 0;
+        GetWindowThreadProcessId(foreground, &pid);
+        if (pid != 0) {
+            HANDLE processHandle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+            if (processHandle != NULL) {
+                char path[MAX_PATH] = {0};
+                DWORD size = MAX_PATH;
+                if (QueryFullProcessImageNameA(processHandle, 0, path, &size)) {
+                    process.assign(path, size);
+                    auto pos = process.find_last_of("/\\");
+                    if (pos != std::string::npos) {
+                        process = process.substr(pos + 1);
+                    }
+                }
+                CloseHandle(processHandle);
+            }
+        }
+
+        char className[256] = {0};
+        int length = GetClassNameA(foreground, className, sizeof(className));
+        if (length > 0) {
+            windowClass.assign(className, length);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentWindow = foreground;
+    }
+    update(process, windowClass);
+}
+#endif
+
+void ForegroundScope::update(const std::string& process, const std::string& windowClass) {
+    std::lock_guard<std::mutex> lock(mutex);
+    currentProcess = toLower(process);
+    currentClass = toLower(windowClass);
+    evaluateLocked();
+    LOG_DEBUG("Foreground changed to process: " + process + ", class: " + windowClass +
+              (gated ? " (gated)" : " (not gated)"));
+}
+
+void ForegroundScope::evaluateLocked() {
+    bool matched = processNames.empty() && windowClasses.empty();
+    if (!matched) {
+        matched = std::find(processNames.begin(), processNames.end(), currentProcess) != processNames.end() ||
+                  std::find(windowClasses.begin(), windowClasses.end(), currentClass) != windowClasses.end();
+    }
+    gated.store(matched, std::memory_order_relaxed);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Restricts key gating to particular foreground processes or window classes.
+// The foreground window is resolved once per foreground change and the
+// verdict cached, so the keyboard hook only reads a flag.
+class ForegroundScope {
+public:
+    ForegroundScope();
+
+    // Names are matched case-insensitively; processes by executable file
+    // name (e.g. "explorer.exe"). With no rules, every window is gated.
+    void addProcess(const std::string& exeName);
+    void addWindowClass(const std::string& className);
+    void clear();
+    // Swaps in a whole rule set at once
+    void replace(const std::vector<std::string>& exeNames, const std::vector<std::string>& classNames);
+
+#ifdef _WIN32
+    void update(HWND foreground);
+#endif
+    // For platforms where the caller resolves the foreground itself
+    void update(const std::string& process, const std::string& windowClass);
+    bool isGated() const { return gated.load(std::memory_order_relaxed); }
+
+private:
+    static std::string toLower(std::string value);
+    void evaluateLocked();
+
+    mutable std::mutex mutex;
+    std::vector<std::string> processNames;
+    std::vector<std::string> windowClasses;
+#ifdef _WIN32
+    HWND currentWindow;
+#endif
+    std::string currentProcess;
+    std::string currentClass;
+    std::atomic<bool> gated;
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+
+// A keyboard event as seen by the gating logic, independent of where it was
+// captured. Key codes use Windows virtual-key numbering on every platform,
+// which is also what the C API takes.
+struct KeyEvent {
+    uint16_t vkCode;
+    uint16_t scanCode;
+    uint32_t time;          // milliseconds on a monotonic clock
+    bool keyUp;
+    bool extended;          // extended-key flag, needed to replay arrows etc.
+};
+
+namespace KeyCodes {
+    constexpr uint16_t LSHIFT   = 0xA0;
+    constexpr uint16_t RSHIFT   = 0xA1;
+    constexpr uint16_t LCONTROL = 0xA2;
+    constexpr uint16_t RCONTROL = 0xA3;
+    constexpr uint16_t LMENU    = 0xA4;
+    constexpr uint16_t RMENU    = 0xA5;
+    constexpr uint16_t LWIN     = 0x5B;
+    constexpr uint16_t RWIN     = 0x5C;
+}
\ No newline at end of file
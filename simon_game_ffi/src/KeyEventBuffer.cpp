@@ -0,0 +1,53 @@
+#include "KeyEventBuffer.hpp"
+
+KeyEventBuffer::KeyEventBuffer(size_t capacity)
+    : events(capacity > 0 ? capacity : DEFAULT_CAPACITY), head(0), count(0), heldCount(0) {
+}
+
+void KeyEventBuffer::setCapacity(size_t capacity) {
+    clear();
+    events.assign(capacity > 0 ? capacity : DEFAULT_CAPACITY, KeyEvent{});
+}
+
+bool KeyEventBuffer::push(const KeyEvent& event) {
+    size_t vk = event.vkCode & 0xFF;
+
+    if (event.keyUp) {
+        if (!held.test(vk)) {
+            return false;
+        }
+        held.reset(vk);
+        heldCount--;
+    } else if (count + heldCount >= events.size()) {
+        return false;
+    } else if (!held.test(vk)) {
+        held.set(vk);
+        heldCount++;
+    }
+
+    events[(head + count) % events.size()] = event;
+    count++;
+    return true;
+}
+
+void KeyEventBuffer::drainTo(std::vector<KeyEvent>& out) {
+    out.reserve(out.size() + count);
+
+    for (size_t i = 0; i < count; i++) {
+        out.push_back(events[(head + i) % events.size()]);
+    }
+
+    head = 0;
+    count = 0;
+}
+
+uint32_t KeyEventBuffer::oldestTime() const {
+    return count > 0 ? events[head].time : 0;
+}
+
+void KeyEventBuffer::clear() {
+    head = 0;
+    count = 0;
+    heldCount = 0;
+    held.reset();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "KeyEvent.hpp"
+#include <bitset>
+#include <cstddef>
+#include <vector>
+
+// Bounded FIFO of keyboard events that were held back by the hook while a
+// Simon challenge is pending. Not thread-safe; the middleware guards it.
+class KeyEventBuffer {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 128;
+
+    explicit KeyEventBuffer(size_t capacity = DEFAULT_CAPACITY);
+
+    void setCapacity(size_t capacity);
+    size_t capacity() const { return events.size(); }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Returns false if the event was not taken. A key-up is only taken when
+    // its key-down is in the buffer, and every buffered key-down keeps a slot
+    // free for its key-up so a replay never leaves a key stuck down.
+    bool push(const KeyEvent& event);
+
+    // Moves all buffered events into `out`, oldest first, and empties the
+    // buffer.
+    void drainTo(std::vector<KeyEvent>& out);
+
+    // Timestamp (hook time, ms) of the oldest buffered event.
+    uint32_t oldestTime() const;
+
+    void clear();
+
+private:
+    std::vector<KeyEvent> events;
+    size_t head;
+    size_t count;
+    size_t heldCount;
+    std::bitset<256> held;
+};
@@ -0,0 +1,92 @@
+#include "LatencyHistogram.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    const uint64_t LINEAR_LIMIT = 1ull << LatencyHistogram::SUB_BUCKET_BITS;
+    const uint64_t HALF_SUB_BUCKETS = LINEAR_LIMIT / 2;
+
+    unsigned highestBit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+        unsigned bit = 0;
+        while (value >>= 1) {
+            bit++;
+        }
+        return bit;
+#endif
+    }
+}
+
+LatencyHistogram::LatencyHistogram()
+    : counts(BUCKET_COUNT, 0), total(0), minValue(std::numeric_limits<uint64_t>::max()), maxValue(0), sum(0) {
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value) {
+    // Below LINEAR_LIMIT every value has its own bucket. Above it, each
+    // power of two is split into HALF_SUB_BUCKETS buckets by the value's
+    // top SUB_BUCKET_BITS - 1 bits below the leading one.
+    if (value < LINEAR_LIMIT) {
+        return static_cast<size_t>(value);
+    }
+    unsigned shift = highestBit(value) - (SUB_BUCKET_BITS - 1);
+    uint64_t subBucket = value >> shift;
+    return static_cast<size_t>(LINEAR_LIMIT + (shift - 1) * HALF_SUB_BUCKETS + (subBucket - HALF_SUB_BUCKETS));
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < LINEAR_LIMIT) {
+        return index;
+    }
+    uint64_t offset = index - LINEAR_LIMIT;
+    unsigned shift = static_cast<unsigned>(offset / HALF_SUB_BUCKETS) + 1;
+    uint64_t subBucket = offset % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+    uint64_t next = (subBucket + 1) << shift;
+    return next == 0 ? std::numeric_limits<uint64_t>::max() : next - 1;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    counts[bucketIndex(value)]++;
+    total++;
+    sum += value;
+    minValue = std::min(minValue, value);
+    maxValue = std::max(maxValue, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        counts[i] += other.counts[i];
+    }
+    total += other.total;
+    sum += other.sum;
+    minValue = std::min(minValue, other.minValue);
+    maxValue = std::max(maxValue, other.maxValue);
+}
+
+void LatencyHistogram::reset() {
+    std::fill(counts.begin(), counts.end(), 0);
+    total = 0;
+    sum = 0;
+    minValue = std::numeric_limits<uint64_t>::max();
+    maxValue = 0;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (total == 0) {
+        return 0;
+    }
+
+    p = std::min(std::max(p, 0.0), 1.0);
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * total)));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return std::min(bucketUpperBound(i), maxValue);
+        }
+    }
+    return maxValue;
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// HDR-style latency histogram: log-linear buckets with 64 sub-buckets per
+// power of two, so any recorded value is reproduced within 1/64 (~1.6%)
+// across the full 64-bit range, with a fixed 30 KB footprint and O(1)
+// recording. Values are unit-less; callers typically record nanoseconds.
+// Not thread-safe; keep one per thread and merge().
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 7;
+    static constexpr size_t BUCKET_COUNT = (1u << SUB_BUCKET_BITS) + (64 - SUB_BUCKET_BITS) * (1u << (SUB_BUCKET_BITS - 1));
+
+    LatencyHistogram();
+
+    void record(uint64_t value);
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? minValue : 0; }
+    uint64_t max() const { return maxValue; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+
+    // Smallest value v such that at least `p` (0..1) of the recordings are
+    // <= v, rounded up to its bucket's upper edge and capped at max().
+    uint64_t percentile(double p) const;
+
+    static size_t bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(size_t index);
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t minValue;
+    uint64_t maxValue;
+    uint64_t sum;
+};
\ No newline at end of file
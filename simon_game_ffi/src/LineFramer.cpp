@@ -0,0 +1,83 @@
+#include "LineFramer.hpp"
+#include <cstring>
+#include <string_view>
+
+LineFramer::LineFramer() : consumed(0), scanned(0), committed(0) {
+}
+
+void LineFramer::append(const char* data, size_t length) {
+    compact();
+    buffer.append(data, length);
+}
+
+char* LineFramer::prepare(size_t length) {
+    compact();
+    committed = buffer.size();
+    buffer.resize(committed + length);
+    return &buffer[committed];
+}
+
+void LineFramer::commit(size_t used) {
+    buffer.resize(committed + used);
+}
+
+bool LineFramer::nextLine(std::string& line) {
+    View view;
+    if (!nextView(view)) {
+        return false;
+    }
+    line.assign(view.data, view.length);
+    return true;
+}
+
+bool LineFramer::nextView(View& view) {
+    // `scanned` remembers how far a previous call already looked, so a line
+    // that arrives byte by byte is not rescanned from its start every time
+    size_t newline = buffer.find('\n', scanned);
+    if (newline == std::string::npos) {
+        scanned = buffer.size();
+        return false;
+    }
+
+    size_t end = newline;
+    if (end > consumed && buffer[end - 1] == '\r') {
+        end--;
+    }
+    view.data = buffer.data() + consumed;
+    view.length = end - consumed;
+    consumed = newline + 1;
+    scanned = consumed;
+    return true;
+}
+
+size_t LineFramer::pending() const {
+    // Nothing between `consumed` and `scanned` is a newline, so only the
+    // unscanned rest can end a line
+    std::string_view unscanned(buffer.data() + scanned, buffer.size() - scanned);
+    size_t newline = unscanned.rfind('\n');
+    return newline == std::string_view::npos ? unread() : unscanned.size() - newline - 1;
+}
+
+size_t LineFramer::take(char* out, size_t capacity) {
+    size_t count = unread() < capacity ? unread() : capacity;
+    std::memcpy(out, buffer.data() + consumed, count);
+    consumed += count;
+    if (scanned < consumed) {
+        scanned = consumed;
+    }
+    return count;
+}
+
+void LineFramer::compact() {
+    if (consumed > 0) {
+        buffer.erase(0, consumed);
+        scanned -= consumed;
+        consumed = 0;
+    }
+}
+
+void LineFramer::clear() {
+    buffer.clear();
+    consumed = 0;
+    scanned = 0;
+}
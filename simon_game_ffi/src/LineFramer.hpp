@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Splits a serial byte stream into newline-terminated lines. Consumed lines
+// are skipped by offset and the buffer is compacted only when more data
+// arrives, so draining a burst of lines does not shift the buffer per line.
+// Not thread-safe.
+class LineFramer {
+public:
+    // A line inside the framer's buffer, without its terminator
+    struct View {
+        const char* data;
+        size_t length;
+    };
+
+    LineFramer();
+
+    void append(const char* data, size_t length);
+
+    // Room for `length` more bytes, for reading straight into the buffer;
+    // commit() then keeps the first `used` of them. Invalidates views.
+    char* prepare(size_t length);
+    void commit(size_t used);
+
+    // Moves the next complete line, without its "\n" or "\r\n", into `line`.
+    // Returns false if no complete line is buffered.
+    bool nextLine(std::string& line);
+
+    // Like nextLine, but points `view` into the buffer instead of copying.
+    // The view stays valid until the next append, prepare, compact or clear.
+    bool nextView(View& view);
+
+    // Moves up to `capacity` unframed bytes out, oldest first, for callers
+    // reading the raw stream. Returns the count.
+    size_t take(char* out, size_t capacity);
+
+    // Bytes after the last complete line, i.e. the start of a line still
+    // waiting for its terminator. Lines buffered but not yet taken do not
+    // count.
+    size_t pending() const;
+    // Every byte not yet taken, complete lines included
+    size_t unread() const { return buffer.size() - consumed; }
+
+    // Reclaims the space of consumed lines now rather than on the next append
+    void compact();
+    void clear();
+
+private:
+    std::string buffer;
+    size_t consumed;
+    size_t scanned;
+    size_t committed;   // buffer size before the last prepare()
+};
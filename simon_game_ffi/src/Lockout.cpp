@@ -0,0 +1,210 @@
+#include "Lockout.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    const char* const STATE_HEADER = "simon-lockout 1";
+}
+
+Lockout::Lockout() : enabled(false), bucketMs(1), lockedUntilMs(0) {
+}
+
+bool Lockout::configure(const Policy& settings) {
+    if (settings.stepsMs.empty() || settings.windowMs < BUCKETS ||
+        (settings.keyThreshold == 0 && settings.deviceThreshold == 0)) {
+        return false;
+    }
+
+    enabled = true;
+    policy = settings;
+    bucketMs = settings.windowMs / BUCKETS;
+    keys.fill(Counter());
+    device = Counter();
+    lockedUntilMs = 0;
+    return true;
+}
+
+void Lockout::disable() {
+    enabled = false;
+    lockedUntilMs = 0;
+}
+
+uint32_t Lockout::recordFailure(uint16_t key, int64_t now) {
+    if (!enabled) {
+        return 0;
+    }
+
+    Counter& keyCounter = keys[key & 0xFF];
+    count(keyCounter, now);
+    count(device, now);
+
+    uint32_t lockMs = std::max(escalate(keyCounter, policy.keyThreshold),
+                               escalate(device, policy.deviceThreshold));
+    if (lockMs > 0) {
+        lockedUntilMs = std::max(lockedUntilMs, now + lockMs);
+    }
+    return lockMs;
+}
+
+int64_t Lockout::remainingMs(int64_t now) const {
+    return enabled && lockedUntilMs > now ? lockedUntilMs - now : 0;
+}
+
+int Lockout::keyStep(uint16_t key, int64_t now) const {
+    return static_cast<int>(decayedStep(keys[key & 0xFF], now));
+}
+
+int Lockout::deviceStep(int64_t now) const {
+    return static_cast<int>(decayedStep(device, now));
+}
+
+uint32_t Lockout::decayedStep(const Counter& counter, int64_t now) const {
+    int64_t quietMs = now - counter.lastFailureMs;
+    if (counter.step == 0 || policy.decayMs == 0 || quietMs <= 0) {
+        return counter.step;
+    }
+    int64_t drops = quietMs / policy.decayMs;
+    return drops >= counter.step ? 0 : counter.step - static_cast<uint32_t>(drops);
+}
+
+void Lockout::count(Counter& counter, int64_t now) {
+    counter.step = decayedStep(counter, now);
+
+    // Clear the buckets the window slid past; at most BUCKETS of them
+    int64_t bucket = now / bucketMs;
+    int64_t gap = bucket - counter.bucket;
+    if (gap < 0 || gap >= static_cast<int64_t>(BUCKETS)) {
+        counter.counts.fill(0);
+    } else {
+        for (int64_t i = 1; i <= gap; i++) {
+            counter.counts[(counter.bucket + i) % BUCKETS] = 0;
+        }
+    }
+    counter.bucket = bucket;
+
+    uint8_t& slot = counter.counts[bucket % BUCKETS];
+    if (slot < UINT8_MAX) {
+        slot++;
+    }
+    counter.lastFailureMs = now;
+}
+
+uint32_t Lockout::escalate(Counter& counter, uint32_t threshold) {
+    if (threshold == 0) {
+        return 0;
+    }
+
+    uint32_t failures = 0;
+    for (uint8_t n : counter.counts) {
+        failures += n;
+    }
+    if (failures < threshold) {
+        return 0;
+    }
+
+    uint32_t lockMs = policy.stepsMs[counter.step];
+    if (counter.step + 1 < policy.stepsMs.size()) {
+        counter.step++;
+    }
+    counter.counts.fill(0);
+    return lockMs;
+}
+
+// One line per counter in use:
+//   until <lockedUntilMs>
+//   device <bucket> <lastFailureMs> <step> <count> x BUCKETS
+//   key <n> <bucket> <lastFailureMs> <step> <count> x BUCKETS
+bool Lockout::save(const std::string& path) const {
+    std::ostringstream out;
+    out << STATE_HEADER << "\n" << "until " << lockedUntilMs << "\n";
+
+    auto write = [&out](const Counter& counter) {
+        out << counter.bucket << " " << counter.lastFailureMs << " " << counter.step;
+        for (uint8_t n : counter.counts) {
+            out << " " << static_cast<int>(n);
+        }
+        out << "\n";
+    };
+    out << "device ";
+    write(device);
+    for (size_t key = 0; key < KEYS; key++) {
+        if (keys[key].lastFailureMs != 0) {
+            out << "key " << key << " ";
+            write(keys[key]);
+        }
+    }
+
+    // Written aside and renamed over the old file, so a crash mid-write
+    // leaves the previous state intact
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        file << out.str();
+        if (!file.flush()) {
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+bool Lockout::load(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    if (!enabled || !std::getline(file, line) || line != STATE_HEADER) {
+        return false;
+    }
+
+    auto read = [](std::istringstream& in, Counter& counter) {
+        counter = Counter();
+        in >> counter.bucket >> counter.lastFailureMs >> counter.step;
+        for (uint8_t& n : counter.counts) {
+            int value = 0;
+            in >> value;
+            n = static_cast<uint8_t>(std::min(std::max(value, 0), static_cast<int>(UINT8_MAX)));
+        }
+        return static_cast<bool>(in);
+    };
+
+    std::array<Counter, KEYS> loadedKeys;
+    Counter loadedDevice;
+    int64_t loadedUntil = 0;
+    while (std::getline(file, line)) {
+        std::istringstream in(line);
+        std::string kind;
+        in >> kind;
+        bool ok = false;
+        if (kind == "until") {
+            ok = static_cast<bool>(in >> loadedUntil);
+        } else if (kind == "device") {
+            ok = read(in, loadedDevice);
+        } else if (kind == "key") {
+            size_t key = KEYS;
+            ok = (in >> key) && key < KEYS && read(in, loadedKeys[key]);
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+
+    // Steps from an older, longer policy are clamped to this one
+    uint32_t topStep = static_cast<uint32_t>(policy.stepsMs.size() - 1);
+    for (Counter& counter : loadedKeys) {
+        counter.step = std::min(counter.step, topStep);
+    }
+    loadedDevice.step = std::min(loadedDevice.step, topStep);
+
+    keys = loadedKeys;
+    device = loadedDevice;
+    lockedUntilMs = loadedUntil;
+    return true;
+}
+
+int64_t Lockout::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Escalating lockouts after failed challenges. Failures are counted per
+// trigger key and for the device as a whole, over a sliding window of
+// BUCKETS time buckets. When either count reaches its threshold the
+// counter's step is used as the lock duration (1 s, 5 s, 30 s, ... by
+// default), the counter moves up a step and its window starts over. Each
+// full decay period without a failure drops one step again.
+//
+// Times are Unix milliseconds so the state stays meaningful across
+// restarts; save() and load() keep it in a small text file. Each failure
+// costs O(1). Not thread-safe; the middleware serializes calls.
+class Lockout {
+public:
+    static constexpr size_t BUCKETS = 8;
+    static constexpr size_t KEYS = 256;
+
+    struct Policy {
+        uint32_t keyThreshold = 3;          // failures of one key in a window; 0 = not counted
+        uint32_t deviceThreshold = 5;       // failures of any key in a window; 0 = not counted
+        uint32_t windowMs = 60000;
+        uint32_t decayMs = 600000;          // quiet time that drops one step; 0 = never
+        std::vector<uint32_t> stepsMs = { 1000, 5000, 30000, 300000, 1800000 };
+    };
+
+    Lockout();
+
+    // Turns lockouts on and forgets all counts. Returns false (and changes
+    // nothing) on an empty step list, a window too short to bucket or with
+    // both thresholds 0, which would never lock.
+    bool configure(const Policy& policy);
+    void disable();
+    bool isEnabled() const { return enabled; }
+
+    // Counts a failed challenge of `key` and returns how long to lock input
+    // for, or 0 if neither threshold was reached
+    uint32_t recordFailure(uint16_t key, int64_t nowMs);
+
+    // Time left on the latest lockout, 0 once it has passed
+    int64_t remainingMs(int64_t nowMs) const;
+    // Escalation step the next lockout of `key` or of the device would use
+    int keyStep(uint16_t key, int64_t nowMs) const;
+    int deviceStep(int64_t nowMs) const;
+
+    // Persists counts, steps and the current lockout. load() restores them
+    // into a configured instance and returns false if the file is missing
+    // or unreadable, leaving the state fresh.
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    static int64_t nowMs();
+
+private:
+    struct Counter {
+        int64_t bucket = 0;             // index of the newest bucket
+        int64_t lastFailureMs = 0;
+        uint32_t step = 0;
+        std::array<uint8_t, BUCKETS> counts = {};
+    };
+
+    uint32_t decayedStep(const Counter& counter, int64_t nowMs) const;
+    void count(Counter& counter, int64_t nowMs);
+    uint32_t escalate(Counter& counter, uint32_t threshold);
+
+    bool enabled;
+    Policy policy;
+    int64_t bucketMs;
+    std::array<Counter, KEYS> keys;
+    Counter device;
+    int64_t lockedUntilMs;
+};
@@ -1,4 +1,27 @@
 #include "Logger.hpp"
+#include "Metrics.hpp"
+#include <chrono>
+
+namespace {
+    struct LoggerMetrics {
+        Metrics::Counter* messages[6] = {
+            &Metrics::counter("simon_log_messages_total{level=\"debug\"}", "Log messages written, by level"),
+            &Metrics::counter("simon_log_messages_total{level=\"info\"}", "Log messages written, by level"),
+            &Metrics::counter("simon_log_messages_total{level=\"main\"}", "Log messages written, by level"),
+            &Metrics::counter("simon_log_messages_total{level=\"warning\"}", "Log messages written, by level"),
+            &Metrics::counter("simon_log_messages_total{level=\"error\"}", "Log messages written, by level"),
+            &Metrics::counter("simon_log_messages_total{level=\"critical\"}", "Log messages written, by level"),
+        };
+        // Includes waiting for the lock, i.e. what a logging caller pays
+        Metrics::Histogram& writeDuration = Metrics::histogram("simon_log_write_duration_seconds",
+                                                               "Time spent writing one log message");
+    };
+
+    LoggerMetrics& metrics() {
+        static LoggerMetrics instance;
+        return instance;
+    }
+}
 
 std::ofstream Logger::logFile;
 std::mutex Logger::logMutex;
@@ -13,7 +36,11 @@ std::string Logger::getCurrentTimestamp() {
     
     std::stringstream ss;
     std::tm tm_buf;
+#ifdef _WIN32
     localtime_s(&tm_buf, &now_c);
+#else
+    localtime_r(&now_c, &tm_buf);
+#endif
     
     ss << std::setfill('0') << std::setw(2) << tm_buf.tm_hour << "."
        << std::setfill('0') << std::setw(2) << tm_buf.tm_min << "."
@@ -35,6 +62,7 @@ std::string Logger::getLevelString(LogLevel level) {
     }
 }
 
+#ifdef _WIN32
 void Logger::setConsoleColor(LogLevel level) {
     HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
     
@@ -63,6 +91,27 @@ void Logger::setConsoleColor(LogLevel level) {
     }
 }
 
+void Logger::resetConsoleColor() {
+    SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
+}
+#else
+void Logger::setConsoleColor(LogLevel level) {
+    switch (level) {
+        case LogLevel::DEBUG:       std::cout << "\033[1;34m"; break;
+        case LogLevel::INFO:        std::cout << "\033[36m"; break;
+        case LogLevel::MAIN:        std::cout << "\033[32m"; break;
+        case LogLevel::WARNING:     std::cout << "\033[33m"; break;
+        case LogLevel::ERROR_LEVEL: std::cout << "\033[31m"; break;
+        case LogLevel::CRITICAL:    std::cout << "\033[1;31m"; break;
+        default:                    std::cout << "\033[0m"; break;
+    }
+}
+
+void Logger::resetConsoleColor() {
+    std::cout << "\033[0m";
+}
+#endif
+
 void Logger::rotateLogFileIfNeeded() {
     if (!fileLoggingEnabled) return;
     
@@ -121,6 +170,7 @@ void Logger::setLogLevel(LogLevel level) {
 void Logger::log(LogLevel level, const std::string& message, const char* file, int line) {
     if (level < minLogLevel) return;
     
+    auto started = std::chrono::steady_clock::now();
     std::lock_guard<std::mutex> lock(logMutex);
     
     std::string timestamp = getCurrentTimestamp();
@@ -145,10 +195,13 @@ void Logger::log(LogLevel level, const std::string& message, const char* file, i
     logMsg << message;
     
     setConsoleColor(level);
-    std::cout << logMsg.str() << std::endl;
-    SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
+    std::cout << logMsg.str();
+    resetConsoleColor();
+    std::cout << std::endl;
     
+#ifdef _WIN32
     OutputDebugStringA((logMsg.str() + "\n").c_str());
+#endif
     
     if (fileLoggingEnabled && logFile.is_open()) {
         logFile << logMsg.str() << std::endl;
@@ -156,6 +209,10 @@ void Logger::log(LogLevel level, const std::string& message, const char* file, i
         
         rotateLogFileIfNeeded();
     }
+
+    metrics().messages[static_cast<int>(level)]->inc();
+    metrics().writeDuration.observe(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
 }
 
 void Logger::shutdown() {
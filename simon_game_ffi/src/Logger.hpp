@@ -2,7 +2,9 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <iomanip>
 #include <ctime>
 #include <sstream>
@@ -34,17 +36,27 @@ private:
     static std::string getCurrentTimestamp();
     static std::string getLevelString(LogLevel level);
     static void setConsoleColor(LogLevel level);
+    static void resetConsoleColor();
 
 public:
     static bool initialize(const std::string& filePath = "debug.log", LogLevel level = LogLevel::INFO);
     static void setLogLevel(LogLevel level);
     static void log(LogLevel level, const std::string& message, const char* file = nullptr, int line = -1);
+    static bool isEnabled(LogLevel level) noexcept { return level >= minLogLevel.load(std::memory_order_relaxed); }
     static void shutdown();
 };
 
-#define LOG_DEBUG(message)    Logger::log(Logger::LogLevel::DEBUG, message, __FILE__, __LINE__)
-#define LOG_INFO(message)     Logger::log(Logger::LogLevel::INFO, message, __FILE__, __LINE__)
-#define LOG_MAIN(message)     Logger::log(Logger::LogLevel::MAIN, message, __FILE__, __LINE__)
-#define LOG_WARNING(message)  Logger::log(Logger::LogLevel::WARNING, message, __FILE__, __LINE__)
-#define LOG_ERROR(message)    Logger::log(Logger::LogLevel::ERROR_LEVEL, message, __FILE__, __LINE__)
-#define LOG_CRITICAL(message) Logger::log(Logger::LogLevel::CRITICAL, message, __FILE__, __LINE__)
\ No newline at end of file
+// The message is only built when its level is enabled
+#define LOG_AT(level, message) \
+    do { \
+        if (Logger::isEnabled(level)) { \
+            Logger::log(level, message, __FILE__, __LINE__); \
+        } \
+    } while (0)
+
+#define LOG_DEBUG(message)    LOG_AT(Logger::LogLevel::DEBUG, message)
+#define LOG_INFO(message)     LOG_AT(Logger::LogLevel::INFO, message)
+#define LOG_MAIN(message)     LOG_AT(Logger::LogLevel::MAIN, message)
+#define LOG_WARNING(message)  LOG_AT(Logger::LogLevel::WARNING, message)
+#define LOG_ERROR(message)    LOG_AT(Logger::LogLevel::ERROR_LEVEL, message)
+#define LOG_CRITICAL(message) LOG_AT(Logger::LogLevel::CRITICAL, message)
\ No newline at end of file
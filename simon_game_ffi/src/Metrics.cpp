@@ -0,0 +1,237 @@
+#include "Metrics.hpp"
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    enum class MetricType { COUNTER, GAUGE, HISTOGRAM };
+
+    struct Entry {
+        MetricType type;
+        std::string help;
+        std::unique_ptr<Metrics::Counter> counter;
+        std::unique_ptr<Metrics::Gauge> gauge;
+        std::unique_ptr<Metrics::Histogram> histogram;
+    };
+
+    // Keyed by (family, labels) so a family's series are dumped together
+    using Registry = std::map<std::pair<std::string, std::string>, Entry>;
+
+    // Function-local so metrics can be registered from static initializers
+    Registry& registry() {
+        static Registry entries;
+        return entries;
+    }
+
+    std::mutex& registryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    const char* typeName(MetricType type) {
+        switch (type) {
+            case MetricType::COUNTER:   return "counter";
+            case MetricType::GAUGE:     return "gauge";
+            case MetricType::HISTOGRAM: return "histogram";
+        }
+        return "untyped";
+    }
+
+    // Splits `family{labels}` and checks the family is a valid metric name
+    std::pair<std::string, std::string> parseName(const std::string& name) {
+        size_t brace = name.find('{');
+        std::string family = name.substr(0, brace);
+        std::string labels;
+        if (brace != std::string::npos) {
+            if (name.back() != '}') {
+                throw std::invalid_argument("Unterminated labels in metric name: " + name);
+            }
+            labels = name.substr(brace + 1, name.size() - brace - 2);
+        }
+
+        bool valid = !family.empty() && !std::isdigit(static_cast<unsigned char>(family[0]));
+        for (char c : family) {
+            valid = valid && (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == ':');
+        }
+        if (!valid) {
+            throw std::invalid_argument("Invalid metric name: " + name);
+        }
+        return {family, labels};
+    }
+
+    Entry& findOrCreate(const std::string& name, const std::string& help, MetricType type) {
+        std::pair<std::string, std::string> key = parseName(name);
+        Registry& entries = registry();
+
+        // All series of a family must share a type
+        Registry::iterator first = entries.lower_bound({key.first, ""});
+        if (first != entries.end() && first->first.first == key.first && first->second.type != type) {
+            throw std::invalid_argument("Metric " + key.first + " is already registered as a " +
+                                        typeName(first->second.type));
+        }
+
+        Registry::iterator it = entries.find(key);
+        if (it == entries.end()) {
+            Entry entry = {type, help, nullptr, nullptr, nullptr};
+            it = entries.emplace(key, std::move(entry)).first;
+        }
+        return it->second;
+    }
+
+    std::string formatNumber(double value) {
+        if (value == std::numeric_limits<double>::infinity()) {
+            return "+Inf";
+        }
+        std::ostringstream out;
+        out.precision(12);
+        out << value;
+        return out.str();
+    }
+
+    std::string withLabel(const std::string& labels, const std::string& extra) {
+        if (labels.empty()) {
+            return "{" + extra + "}";
+        }
+        return "{" + labels + "," + extra + "}";
+    }
+}
+
+size_t Metrics::currentShard() {
+    static std::atomic<size_t> nextShard(0);
+    thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+    return shard;
+}
+
+void Metrics::Counter::inc(uint64_t amount) {
+    shards[currentShard()].value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+uint64_t Metrics::Counter::value() const {
+    uint64_t total = 0;
+    for (const Shard& shard : shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Metrics::Histogram::Histogram(std::vector<double> upperBounds) : bounds(std::move(upperBounds)) {
+    if (!std::is_sorted(bounds.begin(), bounds.end())) {
+        throw std::invalid_argument("Histogram bounds must be ascending");
+    }
+    for (Shard& shard : shards) {
+        shard.counts.reset(new std::atomic<uint64_t>[bounds.size() + 1]);
+        for (size_t i = 0; i <= bounds.size(); i++) {
+            shard.counts[i].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void Metrics::Histogram::observe(double value) {
+    size_t bucket = std::lower_bound(bounds.begin(), bounds.end(), value) - bounds.begin();
+    Shard& shard = shards[currentShard()];
+    shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    // Shards are per thread, so this rarely loops
+    double sum = shard.sum.load(std::memory_order_relaxed);
+    while (!shard.sum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed)) {
+    }
+}
+
+Metrics::Histogram::Snapshot Metrics::Histogram::snapshot() const {
+    Snapshot result;
+    result.bounds = bounds;
+    result.counts.assign(bounds.size() + 1, 0);
+    for (const Shard& shard : shards) {
+        for (size_t i = 0; i <= bounds.size(); i++) {
+            uint64_t n = shard.counts[i].load(std::memory_order_relaxed);
+            result.counts[i] += n;
+            result.count += n;
+        }
+        result.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+const std::vector<double>& Metrics::latencyBuckets() {
+    static const std::vector<double> bounds = {
+        0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+        0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60
+    };
+    return bounds;
+}
+
+Metrics::Counter& Metrics::counter(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    Entry& entry = findOrCreate(name, help, MetricType::COUNTER);
+    if (!entry.counter) {
+        entry.counter.reset(new Counter());
+    }
+    return *entry.counter;
+}
+
+Metrics::Gauge& Metrics::gauge(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    Entry& entry = findOrCreate(name, help, MetricType::GAUGE);
+    if (!entry.gauge) {
+        entry.gauge.reset(new Gauge());
+    }
+    return *entry.gauge;
+}
+
+Metrics::Histogram& Metrics::histogram(const std::string& name, const std::string& help,
+                                       const std::vector<double>& bounds) {
+    std::lock_guard<std::mutex> lock(registryMutex());
+    Entry& entry = findOrCreate(name, help, MetricType::HISTOGRAM);
+    if (!entry.histogram) {
+        entry.histogram.reset(new Histogram(bounds));
+    }
+    return *entry.histogram;
+}
+
+std::string Metrics::dump() {
+    std::ostringstream out;
+    std::lock_guard<std::mutex> lock(registryMutex());
+
+    const std::string* family = nullptr;
+    for (const Registry::value_type& item : registry()) {
+        const std::string& name = item.first.first;
+        const std::string& labels = item.first.second;
+        const Entry& entry = item.second;
+
+        if (!family || *family != name) {
+            family = &name;
+            out << "# HELP " << name << " " << entry.help << "\n";
+            out << "# TYPE " << name << " " << typeName(entry.type) << "\n";
+        }
+
+        std::string series = labels.empty() ? name : name + "{" + labels + "}";
+        switch (entry.type) {
+            case MetricType::COUNTER:
+                out << series << " " << entry.counter->value() << "\n";
+                break;
+            case MetricType::GAUGE:
+                out << series << " " << entry.gauge->value() << "\n";
+                break;
+            case MetricType::HISTOGRAM: {
+                Histogram::Snapshot snapshot = entry.histogram->snapshot();
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i <= snapshot.bounds.size(); i++) {
+                    cumulative += snapshot.counts[i];
+                    double bound = i < snapshot.bounds.size() ? snapshot.bounds[i]
+                                                              : std::numeric_limits<double>::infinity();
+                    out << name << "_bucket" << withLabel(labels, "le=\"" + formatNumber(bound) + "\"")
+                        << " " << cumulative << "\n";
+                }
+                std::string suffix = labels.empty() ? "" : "{" + labels + "}";
+                out << name << "_sum" << suffix << " " << formatNumber(snapshot.sum) << "\n";
+                out << name << "_count" << suffix << " " << snapshot.count << "\n";
+                break;
+            }
+        }
+    }
+    return out.str();
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Process-wide counters, gauges and histograms in the Prometheus data model.
+//
+// Metrics are registered once by name, optionally with labels, e.g.
+// `simon_challenges_total{result="success"}`, and the returned reference is
+// kept by the caller (typically in a function-local static). Updates after
+// that are lock-free: counters and histograms are split into cache-line
+// sized shards picked per thread, so hot paths on different threads do not
+// contend. Only registration and dump() take the registry lock.
+class Metrics {
+public:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    class Counter {
+    public:
+        void inc(uint64_t amount = 1);
+        uint64_t value() const;
+
+    private:
+        struct alignas(64) Shard {
+            std::atomic<uint64_t> value{0};
+        };
+        std::array<Shard, SHARD_COUNT> shards;
+    };
+
+    class Gauge {
+    public:
+        void set(int64_t newValue) { current.store(newValue, std::memory_order_relaxed); }
+        void add(int64_t amount) { current.fetch_add(amount, std::memory_order_relaxed); }
+        int64_t value() const { return current.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<int64_t> current{0};
+    };
+
+    class Histogram {
+    public:
+        // `bounds` are the ascending upper bounds of the buckets; a +Inf
+        // bucket is implied
+        explicit Histogram(std::vector<double> bounds);
+
+        void observe(double value);
+
+        struct Snapshot {
+            std::vector<double> bounds;
+            std::vector<uint64_t> counts;   // per bucket, not cumulative; last is +Inf
+            uint64_t count = 0;
+            double sum = 0.0;
+        };
+        Snapshot snapshot() const;
+
+    private:
+        struct alignas(64) Shard {
+            std::unique_ptr<std::atomic<uint64_t>[]> counts;
+            std::atomic<double> sum{0.0};
+        };
+        std::vector<double> bounds;
+        std::array<Shard, SHARD_COUNT> shards;
+    };
+
+    // Upper bounds in seconds for challenge and serial latencies
+    static const std::vector<double>& latencyBuckets();
+
+    // Returns the metric registered under `name`, creating it on first use.
+    // Throws std::invalid_argument if the name is malformed or already
+    // registered as a different type.
+    static Counter& counter(const std::string& name, const std::string& help);
+    static Gauge& gauge(const std::string& name, const std::string& help);
+    static Histogram& histogram(const std::string& name, const std::string& help,
+                                const std::vector<double>& bounds = latencyBuckets());
+
+    // Every registered metric in the Prometheus text exposition format
+    static std::string dump();
+
+    // Index of the calling thread's shard
+    static size_t currentShard();
+};
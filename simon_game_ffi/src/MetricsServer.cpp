@@ -0,0 +1,189 @@
+#include "MetricsServer.hpp"
+#include "Metrics.hpp"
+#include "Logger.hpp"
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // A scraper that stalls mid-request must not hold up the loop for long
+    const int CLIENT_TIMEOUT_MS = 1000;
+    const size_t MAX_REQUEST_BYTES = 8192;
+}
+
+MetricsServer::MetricsServer(EventLoop* sharedLoop)
+    : ownedLoop(sharedLoop ? nullptr : new EventLoop()), loop(sharedLoop ? *sharedLoop : *ownedLoop), listenSocket(-1) {
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+#ifdef _WIN32
+bool MetricsServer::start(const std::string& address) {
+    LOG_ERROR("Metrics endpoint is not supported on Windows, cannot serve " + address);
+    return false;
+}
+
+void MetricsServer::stop() {
+}
+
+void MetricsServer::onAcceptable() {
+}
+
+void MetricsServer::serve(int) {
+}
+
+#else
+bool MetricsServer::start(const std::string& address) {
+    if (isRunning()) {
+        LOG_WARNING("Metrics endpoint already running");
+        return false;
+    }
+
+    const std::string unixPrefix = "unix:";
+    if (address.compare(0, unixPrefix.size(), unixPrefix) == 0) {
+        sockaddr_un addr = {};
+        std::string path = address.substr(unixPrefix.size());
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            LOG_ERROR("Invalid metrics socket path: " + path);
+            return false;
+        }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+        listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+        // A socket file left behind by a previous run would fail the bind
+        unlink(path.c_str());
+        if (listenSocket < 0 || bind(listenSocket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            LOG_ERROR("Failed to bind metrics socket " + path + ": " + std::strerror(errno));
+            stop();
+            return false;
+        }
+        unixPath = path;
+    } else {
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos || colon + 1 == address.size()) {
+            LOG_ERROR("Invalid metrics address, expected host:port or unix:/path: " + address);
+            return false;
+        }
+        std::string host = address.substr(0, colon);
+        std::string port = address.substr(colon + 1);
+
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        addrinfo* result = nullptr;
+        int status = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result);
+        if (status != 0) {
+            LOG_ERROR("Cannot resolve metrics address " + address + ": " + gai_strerror(status));
+            return false;
+        }
+
+        listenSocket = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+        int reuse = 1;
+        bool bound = listenSocket >= 0 &&
+                     setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == 0 &&
+                     bind(listenSocket, result->ai_addr, result->ai_addrlen) == 0;
+        freeaddrinfo(result);
+        if (!bound) {
+            LOG_ERROR("Failed to bind metrics endpoint " + address + ": " + std::strerror(errno));
+            stop();
+            return false;
+        }
+    }
+
+    if (listen(listenSocket, 8) != 0 || fcntl(listenSocket, F_SETFL, O_NONBLOCK) != 0) {
+        LOG_ERROR("Failed to listen on metrics endpoint " + address + ": " + std::strerror(errno));
+        stop();
+        return false;
+    }
+
+    loop.watch(listenSocket, [this]() { onAcceptable(); });
+    if (ownedLoop) {
+        loopThread = std::thread([this]() { loop.run(); });
+    }
+    LOG_INFO("Serving metrics on " + address);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (loopThread.joinable()) {
+        loop.stop();
+        loopThread.join();
+    }
+    if (listenSocket >= 0) {
+        loop.unwatch(listenSocket);
+        close(listenSocket);
+        listenSocket = -1;
+    }
+    if (!unixPath.empty()) {
+        unlink(unixPath.c_str());
+        unixPath.clear();
+    }
+}
+
+void MetricsServer::onAcceptable() {
+    while (true) {
+        int client = accept(listenSocket, nullptr, nullptr);
+        if (client < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG_WARNING(std::string("Metrics endpoint accept failed: ") + std::strerror(errno));
+            }
+            return;
+        }
+        serve(client);
+        close(client);
+    }
+}
+
+void MetricsServer::serve(int client) {
+    // The accepted socket may inherit O_NONBLOCK; serve it blocking with
+    // timeouts instead
+    fcntl(client, F_SETFL, fcntl(client, F_GETFL) & ~O_NONBLOCK);
+    timeval timeout = { CLIENT_TIMEOUT_MS / 1000, (CLIENT_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_BYTES) {
+        ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            return;
+        }
+        request.append(buffer, static_cast<size_t>(n));
+    }
+
+    std::string status = "200 OK";
+    std::string body;
+    if (request.compare(0, 4, "GET ") != 0) {
+        status = "405 Method Not Allowed";
+    } else {
+        body = Metrics::dump();
+    }
+
+    std::string response = "HTTP/1.1 " + status + "\r\n"
+                           "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+#include "EventLoop.hpp"
+#include <memory>
+#include <string>
+#include <thread>
+
+// Serves Metrics::dump() over HTTP for Prometheus scrapes, on its own
+// EventLoop thread. `address` is either "host:port" (e.g.
+// "127.0.0.1:9464") or "unix:/path/to/socket". Scrapes are answered one at
+// a time on the loop thread, which is plenty for a local scraper.
+//
+// Given a shared EventLoop no thread is started and scrapes are answered on
+// the thread driving that loop, which must also stop the server.
+//
+// POSIX only for now; on Windows start() fails and metrics are available
+// through simon_metrics_dump.
+class MetricsServer {
+public:
+    explicit MetricsServer(EventLoop* sharedLoop = nullptr);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    bool start(const std::string& address);
+    void stop();
+    bool isRunning() const { return listenSocket >= 0; }
+
+private:
+    void onAcceptable();
+    void serve(int client);
+
+    std::unique_ptr<EventLoop> ownedLoop;   // null on a shared loop
+    EventLoop& loop;
+    std::thread loopThread;
+    int listenSocket;
+    std::string unixPath;
+};
@@ -0,0 +1,31 @@
+#include "Result.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#endif
+
+namespace {
+    thread_local Error lastError = { SIMON_SUCCESS, 0, nullptr };
+}
+
+Error Error::fromOs(simon_error_t code, const char* what) noexcept {
+#ifdef _WIN32
+    int osError = static_cast<int>(GetLastError());
+#else
+    int osError = errno;
+#endif
+    return { code, osError, what };
+}
+
+void LastError::set(const Error& error) noexcept {
+    lastError = error;
+}
+
+const Error& LastError::get() noexcept {
+    return lastError;
+}
+
+void LastError::clear() noexcept {
+    lastError = { SIMON_SUCCESS, 0, nullptr };
+}
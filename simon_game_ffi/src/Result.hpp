@@ -0,0 +1,60 @@
+#pragma once
+#include "simon_game.h"
+
+// Failure detail without exceptions or allocation. `what` is a static
+// string; the OS error text is only looked up when simon_last_error asks
+// for it.
+struct Error {
+    simon_error_t code;
+    int osError;        // errno, or GetLastError() on Windows; 0 if none
+    const char* what;
+
+    // An error carrying the calling thread's current errno / GetLastError()
+    static Error fromOs(simon_error_t code, const char* what) noexcept;
+};
+
+// Either a value or an Error, for the noexcept core. T is a small value
+// type; Result<void> only reports success.
+template <typename T>
+class Result {
+public:
+    Result(T value) noexcept : payload(value), status{SIMON_SUCCESS, 0, nullptr} {}
+    Result(const Error& error) noexcept : payload(), status(error) {}
+
+    bool ok() const noexcept { return status.code == SIMON_SUCCESS; }
+    explicit operator bool() const noexcept { return ok(); }
+    const T& value() const noexcept { return payload; }
+    const Error& error() const noexcept { return status; }
+
+private:
+    T payload;
+    Error status;
+};
+
+template <>
+class Result<void> {
+public:
+    Result() noexcept : status{SIMON_SUCCESS, 0, nullptr} {}
+    Result(const Error& error) noexcept : status(error) {}
+
+    bool ok() const noexcept { return status.code == SIMON_SUCCESS; }
+    explicit operator bool() const noexcept { return ok(); }
+    const Error& error() const noexcept { return status; }
+
+private:
+    Error status;
+};
+
+// The failure most recently recorded on the calling thread, behind
+// simon_last_error. Like errno, success does not clear it.
+namespace LastError {
+    void set(const Error& error) noexcept;
+    const Error& get() noexcept;
+    void clear() noexcept;
+
+    // Records `error` and hands back its code, for `return LastError::fail(...)`
+    inline simon_error_t fail(const Error& error) noexcept {
+        set(error);
+        return error.code;
+    }
+}
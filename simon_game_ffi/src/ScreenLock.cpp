@@ -0,0 +1,288 @@
+#include "ScreenLock.hpp"
+#include "EventLoop.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+    class BlockInputBackend : public ScreenLock::Backend {
+    public:
+        bool engage() override {
+            if (!BlockInput(TRUE)) {
+                LOG_ERROR("BlockInput failed (administrator rights required?), error: " + std::to_string(GetLastError()));
+                return false;
+            }
+            return true;
+        }
+
+        void release() override {
+            BlockInput(FALSE);
+        }
+    };
+#elif defined(__linux__)
+    const size_t BITS_PER_LONG = 8 * sizeof(unsigned long);
+
+    bool hasBit(const unsigned long* bits, int bit) {
+        return (bits[bit / BITS_PER_LONG] >> (bit % BITS_PER_LONG)) & 1;
+    }
+
+    // Keyboards and pointers only; power buttons, lid switches and the
+    // like also report keys but must keep working
+    bool isKeyboardOrPointer(int fd) {
+        unsigned long keys[KEY_MAX / BITS_PER_LONG + 1] = {};
+        if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0) {
+            return false;
+        }
+        return hasBit(keys, KEY_A) || hasBit(keys, BTN_LEFT) || hasBit(keys, BTN_TOUCH);
+    }
+
+    // EVIOCGRAB routes a device's events to our descriptor alone; they are
+    // never read, so input is dropped until the grab is released
+    class EvdevGrabBackend : public ScreenLock::Backend {
+    public:
+        explicit EvdevGrabBackend(const std::vector<std::string>& devices) : devices(devices) {}
+
+        ~EvdevGrabBackend() override {
+            release();
+        }
+
+        bool engage() override {
+            bool scan = devices.empty();
+            for (const std::string& path : scan ? inputDevices() : devices) {
+                int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+                if (fd >= 0 && (!scan || isKeyboardOrPointer(fd)) && ioctl(fd, EVIOCGRAB, 1) == 0) {
+                    grabbed.push_back(fd);
+                    continue;
+                }
+                if (!scan) {
+                    LOG_ERROR("Failed to grab input device " + path + ": " + std::strerror(errno));
+                }
+                if (fd >= 0) {
+                    close(fd);
+                }
+                if (!scan) {
+                    release();
+                    return false;
+                }
+            }
+            if (grabbed.empty()) {
+                LOG_ERROR("No input device could be grabbed (read access to /dev/input required?)");
+                return false;
+            }
+            return true;
+        }
+
+        void release() override {
+            for (int fd : grabbed) {
+                ioctl(fd, EVIOCGRAB, 0);
+                close(fd);
+            }
+            grabbed.clear();
+        }
+
+    private:
+        static std::vector<std::string> inputDevices() {
+            std::vector<std::string> paths;
+            std::error_code error;
+            for (const auto& entry : std::filesystem::directory_iterator("/dev/input", error)) {
+                if (entry.path().filename().string().rfind("event", 0) == 0) {
+                    paths.push_back(entry.path().string());
+                }
+            }
+            return paths;
+        }
+
+        std::vector<std::string> devices;
+        std::vector<int> grabbed;
+    };
+#else
+    class UnsupportedBackend : public ScreenLock::Backend {
+    public:
+        bool engage() override {
+            LOG_ERROR("Screen lock is not supported on this platform");
+            return false;
+        }
+
+        void release() override {
+        }
+    };
+#endif
+}
+
+std::unique_ptr<ScreenLock::Backend> ScreenLock::platformBackend(const std::vector<std::string>& devices) {
+#ifdef _WIN32
+    (void)devices;
+    return std::unique_ptr<Backend>(new BlockInputBackend());
+#elif defined(__linux__)
+    return std::unique_ptr<Backend>(new EvdevGrabBackend(devices));
+#else
+    (void)devices;
+    return std::unique_ptr<Backend>(new UnsupportedBackend());
+#endif
+}
+
+ScreenLock::ScreenLock(std::unique_ptr<Backend> backend, EventLoop* loop)
+    : backend(std::move(backend)), locked(false), ending(false), loop(loop), expiryTimer(0),
+      self(std::make_shared<ScreenLock*>(this)) {
+}
+
+ScreenLock::~ScreenLock() {
+    if (loop != nullptr) {
+        *self = nullptr;
+        loop->cancelTimer(expiryTimer);
+        if (isLocked()) {
+            release();
+        }
+        return;
+    }
+
+    end();
+    if (timerThread.joinable()) {
+        timerThread.join();
+    }
+}
+
+bool ScreenLock::begin(std::chrono::milliseconds duration) {
+    std::unique_lock<std::mutex> lock(mutex);
+    Clock::time_point until = Clock::now() + duration;
+    if (locked) {
+        // The loop's timer checks the expiry again when it fires
+        if (until > expiry) {
+            expiry = until;
+            changed.notify_all();
+        }
+        return true;
+    }
+
+    if (loop != nullptr) {
+        lock.unlock();
+        if (!backend->engage()) {
+            return false;
+        }
+        lock.lock();
+        locked = true;
+        ending = false;
+        expiry = until;
+        lock.unlock();
+
+        expiryTimer = loop->addTimer(until, [this]() { expire(); });
+        LOG_INFO("Screen locked for " + std::to_string(duration.count()) + " ms");
+        return true;
+    }
+
+    // A previous lock's thread stops touching our state once it clears
+    // `locked`, so it can be joined without releasing the mutex
+    if (timerThread.joinable()) {
+        timerThread.join();
+    }
+    locked = true;
+    ending = false;
+    expiry = until;
+    lock.unlock();
+
+    std::promise<bool> engaged;
+    std::future<bool> result = engaged.get_future();
+    timerThread = std::thread(&ScreenLock::run, this, std::move(engaged));
+    if (result.get()) {
+        LOG_INFO("Screen locked for " + std::to_string(duration.count()) + " ms");
+        return true;
+    }
+
+    timerThread.join();
+    lock.lock();
+    locked = false;
+    changed.notify_all();
+    return false;
+}
+
+void ScreenLock::end() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!locked) {
+            return;
+        }
+        ending = true;
+        changed.notify_all();
+    }
+
+    if (loop != nullptr) {
+        std::shared_ptr<ScreenLock*> target = self;
+        loop->post([target]() {
+            if (*target != nullptr) {
+                (*target)->expire();
+            }
+        });
+    }
+}
+
+bool ScreenLock::waitUntil(Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto released = [this]() { return !locked; };
+    // wait_until converts to the system clock internally, which overflows
+    // on time_point::max()
+    if (deadline == Clock::time_point::max()) {
+        changed.wait(lock, released);
+        return true;
+    }
+    return changed.wait_until(lock, deadline, released);
+}
+
+bool ScreenLock::isLocked() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return locked;
+}
+
+void ScreenLock::run(std::promise<bool> engaged) {
+    bool ok = backend->engage();
+    engaged.set_value(ok);
+    if (!ok) {
+        return;
+    }
+
+    {
+        // begin() may push the expiry out while we wait
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!ending && Clock::now() < expiry) {
+            changed.wait_until(lock, expiry);
+        }
+    }
+    release();
+}
+
+void ScreenLock::expire() {
+    loop->cancelTimer(expiryTimer);
+    expiryTimer = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!locked) {
+            return;
+        }
+        // begin() may have pushed the expiry out since the timer was set
+        if (!ending && Clock::now() < expiry) {
+            expiryTimer = loop->addTimer(expiry, [this]() { expire(); });
+            return;
+        }
+    }
+    release();
+}
+
+void ScreenLock::release() {
+    backend->release();
+    LOG_INFO("Screen unlocked");
+
+    std::lock_guard<std::mutex> lock(mutex);
+    locked = false;
+    changed.notify_all();
+}
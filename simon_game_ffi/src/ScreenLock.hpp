@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class EventLoop;
+
+// Keeps keyboard and mouse input from every application until a deadline
+// passes or end() is called, e.g. when a Simon round succeeds. The caller
+// is never blocked: each lock has a timer thread that engages the backend,
+// waits for the deadline or end(), and releases it. Windows only lets the
+// thread that called BlockInput undo it, which this arrangement satisfies.
+//
+// Given an EventLoop the lock starts no thread: begin() engages the backend
+// itself and a timer on the loop releases it. begin(), the destructor and
+// the loop must then share one thread, which also keeps BlockInput's rule;
+// waitUntil() on that thread would wait out the deadline without releasing.
+class ScreenLock {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // How input is held; engage() returns false if it could not be taken
+    class Backend {
+    public:
+        virtual ~Backend() = default;
+        virtual bool engage() = 0;
+        virtual void release() = 0;
+    };
+
+    // BlockInput on Windows (needs administrator rights). On Linux an
+    // exclusive EVIOCGRAB of `devices`, or of every keyboard and pointer
+    // under /dev/input when none are given. Elsewhere engage() fails.
+    static std::unique_ptr<Backend> platformBackend(const std::vector<std::string>& devices = {});
+
+    explicit ScreenLock(std::unique_ptr<Backend> backend = platformBackend(), EventLoop* loop = nullptr);
+    // Ends the lock and waits for input to be released
+    ~ScreenLock();
+
+    ScreenLock(const ScreenLock&) = delete;
+    ScreenLock& operator=(const ScreenLock&) = delete;
+
+    // Locks for `duration`. A lock already held is extended if the new
+    // deadline is later. Returns false if the backend failed. Call from one
+    // thread at a time.
+    bool begin(std::chrono::milliseconds duration);
+    // Releases input now; safe from any thread, and a no-op when unlocked
+    void end();
+    // Waits until input is released or `deadline` passes; true if released
+    bool waitUntil(Clock::time_point deadline);
+    bool isLocked() const;
+
+private:
+    void run(std::promise<bool> engaged);
+    // Loop mode: releases once ending or expired, else waits for the expiry
+    void expire();
+    void release();
+
+    std::unique_ptr<Backend> backend;
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    bool locked;
+    bool ending;
+    Clock::time_point expiry;
+    std::thread timerThread;
+
+    EventLoop* loop;
+    uint64_t expiryTimer;                   // EventLoop::TimerId, 0 if none
+    // Cleared on destruction, so an end() posted to the loop from another
+    // thread can tell whether the lock is still there
+    std::shared_ptr<ScreenLock*> self;
+};
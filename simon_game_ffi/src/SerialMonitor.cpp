@@ -1,9 +1,126 @@
 #include "SerialMonitor.hpp"
+#include "EventChannel.hpp"
+#include "EventLoop.hpp"
+#include "Metrics.hpp"
+#include "Trace.hpp"
+#include <chrono>
+#include <ctime>
 #include <iostream>
+#include <charconv>
+#include <cstring>
 #include <sstream>
+#include <string_view>
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+namespace {
+#ifdef _WIN32
+    const SerialMonitor::NativeHandle INVALID_PORT = INVALID_HANDLE_VALUE;
+#else
+    const SerialMonitor::NativeHandle INVALID_PORT = -1;
+
+    // Matches the Windows WriteTotalTimeoutConstant
+    const int WRITE_TIMEOUT_MS = 50;
+#endif
+
+    using Clock = std::chrono::steady_clock;
+
+    // Bytes asked of the port per read
+    const size_t READ_CHUNK = 256;
+
+    const Error NOT_CONNECTED = { SIMON_ERROR_CONNECTION_FAILED, 0, "Not connected to serial port" };
+    const Error OUT_OF_MEMORY = { SIMON_ERROR_UNKNOWN, 0, "Out of memory" };
+
+    // Text for an OS error, formatted into `buffer` where it has to be
+    std::string_view describeOsError(int osError, char (&buffer)[16]) noexcept {
+#ifdef _WIN32
+        std::to_chars_result end = std::to_chars(buffer, buffer + sizeof(buffer), osError);
+        return std::string_view(buffer, static_cast<size_t>(end.ptr - buffer));
+#else
+        static_cast<void>(buffer);
+        return std::strerror(osError);
+#endif
+    }
+
+#if defined(_WIN32) || !defined(__linux__)
+    // Time left until `deadline` in whole milliseconds, rounded up so a wait
+    // never ends before the deadline
+    long long remainingMs(Clock::time_point deadline) {
+        Clock::duration left = deadline - Clock::now();
+        if (left <= Clock::duration::zero()) {
+            return 0;
+        }
+        return std::chrono::ceil<std::chrono::milliseconds>(left).count();
+    }
+#endif
+
+#ifndef _WIN32
+    // Blocks until `fd` is readable or `deadline` passes. Returns false once
+    // the deadline has passed.
+    bool waitReadable(int fd, Clock::time_point deadline) {
+        Clock::duration left = deadline - Clock::now();
+        if (left <= Clock::duration::zero()) {
+            return false;
+        }
+
+        pollfd pfd = { fd, POLLIN, 0 };
+#ifdef __linux__
+        // ppoll takes the remaining time at full resolution
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+        timespec timeout = { static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000) };
+        ppoll(&pfd, 1, &timeout, nullptr);
+#else
+        poll(&pfd, 1, static_cast<int>(remainingMs(deadline)));
+#endif
+        return true;
+    }
+#endif
+
+    struct SerialMetrics {
+        Metrics::Gauge& portsOpen = Metrics::gauge("simon_serial_ports_open", "Serial ports currently open");
+        Metrics::Counter& connectFailures = Metrics::counter("simon_serial_connect_failures_total",
+                                                             "Failed attempts to open and configure a port");
+        Metrics::Counter& writes = Metrics::counter("simon_serial_writes_total{result=\"ok\"}",
+                                                    "Commands written to a port, by result");
+        Metrics::Counter& writeErrors = Metrics::counter("simon_serial_writes_total{result=\"error\"}",
+                                                         "Commands written to a port, by result");
+        Metrics::Counter& bytesWritten = Metrics::counter("simon_serial_bytes_written_total",
+                                                          "Bytes written to serial ports");
+        Metrics::Counter& bytesRead = Metrics::counter("simon_serial_bytes_read_total",
+                                                       "Bytes read from serial ports");
+        Metrics::Counter& readErrors = Metrics::counter("simon_serial_read_errors_total",
+                                                        "Reads that failed or found the port closed");
+        Metrics::Counter& verifiedTrue = Metrics::counter("simon_serial_verifications_total{result=\"true\"}",
+                                                          "Board replies awaited, by outcome");
+        Metrics::Counter& verifiedFalse = Metrics::counter("simon_serial_verifications_total{result=\"false\"}",
+                                                           "Board replies awaited, by outcome");
+        Metrics::Counter& verifyTimeouts = Metrics::counter("simon_serial_verifications_total{result=\"timeout\"}",
+                                                            "Board replies awaited, by outcome");
+        Metrics::Histogram& verifyDuration = Metrics::histogram("simon_serial_verify_duration_seconds",
+                                                                "Time spent waiting for a board reply");
+    };
+
+    SerialMetrics& metrics() {
+        static SerialMetrics instance;
+        return instance;
+    }
+
+    void publishConnection(const std::string& port, bool connected) {
+        EventChannel::setStatus(EventChannel::DEVICES_CONNECTED, metrics().portsOpen.value());
+        EventChannel::publish(connected ? EventChannel::DEVICE_CONNECTED : EventChannel::DEVICE_DISCONNECTED,
+                              -1, connected ? 1 : 0, 0, port.c_str());
+    }
+}
 
 SerialMonitor::SerialMonitor(const std::string& port) 
-    : serialHandle(INVALID_HANDLE_VALUE), connected(false), portName(port), shouldRun(false) {
+    : serialHandle(INVALID_PORT), connected(false), portName(port), shouldRun(false), monitorLoop(nullptr) {
+    // Registered here, where allocating may still throw
+    metrics();
 }
 
 SerialMonitor::~SerialMonitor() {
@@ -11,23 +128,88 @@ SerialMonitor::~SerialMonitor() {
     disconnect();
 }
 
-void SerialMonitor::logMessage(const std::string& level, const std::string& message) {
-    if (level == "ERROR") {
-        LOG_ERROR(message);
-    } else if (level == "WARNING") {
-        LOG_WARNING(message);
-    } else if (level == "DEBUG") {
-        LOG_DEBUG(message);
+Error SerialMonitor::failConnect(const char* what) noexcept {
+    // Captured before logging or closing can overwrite it
+    Error error = Error::fromOs(SIMON_ERROR_CONNECTION_FAILED, what);
+    char osText[16];
+    logMessage("ERROR", { what, ": ", portName, ", error: ", describeOsError(error.osError, osText) });
+    if (serialHandle != INVALID_PORT) {
+#ifdef _WIN32
+        CloseHandle(serialHandle);
+#else
+        close(serialHandle);
+#endif
+        serialHandle = INVALID_PORT;
+    }
+    metrics().connectFailures.inc();
+    return error;
+}
+
+Result<void> SerialMonitor::sendCommand(std::string_view cmd) noexcept {
+    Trace::Span span("serial", "serial write");
+    if (!connected) {
+        logMessage("ERROR", { "Cannot send command - not connected to serial port" });
+        metrics().writeErrors.inc();
+        return NOT_CONNECTED;
+    }
+    
+    logMessage("DEBUG", { "Sending command: ", cmd });
+    
+    // Commands are a few digits, so the line is built on the stack and
+    // written in one go
+    char line[64];
+    Result<void> result;
+    if (cmd.size() + 2 <= sizeof(line)) {
+        std::memcpy(line, cmd.data(), cmd.size());
+        line[cmd.size()] = '\r';
+        line[cmd.size() + 1] = '\n';
+        result = writeAll(line, cmd.size() + 2);
     } else {
-        LOG_INFO(message);
+        result = writeAll(cmd.data(), cmd.size());
+        if (result) {
+            result = writeAll("\r\n", 2);
+        }
+    }
+    
+    (result ? metrics().writes : metrics().writeErrors).inc();
+    return result;
+}
+
+void SerialMonitor::logMessage(const char* level, std::initializer_list<std::string_view> parts) noexcept {
+    Logger::LogLevel logLevel = Logger::LogLevel::INFO;
+    if (std::strcmp(level, "ERROR") == 0) {
+        logLevel = Logger::LogLevel::ERROR_LEVEL;
+    } else if (std::strcmp(level, "WARNING") == 0) {
+        logLevel = Logger::LogLevel::WARNING;
+    } else if (std::strcmp(level, "DEBUG") == 0) {
+        logLevel = Logger::LogLevel::DEBUG;
+    }
+    if (!Logger::isEnabled(logLevel)) {
+        return;
+    }
+
+    try {
+        std::string message;
+        for (std::string_view part : parts) {
+            message.append(part.data(), part.size());
+        }
+        Logger::log(logLevel, message, __FILE__, __LINE__);
+    } catch (...) {
+        // Out of memory; the port operation goes on without its message
     }
 }
 
-bool SerialMonitor::connect() {
-    logMessage("INFO", "Attempting to connect to " + portName);
+#ifdef _WIN32
+Result<void> SerialMonitor::connect() noexcept {
+    logMessage("INFO", { "Attempting to connect to ", portName });
     
     // Convert port name to wide string for Windows API
-    std::wstring wPortName(portName.begin(), portName.end());
+    std::wstring wPortName;
+    try {
+        wPortName.assign(portName.begin(), portName.end());
+    } catch (...) {
+        return OUT_OF_MEMORY;
+    }
     
     serialHandle = CreateFileW(
         wPortName.c_str(),
@@ -39,10 +221,8 @@ bool SerialMonitor::connect() {
         NULL
     );
     
-    if (serialHandle == INVALID_HANDLE_VALUE) {
-        logMessage("ERROR", "Failed to open serial port: " + portName + 
-                  ", error: " + std::to_string(GetLastError()));
-        return false;
+    if (serialHandle == INVALID_PORT) {
+        return failConnect("Failed to open serial port");
     }
     
     // Configure serial port parameters
@@ -50,10 +230,7 @@ bool SerialMonitor::connect() {
     dcbSerialParams.DCBlength = sizeof(dcbSerialParams);
     
     if (!GetCommState(serialHandle, &dcbSerialParams)) {
-        logMessage("ERROR", "Failed to get serial port state");
-        CloseHandle(serialHandle);
-        serialHandle = INVALID_HANDLE_VALUE;
-        return false;
+        return failConnect("Failed to get serial port state");
     }
     
     // Configure baud rate and other serial parameters
@@ -63,10 +240,7 @@ bool SerialMonitor::connect() {
     dcbSerialParams.Parity = NOPARITY;
     
     if (!SetCommState(serialHandle, &dcbSerialParams)) {
-        logMessage("ERROR", "Failed to set serial port state");
-        CloseHandle(serialHandle);
-        serialHandle = INVALID_HANDLE_VALUE;
-        return false;
+        return failConnect("Failed to set serial port state");
     }
     
     // Set timeouts
@@ -78,130 +252,420 @@ bool SerialMonitor::connect() {
     timeouts.WriteTotalTimeoutMultiplier = 10;
     
     if (!SetCommTimeouts(serialHandle, &timeouts)) {
-        logMessage("ERROR", "Failed to set serial timeouts");
-        CloseHandle(serialHandle);
-        serialHandle = INVALID_HANDLE_VALUE;
-        return false;
+        return failConnect("Failed to set serial timeouts");
     }
     
     connected = true;
-    logMessage("INFO", "Successfully connected to " + portName);
-    return true;
+    metrics().portsOpen.add(1);
+    publishConnection(portName, true);
+    logMessage("INFO", { "Successfully connected to ", portName });
+    return {};
 }
 
-void SerialMonitor::disconnect() {
-    if (serialHandle != INVALID_HANDLE_VALUE) {
+void SerialMonitor::disconnect() noexcept {
+    if (serialHandle != INVALID_PORT) {
         CloseHandle(serialHandle);
-        serialHandle = INVALID_HANDLE_VALUE;
+        serialHandle = INVALID_PORT;
         connected = false;
-        logMessage("INFO", "Disconnected from serial port: " + portName);
+        metrics().portsOpen.add(-1);
+        publishConnection(portName, false);
+        logMessage("INFO", { "Disconnected from serial port: ", portName });
     }
 }
 
-bool SerialMonitor::sendCommand(const std::string& cmd) {
+Result<void> SerialMonitor::writeAll(const char* data, size_t length) noexcept {
+    DWORD bytesWritten = 0;
+    if (!WriteFile(serialHandle, data, static_cast<DWORD>(length), &bytesWritten, NULL)) {
+        Error error = Error::fromOs(SIMON_ERROR_CONNECTION_FAILED, "Failed to write to serial port");
+        logMessage("ERROR", { "Failed to write to serial port" });
+        return error;
+    }
+    
+    metrics().bytesWritten.inc(bytesWritten);
+    if (bytesWritten != length) {
+        return Error{ SIMON_ERROR_TIMEOUT, 0, "Serial write timed out" };
+    }
+    return {};
+}
+
+Result<size_t> SerialMonitor::readUntil(char* buffer, size_t capacity, Deadline deadline) noexcept {
     if (!connected) {
-        logMessage("ERROR", "Cannot send command - not connected to serial port");
-        return false;
+        logMessage("ERROR", { "Cannot receive data - not connected to serial port" });
+        return NOT_CONNECTED;
     }
     
-    DWORD bytesWritten = 0;
-    std::string cmdWithNewline = cmd + "\r\n";
+    // Each ReadFile returns as soon as any bytes are queued and otherwise
+    // waits for the first byte no longer than the time left. A constant of
+    // 0 turns the last read into a non-blocking poll.
+    COMMTIMEOUTS timeouts = {0};
+    timeouts.ReadIntervalTimeout = MAXDWORD;
+    timeouts.WriteTotalTimeoutConstant = 50;
+    timeouts.WriteTotalTimeoutMultiplier = 10;
+    DWORD toRead = capacity < MAXDWORD ? static_cast<DWORD>(capacity) : MAXDWORD;
+    
+    while (true) {
+        DWORD waitMs = static_cast<DWORD>(remainingMs(deadline));
+        timeouts.ReadTotalTimeoutMultiplier = waitMs > 0 ? MAXDWORD : 0;
+        timeouts.ReadTotalTimeoutConstant = waitMs;
+        
+        DWORD bytesRead = 0;
+        if (!SetCommTimeouts(serialHandle, &timeouts) ||
+            !ReadFile(serialHandle, buffer, toRead, &bytesRead, NULL)) {
+            Error error = Error::fromOs(SIMON_ERROR_CONNECTION_FAILED, "Failed to read from serial port");
+            logMessage("ERROR", { "Failed to read from serial port" });
+            metrics().readErrors.inc();
+            return error;
+        }
+        
+        if (bytesRead > 0) {
+            metrics().bytesRead.inc(bytesRead);
+            return static_cast<size_t>(bytesRead);
+        }
+        
+        if (waitMs == 0) {
+            return 0;
+        }
+    }
+}
+
+Result<size_t> SerialMonitor::readAvailable(char* buffer, size_t capacity) noexcept {
+    if (!connected) {
+        return NOT_CONNECTED;
+    }
+
+    DWORD errors = 0;
+    COMSTAT status = {};
+    if (!ClearCommError(serialHandle, &errors, &status)) {
+        Error error = Error::fromOs(SIMON_ERROR_CONNECTION_FAILED, "Failed to query serial port");
+        char osText[16];
+        logMessage("ERROR", { "Failed to query serial port: ", portName, ", error: ",
+                              describeOsError(error.osError, osText) });
+        metrics().readErrors.inc();
+        return error;
+    }
+    if (status.cbInQue == 0) {
+        return 0;
+    }
+
+    DWORD toRead = status.cbInQue < capacity ? status.cbInQue : static_cast<DWORD>(capacity);
+    DWORD bytesRead = 0;
+    if (!ReadFile(serialHandle, buffer, toRead, &bytesRead, NULL)) {
+        Error error = Error::fromOs(SIMON_ERROR_CONNECTION_FAILED, "Failed to read from serial port");
+        logMessage("ERROR", { "Failed to read from serial port" });
+        metrics().readErrors.inc();
+        return error;
+    }
+    metrics().bytesRead.inc(bytesRead);
+    return static_cast<size_t>(bytesRead);
+}
+
+void SerialMonitor::discardInput() noexcept {
+    inbox.clear();
+    if (connected) {
+        PurgeComm(serialHandle, PURGE_RXCLEAR);
+    }
+}
+
+#else
+Result<void> SerialMonitor::connect() noexcept {
+    logMessage("INFO", { "Attempting to connect to ", portName });
+    
+    // Non-blocking so readAvailable never stalls; waits go through poll()
+    serialHandle = open(portName.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    
+    if (serialHandle == INVALID_PORT) {
+        return failConnect("Failed to open serial port");
+    }
+    
+    termios tty = {};
+    if (tcgetattr(serialHandle, &tty) != 0) {
+        return failConnect("Failed to get serial port state");
+    }
     
-    logMessage("DEBUG", "Sending command: " + cmd);
+    // 115200 8N1, raw bytes both ways
+    cfmakeraw(&tty);
+    cfsetispeed(&tty, B115200);
+    cfsetospeed(&tty, B115200);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cflag &= ~CSTOPB;
+    // VMIN=1 keeps "no data" (EAGAIN) distinct from hang-up (0 / EIO)
+    tty.c_cc[VMIN] = 1;
+    tty.c_cc[VTIME] = 0;
     
-    if (!WriteFile(serialHandle, cmdWithNewline.c_str(), cmdWithNewline.size(), &bytesWritten, NULL)) {
-        logMessage("ERROR", "Failed to write to serial port");
-        return false;
+    if (tcsetattr(serialHandle, TCSANOW, &tty) != 0) {
+        return failConnect("Failed to set serial port state");
     }
     
-    return bytesWritten == cmdWithNewline.size();
+    connected = true;
+    metrics().portsOpen.add(1);
+    publishConnection(portName, true);
+    logMessage("INFO", { "Successfully connected to ", portName });
+    return {};
 }
 
-std::string SerialMonitor::receiveData(int timeout) {
+void SerialMonitor::disconnect() noexcept {
+    if (serialHandle != INVALID_PORT) {
+        close(serialHandle);
+        serialHandle = INVALID_PORT;
+        connected = false;
+        metrics().portsOpen.add(-1);
+        publishConnection(portName, false);
+        logMessage("INFO", { "Disconnected from serial port: ", portName });
+    }
+}
+
+Result<void> SerialMonitor::writeAll(const char* data, size_t length) noexcept {
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = write(serialHandle, data + written, length - written);
+        if (n > 0) {
+            written += static_cast<size_t>(n);
+            metrics().bytesWritten.inc(static_cast<uint64_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd pfd = { serialHandle, POLLOUT, 0 };
+            int ready = poll(&pfd, 1, WRITE_TIMEOUT_MS);
+            if (ready > 0 && (pfd.revents & POLLOUT)) {
+                continue;
+            }
+            if (ready == 0) {
+                logMessage("ERROR", { "Serial write timed out on ", portName });
+                return Error{ SIMON_ERROR_TIMEOUT, 0, "Serial write timed out" };
+            }
+        }
+        Error error = Error::fromOs(SIMON_ERROR_CONNECTION_FAILED, "Failed to write to serial port");
+        logMessage("ERROR", { "Failed to write to serial port" });
+        return error;
+    }
+    return {};
+}
+
+Result<size_t> SerialMonitor::readUntil(char* buffer, size_t capacity, Deadline deadline) noexcept {
     if (!connected) {
-        logMessage("ERROR", "Cannot receive data - not connected to serial port");
-        return "";
+        logMessage("ERROR", { "Cannot receive data - not connected to serial port" });
+        return NOT_CONNECTED;
     }
     
-    char buffer[256] = {0};
-    DWORD bytesRead = 0;
+    while (true) {
+        Result<size_t> bytesRead = readAvailable(buffer, capacity);
+        if (!bytesRead || bytesRead.value() > 0) {
+            return bytesRead;
+        }
+        if (!waitReadable(serialHandle, deadline)) {
+            return 0;
+        }
+    }
+}
+
+Result<size_t> SerialMonitor::readAvailable(char* buffer, size_t capacity) noexcept {
+    if (!connected) {
+        return NOT_CONNECTED;
+    }
+
+    ssize_t n = ::read(serialHandle, buffer, capacity);
+    if (n > 0) {
+        metrics().bytesRead.inc(static_cast<uint64_t>(n));
+        return static_cast<size_t>(n);
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return 0;
+    }
+
+    // 0 is a hang-up; a pty whose other end closed reports EIO
+    Error error = n == 0 ? Error{ SIMON_ERROR_CONNECTION_FAILED, 0, "Serial port hung up" }
+                         : Error::fromOs(SIMON_ERROR_CONNECTION_FAILED, "Serial port read failed");
+    char osText[16];
+    logMessage("ERROR", { "Serial port ", portName, " closed: ",
+                          n == 0 ? std::string_view("hang-up") : describeOsError(error.osError, osText) });
+    metrics().readErrors.inc();
+    return error;
+}
+
+void SerialMonitor::discardInput() noexcept {
+    inbox.clear();
+    if (connected) {
+        tcflush(serialHandle, TCIFLUSH);
+    }
+}
+
+#endif
+
+std::string SerialMonitor::receiveData(int timeout) {
+    char buffer[READ_CHUNK];
     std::string response;
-    DWORD startTime = GetTickCount();
+    Deadline deadline = Clock::now() + std::chrono::milliseconds(timeout);
     
-    while (GetTickCount() - startTime < (DWORD)timeout) {
-        if (!ReadFile(serialHandle, buffer, sizeof(buffer) - 1, &bytesRead, NULL)) {
-            logMessage("ERROR", "Failed to read from serial port");
+    while (true) {
+        Result<size_t> bytesRead = readUntil(buffer, sizeof(buffer), deadline);
+        if (!bytesRead) {
             return "";
         }
-        
-        if (bytesRead > 0) {
-            buffer[bytesRead] = '\0';
-            response += buffer;
-            
-            // Check if we have a complete response
-            if (response.find("\n") != std::string::npos) {
-                break;
-            }
+        if (bytesRead.value() == 0) {
+            break;
         }
+        response.append(buffer, bytesRead.value());
         
-        // Short sleep to prevent CPU thrashing
-        Sleep(10);
+        // Check if we have a complete response
+        if (response.find("\n") != std::string::npos) {
+            break;
+        }
     }
     
     return response;
 }
 
-bool SerialMonitor::sendSimonGameLength(int length) {
-    std::string lengthStr = std::to_string(length);
-    return sendCommand(lengthStr);
+Result<size_t> SerialMonitor::read(char* buffer, size_t capacity, Deadline deadline) noexcept {
+    if (capacity == 0) {
+        return 0;
+    }
+    size_t buffered = inbox.take(buffer, capacity);
+    if (buffered > 0) {
+        return buffered;
+    }
+    return readUntil(buffer, capacity, deadline);
 }
 
-bool SerialMonitor::verifySimonGameSuccess(int timeout) {
-    std::string response = receiveData(timeout);
+Result<size_t> SerialMonitor::readLines(LineFramer::View* lines, size_t maxLines, Deadline deadline) noexcept {
+    if (maxLines == 0) {
+        return 0;
+    }
+    while (true) {
+        size_t count = 0;
+        while (count < maxLines && inbox.nextView(lines[count])) {
+            count++;
+        }
+        if (count > 0) {
+            return count;
+        }
+        
+        // The port reads straight into the receive buffer
+        char* space = nullptr;
+        try {
+            space = inbox.prepare(READ_CHUNK);
+        } catch (...) {
+            return OUT_OF_MEMORY;
+        }
+        Result<size_t> bytesRead = readUntil(space, READ_CHUNK, deadline);
+        inbox.commit(bytesRead ? bytesRead.value() : 0);
+        if (!bytesRead || bytesRead.value() == 0) {
+            return bytesRead;
+        }
+    }
+}
+
+Result<void> SerialMonitor::sendSimonGameLength(int length) noexcept {
+    char digits[16];
+    std::to_chars_result converted = std::to_chars(digits, digits + sizeof(digits), length);
+    return sendCommand(std::string_view(digits, static_cast<size_t>(converted.ptr - digits)));
+}
+
+bool SerialMonitor::verifySimonGameSuccess(int timeout) noexcept {
+    auto started = std::chrono::steady_clock::now();
+    LineFramer::View lines[8];
+    Result<size_t> count = 0;
+    {
+        Trace::Span span("serial", "device wait");
+        count = readLines(lines, sizeof(lines) / sizeof(lines[0]), started + std::chrono::milliseconds(timeout));
+    }
+    metrics().verifyDuration.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
     
-    // Look for "True" in the response
-    size_t truePos = response.find("True");
-    if (truePos != std::string::npos) {
-        logMessage("INFO", "Simon game completed successfully");
+    // Look for "True" in the reply, in place
+    bool passed = false;
+    {
+        Trace::Span span("serial", "parse");
+        for (size_t i = 0; count && i < count.value() && !passed; i++) {
+            passed = std::string_view(lines[i].data, lines[i].length).find("True") != std::string_view::npos;
+        }
+    }
+    // Anything else the board sent belongs to this round
+    bool silent = (!count || count.value() == 0) && inbox.unread() == 0;
+    inbox.clear();
+    
+    if (passed) {
+        metrics().verifiedTrue.inc();
+        logMessage("INFO", { "Simon game completed successfully" });
         return true;
     }
     
-    logMessage("WARNING", "Simon game failed or timed out");
+    if (!count) {
+        LastError::set(count.error());
+    } else if (silent) {
+        LastError::set({ SIMON_ERROR_TIMEOUT, 0, "No reply from the board before the timeout" });
+    }
+    (silent ? metrics().verifyTimeouts : metrics().verifiedFalse).inc();
+    logMessage("WARNING", { "Simon game failed or timed out" });
     return false;
 }
 
-void SerialMonitor::startMonitoring(std::function<void(const std::string&)> callback) {
+void SerialMonitor::startMonitoring(std::function<void(const std::string&)> callback, EventLoop* loop) {
     if (!connected) {
-        logMessage("ERROR", "Cannot start monitoring - not connected");
+        logMessage("ERROR", { "Cannot start monitoring - not connected" });
         return;
     }
     
     dataCallback = callback;
+    if (loop != nullptr) {
+        monitorLoop = loop;
+        monitorLoop->watch(serialHandle, [this]() { onMonitorReadable(); });
+        logMessage("INFO", { "Started serial monitoring on event loop" });
+        return;
+    }
     shouldRun = true;
     monitorThread = std::thread(&SerialMonitor::monitorTask, this);
-    logMessage("INFO", "Started serial monitoring");
+    logMessage("INFO", { "Started serial monitoring" });
 }
 
 void SerialMonitor::stopMonitoring() {
+    if (monitorLoop != nullptr) {
+        monitorLoop->unwatch(serialHandle);
+        monitorLoop = nullptr;
+        logMessage("INFO", { "Stopped serial monitoring" });
+    }
     shouldRun = false;
     if (monitorThread.joinable()) {
         monitorThread.join();
-        logMessage("INFO", "Stopped serial monitoring");
+        logMessage("INFO", { "Stopped serial monitoring" });
     }
 }
 
 void SerialMonitor::monitorTask() {
-    logMessage("INFO", "Monitor thread started");
+    logMessage("INFO", { "Monitor thread started" });
     while (shouldRun) {
-        std::string data = receiveData(100);
-        if (!data.empty()) {
-            logMessage("DATA", data);
-            
-            if (dataCallback) {
-                dataCallback(data);
-            }
-        }
+        deliver(receiveData(100));
         std::this_thread::sleep_for(std::chrono::milliseconds(50));
     }
-    logMessage("INFO", "Monitor thread ended");
+    logMessage("INFO", { "Monitor thread ended" });
+}
+
+void SerialMonitor::onMonitorReadable() {
+    std::string data;
+    char buffer[256];
+    while (true) {
+        Result<size_t> bytesRead = readAvailable(buffer, sizeof(buffer));
+        if (!bytesRead) {
+            logMessage("ERROR", { "Serial monitoring stopped, read failed on ", portName });
+            monitorLoop->unwatch(serialHandle);
+            monitorLoop = nullptr;
+            break;
+        }
+        if (bytesRead.value() == 0) {
+            break;
+        }
+        data.append(buffer, bytesRead.value());
+    }
+    deliver(data);
+}
+
+void SerialMonitor::deliver(const std::string& data) {
+    if (data.empty()) {
+        return;
+    }
+    logMessage("DATA", { data });
+    if (dataCallback) {
+        dataCallback(data);
+    }
 }
\ No newline at end of file
@@ -1,41 +1,97 @@
 #pragma once
+#include "LineFramer.hpp"
 #include "Logger.hpp"
+#include "Result.hpp"
+#ifdef _WIN32
 #include <windows.h>
+#endif
+#include <chrono>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <atomic>
 #include <functional>
+#include <initializer_list>
 #include <vector>
 
+class EventLoop;
+
+// The port operations are noexcept and report failures as Results. They log
+// without throwing and give up on a read, rather than throw, if the receive
+// buffer cannot grow. The monitoring callbacks are the exception, since they
+// hand out strings.
 class SerialMonitor {
+public:
+#ifdef _WIN32
+    using NativeHandle = HANDLE;
+#else
+    using NativeHandle = int;
+#endif
+    using Deadline = std::chrono::steady_clock::time_point;
+
 private:
-    HANDLE serialHandle;
+    NativeHandle serialHandle;
     bool connected;
     std::string portName;
     std::atomic<bool> shouldRun;
     std::thread monitorThread;
+    EventLoop* monitorLoop;
     std::function<void(const std::string&)> dataCallback;
+    LineFramer inbox;   // bytes read by readLines and verifySimonGameSuccess
 
 public:
     SerialMonitor(const std::string& port = "COM7");
     ~SerialMonitor();
     
-    bool connect();
-    void disconnect();
-    bool isConnected() const { return connected; }
+    Result<void> connect() noexcept;
+    void disconnect() noexcept;
+    bool isConnected() const noexcept { return connected; }
     
-    bool sendCommand(const std::string& cmd);
+    // Writes `cmd` and a "\r\n" terminator
+    Result<void> sendCommand(std::string_view cmd) noexcept;
     std::string receiveData(int timeout = 1000);
+
+    // Reads whatever the port has already buffered without waiting. Yields
+    // the byte count, 0 if nothing is pending.
+    Result<size_t> readAvailable(char* buffer, size_t capacity) noexcept;
+
+    // Drops everything received but not yet read, both here and in the OS
+    // receive buffer, e.g. a reply to a challenge that was given up on
+    void discardInput() noexcept;
+
+    // Reads without an intermediate string, waiting for data until
+    // `deadline`. read() fills `buffer` with raw bytes, starting with any
+    // already in the receive buffer. readLines() hands out complete lines as
+    // views into the receive buffer, valid until releaseLines() or the next
+    // read of any kind. Both yield a count, 0 if the deadline passed first.
+    Result<size_t> read(char* buffer, size_t capacity, Deadline deadline) noexcept;
+    Result<size_t> readLines(LineFramer::View* lines, size_t maxLines, Deadline deadline) noexcept;
+    void releaseLines() noexcept { inbox.compact(); }
+
+    // Port handle (a file descriptor on POSIX) for callers multiplexing
+    // several ports in one event loop.
+    NativeHandle nativeHandle() const { return serialHandle; }
+    const std::string& getPortName() const { return portName; }
     
     // Simon game-specific functions
-    bool sendSimonGameLength(int length);
-    bool verifySimonGameSuccess(int timeout = 5000);
+    Result<void> sendSimonGameLength(int length) noexcept;
+    // False on a failed round, a timeout or a port failure; the last two are
+    // also recorded in LastError
+    bool verifySimonGameSuccess(int timeout = 5000) noexcept;
     
-    // Monitoring with callback
-    void startMonitoring(std::function<void(const std::string&)> callback = nullptr);
+    // Monitoring with callback, on a thread of its own or, given a loop, on
+    // the thread driving that loop (then stopMonitoring must be called there)
+    void startMonitoring(std::function<void(const std::string&)> callback = nullptr, EventLoop* loop = nullptr);
     void stopMonitoring();
 
 private:
+    Error failConnect(const char* what) noexcept;
+    Result<void> writeAll(const char* data, size_t length) noexcept;
+    // Waits for bytes until `deadline` and reads them into `buffer`
+    Result<size_t> readUntil(char* buffer, size_t capacity, Deadline deadline) noexcept;
     void monitorTask();
-    void logMessage(const std::string& level, const std::string& message);
+    void onMonitorReadable();
+    void deliver(const std::string& data);
+    // Joins `parts` into one message; dropped if that cannot be allocated
+    void logMessage(const char* level, std::initializer_list<std::string_view> parts) noexcept;
 };
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "Trace.hpp"
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+std::atomic<bool> Trace::enabled(false);
+
+namespace {
+    struct Event {
+        const char* category;
+        const char* name;
+        uint64_t start;
+        uint64_t duration;
+        int64_t arg;
+    };
+
+    // One per live thread. The mutex is only contended while exporting.
+    struct ThreadBuffer {
+        int tid;
+        const char* threadName;
+        std::mutex mutex;
+        std::vector<Event> events;
+        size_t next = 0;
+        bool wrapped = false;
+    };
+
+    // Buffers outlive their threads so their events can still be exported.
+    // Short-lived threads (one per challenge) hand theirs back on exit to
+    // keep the number of buffers bounded.
+    struct Buffers {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> all;
+        std::vector<std::shared_ptr<ThreadBuffer>> idle;
+    };
+
+    Buffers& buffers() {
+        static Buffers instance;
+        return instance;
+    }
+
+    thread_local const char* currentThreadName = nullptr;
+
+    struct BufferLease {
+        std::shared_ptr<ThreadBuffer> buffer;
+
+        ~BufferLease() {
+            if (buffer) {
+                Buffers& registry = buffers();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                registry.idle.push_back(buffer);
+            }
+        }
+    };
+
+    thread_local BufferLease lease;
+
+    ThreadBuffer& threadBuffer() {
+        if (!lease.buffer) {
+            Buffers& registry = buffers();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            if (!registry.idle.empty()) {
+                lease.buffer = registry.idle.back();
+                registry.idle.pop_back();
+            } else {
+                lease.buffer = std::make_shared<ThreadBuffer>();
+                lease.buffer->tid = static_cast<int>(registry.all.size()) + 1;
+                lease.buffer->events.resize(Trace::EVENTS_PER_THREAD);
+                registry.all.push_back(lease.buffer);
+            }
+            std::lock_guard<std::mutex> bufferLock(lease.buffer->mutex);
+            lease.buffer->threadName = currentThreadName;
+        }
+        return *lease.buffer;
+    }
+
+    void appendEscaped(std::ostringstream& out, const char* text) {
+        for (const char* c = text; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                out << '\\';
+            }
+            out << *c;
+        }
+    }
+
+    void appendMicros(std::ostringstream& out, uint64_t ns) {
+        out << ns / 1000 << "." << static_cast<char>('0' + ns / 100 % 10)
+            << static_cast<char>('0' + ns / 10 % 10) << static_cast<char>('0' + ns % 10);
+    }
+}
+
+void Trace::setEnabled(bool enable) {
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+void Trace::record(const char* category, const char* name, uint64_t startNs, uint64_t endNs, int64_t arg) {
+    if (!isEnabled()) {
+        return;
+    }
+
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.events[buffer.next] = Event{ category, name, startNs, endNs > startNs ? endNs - startNs : 0, arg };
+    if (++buffer.next == buffer.events.size()) {
+        buffer.next = 0;
+        buffer.wrapped = true;
+    }
+}
+
+void Trace::setThreadName(const char* name) {
+    currentThreadName = name;
+    if (lease.buffer) {
+        std::lock_guard<std::mutex> lock(lease.buffer->mutex);
+        lease.buffer->threadName = name;
+    }
+}
+
+std::string Trace::exportChromeJson() {
+    std::ostringstream out;
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+
+    Buffers& registry = buffers();
+    std::lock_guard<std::mutex> registryLock(registry.mutex);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : registry.all) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+
+        if (buffer->threadName) {
+            out << (first ? "" : ",") << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":"
+                << buffer->tid << ",\"args\":{\"name\":\"";
+            appendEscaped(out, buffer->threadName);
+            out << "\"}}";
+            first = false;
+        }
+
+        size_t count = buffer->wrapped ? buffer->events.size() : buffer->next;
+        size_t begin = buffer->wrapped ? buffer->next : 0;
+        for (size_t i = 0; i < count; i++) {
+            const Event& event = buffer->events[(begin + i) % buffer->events.size()];
+            out << (first ? "" : ",") << "\n{\"ph\":\"X\",\"cat\":\"";
+            appendEscaped(out, event.category);
+            out << "\",\"name\":\"";
+            appendEscaped(out, event.name);
+            out << "\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":";
+            appendMicros(out, event.start);
+            out << ",\"dur\":";
+            appendMicros(out, event.duration);
+            if (event.arg >= 0) {
+                out << ",\"args\":{\"value\":" << event.arg << "}";
+            }
+            out << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    return out.str();
+}
+
+bool Trace::writeChromeJson(const std::string& path) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    file << exportChromeJson();
+    return static_cast<bool>(file);
+}
+
+void Trace::clear() {
+    Buffers& registry = buffers();
+    std::lock_guard<std::mutex> registryLock(registry.mutex);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : registry.all) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        buffer->next = 0;
+        buffer->wrapped = false;
+    }
+}
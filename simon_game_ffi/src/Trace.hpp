@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Scoped spans over the challenge lifecycle, exported as Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev).
+//
+// Each thread records into its own fixed-size ring, so recording never
+// contends with other threads; the oldest events are overwritten once a
+// ring is full. While tracing is disabled a span costs one relaxed load.
+// Names and categories must be string literals (they are stored by pointer).
+class Trace {
+public:
+    static constexpr size_t EVENTS_PER_THREAD = 16384;
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // Nanoseconds on the steady clock, the timebase of every span
+    static uint64_t at(std::chrono::steady_clock::time_point time) {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+    }
+    static uint64_t now() { return at(std::chrono::steady_clock::now()); }
+
+    // Records a span whose ends were measured separately, e.g. across
+    // threads. `arg` (if >= 0) is shown as the span's "value".
+    static void record(const char* category, const char* name, uint64_t startNs, uint64_t endNs, int64_t arg = -1);
+
+    // Labels the calling thread's lane in the exported trace
+    static void setThreadName(const char* name);
+
+    static std::string exportChromeJson();
+    static bool writeChromeJson(const std::string& path);
+    static void clear();
+
+    class Span {
+    public:
+        Span(const char* spanCategory, const char* spanName, int64_t spanArg = -1)
+            : category(spanCategory), name(spanName), arg(spanArg), start(isEnabled() ? now() : 0) {}
+        ~Span() {
+            if (start != 0) {
+                record(category, name, start, now(), arg);
+            }
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        const char* category;
+        const char* name;
+        int64_t arg;
+        uint64_t start;
+    };
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SPAN(category, name) Trace::Span TRACE_CONCAT(traceSpan, __LINE__)(category, name)
@@ -0,0 +1,243 @@
+#include "TriggerMatcher.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <stdexcept>
+
+namespace {
+    std::atomic<uint64_t> nextGeneration(1);
+
+    // NFA item: trigger `t` with `p` steps already matched
+    inline uint32_t makeItem(size_t t, size_t p) {
+        return static_cast<uint32_t>(t * (TriggerMatcher::MAX_STEPS + 1) + p);
+    }
+}
+
+TriggerMatcher::TriggerMatcher(std::vector<Trigger> triggerList)
+    : triggers(std::move(triggerList)), generation(nextGeneration++), symbolCount(1) {
+    symbols.fill(0);
+
+    for (const Trigger& trigger : triggers) {
+        if (trigger.steps.empty() || trigger.steps.size() > MAX_STEPS) {
+            throw std::invalid_argument("trigger must have between 1 and " + std::to_string(MAX_STEPS) + " steps");
+        }
+        for (const Step& step : trigger.steps) {
+            if (step.key == 0 || step.key > 0xFF) {
+                throw std::invalid_argument("invalid virtual key code: " + std::to_string(step.key));
+            }
+            if (step.modifiers != MOD_ANY && step.modifiers > 0x0F) {
+                throw std::invalid_argument("invalid modifier mask: " + std::to_string(step.modifiers));
+            }
+        }
+        finalKeys.set(trigger.steps.back().key);
+    }
+
+    // Group the (modifiers, vk) slots into symbols: two slots share a symbol
+    // when exactly the same trigger steps accept them.
+    std::map<std::vector<uint32_t>, uint16_t> symbolIds;
+    std::vector<std::vector<uint32_t>> symbolSteps(1);
+
+    for (size_t slot = 0; slot < symbols.size(); slot++) {
+        uint8_t modifiers = static_cast<uint8_t>(slot >> 8);
+        uint16_t key = static_cast<uint16_t>(slot & 0xFF);
+
+        std::vector<uint32_t> matching;
+        for (size_t t = 0; t < triggers.size(); t++) {
+            const std::vector<Step>& steps = triggers[t].steps;
+            for (size_t p = 0; p < steps.size(); p++) {
+                if (steps[p].key == key && (steps[p].modifiers == MOD_ANY || steps[p].modifiers == modifiers)) {
+                    matching.push_back(makeItem(t, p));
+                }
+            }
+        }
+        if (matching.empty()) {
+            continue;
+        }
+
+        auto it = symbolIds.find(matching);
+        if (it == symbolIds.end()) {
+            it = symbolIds.emplace(matching, symbolCount++).first;
+            symbolSteps.push_back(matching);
+        }
+        symbols[slot] = it->second;
+    }
+
+    // Subset construction. A DFA state is the sorted set of NFA items that are
+    // still alive; the start state is the empty set.
+    std::map<std::vector<uint32_t>, uint32_t> stateIds;
+    std::vector<std::vector<uint32_t>> states;
+    stateIds.emplace(std::vector<uint32_t>(), 0);
+    states.emplace_back();
+
+    for (size_t s = 0; s < states.size(); s++) {
+        transitions.resize((s + 1) * symbolCount, 0);
+
+        for (uint16_t sym = 1; sym < symbolCount; sym++) {
+            std::vector<uint32_t> next;
+            for (uint32_t item : symbolSteps[sym]) {
+                size_t t = item / (MAX_STEPS + 1);
+                size_t p = item % (MAX_STEPS + 1);
+                if (p == 0 || std::binary_search(states[s].begin(), states[s].end(), item)) {
+                    next.push_back(makeItem(t, p + 1));
+                }
+            }
+            std::sort(next.begin(), next.end());
+            next.erase(std::unique(next.begin(), next.end()), next.end());
+
+            auto it = stateIds.find(next);
+            if (it == stateIds.end()) {
+                if (states.size() >= MAX_STATES) {
+                    throw std::invalid_argument("trigger set too large to compile");
+                }
+                it = stateIds.emplace(next, static_cast<uint32_t>(states.size())).first;
+                states.push_back(next);
+            }
+            transitions[s * symbolCount + sym] = it->second;
+        }
+    }
+
+    // A state accepts every trigger it completes, longest first and ties in
+    // registration order, so one whose window has passed can fall back to a
+    // shorter one ending in the same key
+    acceptingStart.assign(states.size() + 1, 0);
+    for (size_t s = 0; s < states.size(); s++) {
+        acceptingStart[s] = static_cast<uint32_t>(accepting.size());
+        for (uint32_t item : states[s]) {
+            size_t t = item / (MAX_STEPS + 1);
+            size_t p = item % (MAX_STEPS + 1);
+            if (p == triggers[t].steps.size()) {
+                accepting.push_back(static_cast<int>(t));
+            }
+        }
+        std::sort(accepting.begin() + acceptingStart[s], accepting.end(), [this](int a, int b) {
+            return triggers[a].steps.size() > triggers[b].steps.size() ||
+                   (triggers[a].steps.size() == triggers[b].steps.size() && a < b);
+        });
+    }
+    acceptingStart[states.size()] = static_cast<uint32_t>(accepting.size());
+
+    // Prediction tables; ties go to the longer challenge so a round started
+    // early covers whichever candidate fires
+    auto longer = [this](int current, size_t t) {
+        return current < 0 || triggers[t].targetCounter > triggers[current].targetCounter;
+    };
+
+    nearlyComplete.assign(states.size(), -1);
+    for (size_t s = 1; s < states.size(); s++) {
+        for (uint32_t item : states[s]) {
+            size_t t = item / (MAX_STEPS + 1);
+            size_t p = item % (MAX_STEPS + 1);
+            if (p + 1 == triggers[t].steps.size() && longer(nearlyComplete[s], t)) {
+                nearlyComplete[s] = static_cast<int>(t);
+            }
+        }
+    }
+
+    heldChords.fill(-1);
+    for (size_t t = 0; t < triggers.size(); t++) {
+        uint8_t modifiers = triggers[t].steps.front().modifiers;
+        if (triggers[t].steps.size() == 1 && modifiers != MOD_ANY && modifiers != MOD_NONE &&
+            longer(heldChords[modifiers], t)) {
+            heldChords[modifiers] = static_cast<int>(t);
+        }
+    }
+}
+
+int TriggerMatcher::predict(const Cursor& cursor) const {
+    if (cursor.generation == generation) {
+        int index = nearlyComplete[cursor.state];
+        if (index >= 0) {
+            return index;
+        }
+    }
+    return heldChords[foldModifiers(cursor.heldModifiers)];
+}
+
+uint8_t TriggerMatcher::heldModifierBit(uint32_t vkCode) {
+    switch (vkCode) {
+        case KeyCodes::LSHIFT:   return 0x01;
+        case KeyCodes::RSHIFT:   return 0x02;
+        case KeyCodes::LCONTROL: return 0x04;
+        case KeyCodes::RCONTROL: return 0x08;
+        case KeyCodes::LMENU:    return 0x10;
+        case KeyCodes::RMENU:    return 0x20;
+        case KeyCodes::LWIN:     return 0x40;
+        case KeyCodes::RWIN:     return 0x80;
+        default:          return 0;
+    }
+}
+
+uint8_t TriggerMatcher::foldModifiers(uint8_t held) {
+    return ((held & 0x0C) ? MOD_CTRL : 0) |
+           ((held & 0x03) ? MOD_SHIFT : 0) |
+           ((held & 0x30) ? MOD_ALT : 0) |
+           ((held & 0xC0) ? MOD_WIN : 0);
+}
+
+#ifdef _WIN32
+void TriggerMatcher::syncModifiers(Cursor& cursor) {
+    static const uint16_t modifierKeys[] = {
+        KeyCodes::LSHIFT, KeyCodes::RSHIFT, KeyCodes::LCONTROL, KeyCodes::RCONTROL,
+        KeyCodes::LMENU, KeyCodes::RMENU, KeyCodes::LWIN, KeyCodes::RWIN
+    };
+
+    cursor.heldModifiers = 0;
+    for (uint16_t vk : modifierKeys) {
+        if (GetAsyncKeyState(static_cast<int>(vk)) & 0x8000) {
+            cursor.heldModifiers |= heldModifierBit(vk);
+        }
+    }
+    cursor.state = 0;
+}
+#endif
+
+int TriggerMatcher::advance(Cursor& cursor, uint32_t vkCode, bool keyDown, uint32_t time) const {
+    uint8_t modifierBit = heldModifierBit(vkCode);
+    if (modifierBit) {
+        if (keyDown) {
+            cursor.heldModifiers |= modifierBit;
+        } else {
+            cursor.heldModifiers &= ~modifierBit;
+        }
+    }
+
+    if (!keyDown) {
+        return -1;
+    }
+
+    if (cursor.generation != generation) {
+        cursor.generation = generation;
+        cursor.state = 0;
+    }
+
+    uint16_t symbol = symbols[(foldModifiers(cursor.heldModifiers) << 8) | (vkCode & 0xFF)];
+    if (symbol == 0) {
+        // Modifiers on their own never break a sequence in progress
+        if (!modifierBit) {
+            cursor.state = 0;
+        }
+        return -1;
+    }
+
+    cursor.history[cursor.historyPos++ % MAX_STEPS] = time;
+    cursor.state = transitions[cursor.state * symbolCount + symbol];
+
+    for (uint32_t i = acceptingStart[cursor.state]; i < acceptingStart[cursor.state + 1]; i++) {
+        int index = accepting[i];
+        const Trigger& matched = triggers[index];
+        size_t length = matched.steps.size();
+        if (matched.windowMs != 0 && length > 1) {
+            uint32_t first = cursor.history[static_cast<uint8_t>(cursor.historyPos - length) % MAX_STEPS];
+            if (time - first > matched.windowMs) {
+                continue;
+            }
+        }
+
+        cursor.state = 0;
+        return index;
+    }
+    return -1;
+}
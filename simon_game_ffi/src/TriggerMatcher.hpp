@@ -0,0 +1,91 @@
+#pragma once
+#include "KeyEvent.hpp"
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+// Matches chords (e.g. Ctrl+Shift+S) and timed key sequences against the
+// low-level keyboard stream. The registered triggers are compiled into a DFA
+// whose alphabet is (modifier state, vkCode), so the hook advances it with a
+// couple of table loads per event.
+class TriggerMatcher {
+public:
+    enum Modifier : uint8_t {
+        MOD_NONE  = 0,
+        MOD_CTRL  = 1,
+        MOD_SHIFT = 2,
+        MOD_ALT   = 4,
+        MOD_WIN   = 8,
+        MOD_ANY   = 0xFF
+    };
+
+    static constexpr size_t MAX_STEPS = 8;
+    static constexpr size_t MAX_STATES = 4096;
+
+    struct Step {
+        uint16_t key;
+        uint8_t modifiers;
+    };
+
+    struct Trigger {
+        std::vector<Step> steps;
+        uint32_t windowMs;      // 0 = no limit between first and last step
+        int targetCounter;
+    };
+
+    // Per-hook matching state. Only touched by the thread running the hook.
+    struct Cursor {
+        uint64_t generation = 0;
+        uint32_t state = 0;
+        uint8_t heldModifiers = 0;      // left/right modifier keys, one bit each
+        uint8_t historyPos = 0;
+        std::array<uint32_t, MAX_STEPS> history = {};
+    };
+
+    // Throws std::invalid_argument on malformed triggers or if the DFA
+    // would exceed MAX_STATES.
+    explicit TriggerMatcher(std::vector<Trigger> triggers);
+
+    // Feeds one key event. Returns the index of the trigger completed by this
+    // event, or -1.
+    int advance(Cursor& cursor, uint32_t vkCode, bool keyDown, uint32_t time) const;
+
+#ifdef _WIN32
+    // Reloads the held modifiers from the OS, for when the cursor may have
+    // missed key events (e.g. the hook skipped them for an ungated window).
+    static void syncModifiers(Cursor& cursor);
+#endif
+
+    const Trigger& trigger(int index) const { return triggers[index]; }
+    const std::vector<Trigger>& all() const { return triggers; }
+
+    // True if `vkCode` is the last key of any trigger, i.e. a key the hook
+    // has to hold back while a challenge is pending.
+    bool isFinalKey(uint32_t vkCode) const { return finalKeys.test(vkCode & 0xFF); }
+
+    // Trigger that the next key press is likely to complete, or -1: one the
+    // cursor has matched all but the last step of, or a single-step chord
+    // whose modifiers are held right now. Among candidates, the one with the
+    // longest challenge wins.
+    int predict(const Cursor& cursor) const;
+
+    size_t stateCount() const { return acceptingStart.size() - 1; }
+
+private:
+    static uint8_t heldModifierBit(uint32_t vkCode);
+    static uint8_t foldModifiers(uint8_t held);
+
+    std::vector<Trigger> triggers;
+    uint64_t generation;
+    uint16_t symbolCount;
+    std::array<uint16_t, 16 * 256> symbols;     // (modifiers << 8 | vk) -> symbol, 0 = none
+    std::vector<uint32_t> transitions;          // state * symbolCount + symbol -> state
+    // Triggers each state completes, longest first: state s owns
+    // accepting[acceptingStart[s] .. acceptingStart[s + 1])
+    std::vector<uint32_t> acceptingStart;
+    std::vector<int> accepting;
+    std::vector<int> nearlyComplete;            // state -> trigger one step from done, or -1
+    std::array<int, 16> heldChords;             // folded modifiers -> single-step chord, or -1
+    std::bitset<256> finalKeys;
+};
@@ -1,9 +1,29 @@
 #include "simon_game.h"
 #include "SerialMonitor.hpp"
 #include "middleWhere.hpp"
+#include "DevicePool.hpp"
+#include "EventChannel.hpp"
+#include "EventLoop.hpp"
+#include "Metrics.hpp"
+#include "MetricsServer.hpp"
+#include "Trace.hpp"
 #include "Logger.hpp"
+#include "Result.hpp"
+#include "ScreenLock.hpp"
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstring>
 #include <map>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <vector>
+#ifndef _WIN32
+#include <poll.h>
+#endif
 
 // Structure to hold the actual SerialMonitor instance
 struct SerialMonitorHandle {
@@ -12,29 +32,112 @@ struct SerialMonitorHandle {
     explicit SerialMonitorHandle(const std::string& port) : monitor(port) {}
 };
 
-// Structure to hold the middleware state
+// Structure to hold the middleware instance owned by this handle
 struct KeyboardMiddlewareHandle {
-    bool initialized;
-    KeyboardMiddlewareHandle() : initialized(false) {}
+    KeyboardMiddleware middleware;
 };
 
-// Store callback pointers for use in C++ context
-static simon_send_callback_t g_send_callback = nullptr;
-static simon_receive_callback_t g_receive_callback = nullptr;
+struct DevicePoolHandle {
+    DevicePool pool;
 
-// C++ wrapper for send callback
-void cpp_send_callback_wrapper(int counter) {
-    if (g_send_callback) {
-        g_send_callback(counter);
+    DevicePoolHandle(const DevicePool::Options& options, EventLoop* loop) : pool(options, loop) {}
+};
+
+struct EventSubscriptionHandle {
+    EventChannel::Subscription subscription;
+};
+
+// Shared with the middleware the lock was attached to
+struct ScreenLockHandle {
+    std::shared_ptr<ScreenLock> lock;
+};
+
+static_assert(sizeof(simon_event_t) == sizeof(EventChannel::Event), "simon_event_t mirrors EventChannel::Event");
+static_assert(sizeof(simon_line_t) == sizeof(LineFramer::View) &&
+              offsetof(simon_line_t, length) == offsetof(LineFramer::View, length),
+              "simon_line_t mirrors LineFramer::View");
+
+namespace {
+    // snprintf-style copy shared by the text dump functions
+    size_t copyOut(const std::string& text, char* buffer, size_t size) {
+        if (buffer && size > 0) {
+            size_t copied = text.size() < size - 1 ? text.size() : size - 1;
+            std::memcpy(buffer, text.data(), copied);
+            buffer[copied] = '\0';
+        }
+        return text.size();
+    }
+
+    const Error NULL_HANDLE = { SIMON_ERROR_NULL_HANDLE, 0, "Null handle" };
+    const Error NOT_INITIALIZED = { SIMON_ERROR_HOOK_FAILED, 0, "Keyboard middleware is not initialized" };
+    // Whatever a catch (...) stopped, most likely running out of memory
+    const Error INTERNAL_ERROR = { SIMON_ERROR_UNKNOWN, 0, "Internal error" };
+
+    Error invalidParameter(const char* what) {
+        return { SIMON_ERROR_INVALID_PARAMETER, 0, what };
+    }
+
+    // Checks one C trigger description and converts it
+    Result<void> toTrigger(const simon_key_step* steps, int stepCount, int windowMs, int targetCount,
+                           TriggerMatcher::Trigger& trigger) {
+        if (!steps || stepCount <= 0 || stepCount > static_cast<int>(TriggerMatcher::MAX_STEPS)) {
+            return invalidParameter("steps is NULL or step_count out of range");
+        }
+        if (windowMs < 0) return invalidParameter("window_ms is negative");
+        if (targetCount <= 0) return invalidParameter("target_count must be positive");
+
+        trigger.steps.clear();
+        for (int i = 0; i < stepCount; i++) {
+            if (steps[i].key_code <= 0 || steps[i].key_code > 0xFF) return invalidParameter("key_code out of range");
+            if (steps[i].modifiers != SIMON_MOD_ANY && (steps[i].modifiers < 0 || steps[i].modifiers > 0x0F)) {
+                return invalidParameter("modifiers out of range");
+            }
+            trigger.steps.push_back({ static_cast<uint16_t>(steps[i].key_code), static_cast<uint8_t>(steps[i].modifiers) });
+        }
+        trigger.windowMs = static_cast<uint32_t>(windowMs);
+        trigger.targetCounter = targetCount;
+        return {};
     }
-}
 
-// C++ wrapper for receive callback
-bool cpp_receive_callback_wrapper() {
-    if (g_receive_callback) {
-        return g_receive_callback() != 0;
+    Result<void> toTriggers(const simon_key_config* keys, size_t count, std::vector<TriggerMatcher::Trigger>& triggers) {
+        if (!keys && count > 0) return invalidParameter("keys is NULL");
+
+        for (size_t i = 0; i < count; i++) {
+            simon_key_step step = { keys[i].key_code, keys[i].modifiers };
+            TriggerMatcher::Trigger trigger;
+            Result<void> result = toTrigger(&step, 1, 0, keys[i].target_count, trigger);
+            if (!result) return result;
+            triggers.push_back(std::move(trigger));
+        }
+        return {};
+    }
+
+    // simon_clock_ns() value to a steady_clock deadline; values past the
+    // clock's range mean no deadline
+    EventLoop::Clock::time_point fromClockNs(uint64_t ns) {
+        if (ns > static_cast<uint64_t>(INT64_MAX)) {
+            return EventLoop::Clock::time_point::max();
+        }
+        return EventLoop::Clock::time_point(std::chrono::duration_cast<EventLoop::Clock::duration>(
+            std::chrono::nanoseconds(ns)));
+    }
+
+    Result<void> toNames(const char* const* names, size_t count, std::vector<std::string>& out) {
+        if (!names && count > 0) return invalidParameter("scope list is NULL");
+
+        for (size_t i = 0; i < count; i++) {
+            if (!names[i]) return invalidParameter("scope name is NULL");
+            out.push_back(names[i]);
+        }
+        return {};
     }
-    return false;
+
+    std::mutex metricsServerMutex;
+    std::unique_ptr<MetricsServer> metricsServer;
+
+    // Set once by simon_reactor_enable and never freed, like the objects
+    // that may still be watched by it
+    std::atomic<EventLoop*> reactor(nullptr);
 }
 
 // SerialMonitor implementation
@@ -45,6 +148,7 @@ serial_monitor_t sm_create(const char* port_name) {
         std::string port = port_name ? port_name : "COM6";
         return new SerialMonitorHandle(port);
     } catch (...) {
+        LastError::set({ SIMON_ERROR_UNKNOWN, 0, "Could not allocate a serial monitor" });
         return nullptr;
     }
 }
@@ -55,83 +159,212 @@ void sm_destroy(serial_monitor_t handle) {
     }
 }
 
+// The sm_* calls below go straight to the noexcept SerialMonitor core, so
+// they need no exception handling and record failures for simon_last_error
+
 simon_error_t sm_connect(serial_monitor_t handle) {
-    if (!handle) return SIMON_ERROR_NULL_HANDLE;
-    
+    if (!handle) return LastError::fail(NULL_HANDLE);
+
+    Result<void> result = handle->monitor.connect();
+    return result ? SIMON_SUCCESS : LastError::fail(result.error());
+}
+
+simon_error_t sm_disconnect(serial_monitor_t handle) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+
+    handle->monitor.disconnect();
+    return SIMON_SUCCESS;
+}
+
+simon_error_t sm_send_command(serial_monitor_t handle, const char* command) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (!command) return LastError::fail(invalidParameter("command is NULL"));
+
+    Result<void> result = handle->monitor.sendCommand(command);
+    return result ? SIMON_SUCCESS : LastError::fail(result.error());
+}
+
+simon_error_t sm_send_simon_game_length(serial_monitor_t handle, int length) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (length <= 0) return LastError::fail(invalidParameter("length must be positive"));
+
+    Result<void> result = handle->monitor.sendSimonGameLength(length);
+    return result ? SIMON_SUCCESS : LastError::fail(result.error());
+}
+
+int sm_verify_simon_game_success(serial_monitor_t handle, int timeout_ms) {
+    if (!handle) {
+        LastError::set(NULL_HANDLE);
+        return 0;
+    }
+    return handle->monitor.verifySimonGameSuccess(timeout_ms) ? 1 : 0;
+}
+
+int sm_is_connected(serial_monitor_t handle) {
+    if (!handle) return 0;
+    return handle->monitor.isConnected() ? 1 : 0;
+}
+
+int sm_read(serial_monitor_t handle, void* buffer, size_t capacity, uint64_t deadline_ns) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (!buffer && capacity > 0) return LastError::fail(invalidParameter("buffer is NULL"));
+
+    size_t clamped = capacity < static_cast<size_t>(INT_MAX) ? capacity : static_cast<size_t>(INT_MAX);
+    Result<size_t> bytesRead = handle->monitor.read(static_cast<char*>(buffer), clamped, fromClockNs(deadline_ns));
+    return bytesRead ? static_cast<int>(bytesRead.value()) : LastError::fail(bytesRead.error());
+}
+
+int sm_read_lines(serial_monitor_t handle, simon_line_t* lines, size_t max_lines, uint64_t deadline_ns) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (!lines && max_lines > 0) return LastError::fail(invalidParameter("lines is NULL"));
+
+    size_t clamped = max_lines < static_cast<size_t>(INT_MAX) ? max_lines : static_cast<size_t>(INT_MAX);
+    Result<size_t> count = handle->monitor.readLines(reinterpret_cast<LineFramer::View*>(lines), clamped,
+                                                     fromClockNs(deadline_ns));
+    return count ? static_cast<int>(count.value()) : LastError::fail(count.error());
+}
+
+simon_error_t sm_release_lines(serial_monitor_t handle) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+
+    handle->monitor.releaseLines();
+    return SIMON_SUCCESS;
+}
+
+simon_error_info_t simon_last_error(void) {
+    thread_local char message[256];
+    const Error& error = LastError::get();
+    simon_error_info_t info = { error.code, error.osError, "" };
+    if (error.code == SIMON_SUCCESS) return info;
+
+    // Formatted here rather than where the error happened, which stays
+    // free of string building
+    info.message = error.what ? error.what : "Unknown error";
+    if (error.osError == 0) return info;
     try {
-        SerialMonitorHandle* h = static_cast<SerialMonitorHandle*>(handle);
-        if (h->monitor.connect()) {
-            return SIMON_SUCCESS;
-        } else {
-            return SIMON_ERROR_CONNECTION_FAILED;
-        }
+#ifdef _WIN32
+        std::string osText = std::system_category().message(error.osError);
+#else
+        std::string osText = std::generic_category().message(error.osError);
+#endif
+        copyOut(std::string(info.message) + ": " + osText, message, sizeof(message));
+        info.message = message;
     } catch (...) {
-        return SIMON_ERROR_UNKNOWN;
+        // Falls back to the bare description
     }
+    return info;
 }
 
-simon_error_t sm_disconnect(serial_monitor_t handle) {
-    if (!handle) return SIMON_ERROR_NULL_HANDLE;
-    
+void simon_clear_error(void) {
+    LastError::clear();
+}
+
+// DevicePool implementation
+device_pool_t dp_create(int challenge_timeout_ms) {
+    if (challenge_timeout_ms <= 0) {
+        LastError::set(invalidParameter("challenge_timeout_ms must be positive"));
+        return nullptr;
+    }
+
     try {
-        SerialMonitorHandle* h = static_cast<SerialMonitorHandle*>(handle);
-        h->monitor.disconnect();
-        return SIMON_SUCCESS;
+        DevicePool::Options options;
+        options.challengeTimeoutMs = challenge_timeout_ms;
+        return new DevicePoolHandle(options, reactor.load());
     } catch (...) {
-        return SIMON_ERROR_UNKNOWN;
+        LastError::set({ SIMON_ERROR_UNKNOWN, 0, "Could not allocate a device pool" });
+        return nullptr;
     }
 }
 
-simon_error_t sm_send_command(serial_monitor_t handle, const char* command) {
-    if (!handle) return SIMON_ERROR_NULL_HANDLE;
-    if (!command) return SIMON_ERROR_INVALID_PARAMETER;
+void dp_destroy(device_pool_t handle) {
+    if (handle) {
+        delete static_cast<DevicePoolHandle*>(handle);
+    }
+}
+
+simon_error_t dp_add_device(device_pool_t handle, const char* port_name) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (!port_name) return LastError::fail(invalidParameter("port_name is NULL"));
     
     try {
-        SerialMonitorHandle* h = static_cast<SerialMonitorHandle*>(handle);
-        if (h->monitor.sendCommand(command)) {
+        DevicePoolHandle* h = static_cast<DevicePoolHandle*>(handle);
+        if (h->pool.addDevice(port_name)) {
             return SIMON_SUCCESS;
         } else {
-            return SIMON_ERROR_CONNECTION_FAILED;
+            return LastError::fail({ SIMON_ERROR_CONNECTION_FAILED, 0, "Device could not be opened" });
         }
     } catch (...) {
-        return SIMON_ERROR_UNKNOWN;
+        return LastError::fail(INTERNAL_ERROR);
     }
 }
 
-simon_error_t sm_send_simon_game_length(serial_monitor_t handle, int length) {
-    if (!handle) return SIMON_ERROR_NULL_HANDLE;
-    if (length <= 0) return SIMON_ERROR_INVALID_PARAMETER;
+simon_error_t dp_start(device_pool_t handle) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
     
     try {
-        SerialMonitorHandle* h = static_cast<SerialMonitorHandle*>(handle);
-        if (h->monitor.sendSimonGameLength(length)) {
+        DevicePoolHandle* h = static_cast<DevicePoolHandle*>(handle);
+        if (h->pool.start()) {
             return SIMON_SUCCESS;
         } else {
-            return SIMON_ERROR_CONNECTION_FAILED;
+            return LastError::fail({ SIMON_ERROR_UNKNOWN, 0, "Pool could not be started" });
         }
     } catch (...) {
-        return SIMON_ERROR_UNKNOWN;
+        return LastError::fail(INTERNAL_ERROR);
     }
 }
 
-int sm_verify_simon_game_success(serial_monitor_t handle, int timeout_ms) {
-    if (!handle) return 0;
+simon_error_t dp_stop(device_pool_t handle) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
     
     try {
-        SerialMonitorHandle* h = static_cast<SerialMonitorHandle*>(handle);
-        return h->monitor.verifySimonGameSuccess(timeout_ms) ? 1 : 0;
+        DevicePoolHandle* h = static_cast<DevicePoolHandle*>(handle);
+        h->pool.stop();
+        return SIMON_SUCCESS;
     } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+int dp_run_challenge(device_pool_t handle, int length) {
+    if (!handle || length <= 0) {
+        LastError::set(handle ? invalidParameter("length must be positive") : NULL_HANDLE);
+        return 0;
+    }
+    
+    try {
+        DevicePoolHandle* h = static_cast<DevicePoolHandle*>(handle);
+        return h->pool.runChallenge(length) ? 1 : 0;
+    } catch (...) {
+        LastError::set(INTERNAL_ERROR);
         return 0;
     }
 }
 
-int sm_is_connected(serial_monitor_t handle) {
-    if (!handle) return 0;
+simon_error_t dp_submit_challenge(device_pool_t handle, int length, simon_challenge_callback_t callback, void* user_data) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (length <= 0) return LastError::fail(invalidParameter("length must be positive"));
+    if (!callback) return LastError::fail(invalidParameter("callback is NULL"));
+
+    try {
+        DevicePoolHandle* h = static_cast<DevicePoolHandle*>(handle);
+        h->pool.submit(length, [callback, user_data](bool success) { callback(user_data, success ? 1 : 0); });
+        return SIMON_SUCCESS;
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+int dp_healthy_count(device_pool_t handle) {
+    if (!handle) {
+        LastError::set(NULL_HANDLE);
+        return 0;
+    }
     
     try {
-        SerialMonitorHandle* h = static_cast<SerialMonitorHandle*>(handle);
-        return h->monitor.isConnected() ? 1 : 0;
+        DevicePoolHandle* h = static_cast<DevicePoolHandle*>(handle);
+        return h->pool.healthyCount();
     } catch (...) {
+        LastError::set(INTERNAL_ERROR);
         return 0;
     }
 }
@@ -139,8 +372,11 @@ int sm_is_connected(serial_monitor_t handle) {
 // KeyboardMiddleware implementation
 keyboard_middleware_t km_create() {
     try {
-        return new KeyboardMiddlewareHandle();
+        KeyboardMiddlewareHandle* h = new KeyboardMiddlewareHandle();
+        h->middleware.SetEventLoop(reactor.load());
+        return h;
     } catch (...) {
+        LastError::set({ SIMON_ERROR_UNKNOWN, 0, "Could not allocate a keyboard middleware" });
         return nullptr;
     }
 }
@@ -152,33 +388,124 @@ void km_destroy(keyboard_middleware_t handle) {
 }
 
 simon_error_t km_initialize(keyboard_middleware_t handle) {
-    if (!handle) return SIMON_ERROR_NULL_HANDLE;
+    if (!handle) return LastError::fail(NULL_HANDLE);
     
     try {
         KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
-        if (KeyboardMiddleware::Initialize()) {
-            h->initialized = true;
+        if (h->middleware.Initialize()) {
             return SIMON_SUCCESS;
         } else {
-            return SIMON_ERROR_HOOK_FAILED;
+            return LastError::fail({ SIMON_ERROR_HOOK_FAILED, 0, "Keyboard hook could not be installed" });
         }
     } catch (...) {
-        return SIMON_ERROR_UNKNOWN;
+        return LastError::fail(INTERNAL_ERROR);
     }
 }
 
 simon_error_t km_register_key(keyboard_middleware_t handle, int key_code, int target_count) {
-    if (!handle) return SIMON_ERROR_NULL_HANDLE;
+    if (!handle) return LastError::fail(NULL_HANDLE);
     KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
     
-    if (!h->initialized) return SIMON_ERROR_HOOK_FAILED;
-    if (target_count <= 0) return SIMON_ERROR_INVALID_PARAMETER;
+    if (!h->middleware.IsInitialized()) return LastError::fail(NOT_INITIALIZED);
+    if (key_code <= 0 || key_code > 0xFF) return LastError::fail(invalidParameter("key_code out of range"));
+    if (target_count <= 0) return LastError::fail(invalidParameter("target_count must be positive"));
     
     try {
-        KeyboardMiddleware::RegisterKey(static_cast<WORD>(key_code), target_count);
-        return SIMON_SUCCESS;
+        if (h->middleware.RegisterKey(static_cast<uint16_t>(key_code), target_count)) {
+            return SIMON_SUCCESS;
+        } else {
+            return LastError::fail(invalidParameter("Key could not be registered"));
+        }
     } catch (...) {
-        return SIMON_ERROR_UNKNOWN;
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+simon_error_t km_register_chord(keyboard_middleware_t handle, int key_code, int modifiers, int target_count) {
+    simon_key_step step = { key_code, modifiers };
+    return km_register_sequence(handle, &step, 1, 0, target_count);
+}
+
+simon_error_t km_register_sequence(
+    keyboard_middleware_t handle,
+    const simon_key_step* steps,
+    int step_count,
+    int window_ms,
+    int target_count
+) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    
+    if (!h->middleware.IsInitialized()) return LastError::fail(NOT_INITIALIZED);
+    
+    try {
+        TriggerMatcher::Trigger trigger;
+        Result<void> result = toTrigger(steps, step_count, window_ms, target_count, trigger);
+        if (!result) return LastError::fail(result.error());
+        
+        if (h->middleware.RegisterTrigger(trigger.steps, trigger.windowMs, trigger.targetCounter)) {
+            return SIMON_SUCCESS;
+        } else {
+            return LastError::fail(invalidParameter("Sequence could not be registered"));
+        }
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+simon_error_t km_register_keys(keyboard_middleware_t handle, const simon_key_config* keys, size_t count) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    
+    if (!h->middleware.IsInitialized()) return LastError::fail(NOT_INITIALIZED);
+    
+    try {
+        std::vector<TriggerMatcher::Trigger> triggers;
+        Result<void> result = toTriggers(keys, count, triggers);
+        if (!result) return LastError::fail(result.error());
+        
+        if (h->middleware.RegisterTriggers(triggers)) {
+            return SIMON_SUCCESS;
+        } else {
+            return LastError::fail(invalidParameter("Keys could not be registered"));
+        }
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+simon_error_t km_apply_config(keyboard_middleware_t handle, const simon_config* config) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (!config) return LastError::fail(invalidParameter("config is NULL"));
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    
+    if (!h->middleware.IsInitialized()) return LastError::fail(NOT_INITIALIZED);
+    if (!config->sequences && config->sequence_count > 0) return LastError::fail(invalidParameter("sequences is NULL"));
+    
+    try {
+        KeyboardMiddleware::Config applied;
+        Result<void> result = toTriggers(config->keys, config->key_count, applied.triggers);
+        for (size_t i = 0; result && i < config->sequence_count; i++) {
+            const simon_sequence_config& sequence = config->sequences[i];
+            TriggerMatcher::Trigger trigger;
+            result = toTrigger(sequence.steps, sequence.step_count, sequence.window_ms, sequence.target_count, trigger);
+            applied.triggers.push_back(std::move(trigger));
+        }
+        if (result) {
+            result = toNames(config->processes, config->process_count, applied.processes);
+        }
+        if (result) {
+            result = toNames(config->window_classes, config->window_class_count, applied.windowClasses);
+        }
+        if (!result) return LastError::fail(result.error());
+        
+        if (h->middleware.ApplyConfig(applied)) {
+            return SIMON_SUCCESS;
+        } else {
+            return LastError::fail(invalidParameter("Config could not be applied"));
+        }
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
     }
 }
 
@@ -187,36 +514,507 @@ simon_error_t km_register_callbacks(
     simon_send_callback_t send_callback,
     simon_receive_callback_t receive_callback
 ) {
-    if (!handle) return SIMON_ERROR_NULL_HANDLE;
+    if (!handle) return LastError::fail(NULL_HANDLE);
     KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
     
-    if (!h->initialized) return SIMON_ERROR_HOOK_FAILED;
+    if (!h->middleware.IsInitialized()) return LastError::fail(NOT_INITIALIZED);
     
     try {
-        g_send_callback = send_callback;
-        g_receive_callback = receive_callback;
-        
-        KeyboardMiddleware::RegisterHardwareCallbacks(
-            cpp_send_callback_wrapper,
-            cpp_receive_callback_wrapper
+        h->middleware.RegisterHardwareCallbacks(
+            [send_callback](int counter) {
+                if (send_callback) {
+                    send_callback(counter);
+                }
+            },
+            [receive_callback]() {
+                return receive_callback ? receive_callback() != 0 : false;
+            }
         );
         return SIMON_SUCCESS;
     } catch (...) {
-        return SIMON_ERROR_UNKNOWN;
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+simon_error_t km_register_callbacks_ex(
+    keyboard_middleware_t handle,
+    simon_send_callback_ex_t send_callback,
+    simon_receive_callback_ex_t receive_callback,
+    void* user_data
+) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    
+    if (!h->middleware.IsInitialized()) return LastError::fail(NOT_INITIALIZED);
+    
+    try {
+        h->middleware.RegisterHardwareCallbacks(
+            [send_callback, user_data](int counter) {
+                if (send_callback) {
+                    send_callback(user_data, counter);
+                }
+            },
+            [receive_callback, user_data]() {
+                return receive_callback ? receive_callback(user_data) != 0 : false;
+            }
+        );
+        return SIMON_SUCCESS;
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+simon_error_t km_add_process_scope(keyboard_middleware_t handle, const char* exe_name) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (!exe_name || !*exe_name) return LastError::fail(invalidParameter("exe_name is NULL or empty"));
+    
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    
+    try {
+        h->middleware.AddProcessScope(exe_name);
+        return SIMON_SUCCESS;
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+simon_error_t km_add_window_class_scope(keyboard_middleware_t handle, const char* window_class) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (!window_class || !*window_class) return LastError::fail(invalidParameter("window_class is NULL or empty"));
+    
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    
+    try {
+        h->middleware.AddWindowClassScope(window_class);
+        return SIMON_SUCCESS;
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
     }
 }
 
+simon_error_t km_clear_scopes(keyboard_middleware_t handle) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    
+    try {
+        h->middleware.ClearScopes();
+        return SIMON_SUCCESS;
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+simon_error_t km_set_key_buffering(keyboard_middleware_t handle, int enabled, int capacity) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (capacity <= 0) return LastError::fail(invalidParameter("capacity must be positive"));
+    
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    
+    try {
+        if (h->middleware.SetKeyBuffering(enabled != 0, static_cast<size_t>(capacity))) {
+            return SIMON_SUCCESS;
+        } else {
+            return LastError::fail({ SIMON_ERROR_HOOK_FAILED, 0, "Buffered keys cannot be replayed here" });
+        }
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+simon_error_t km_set_verification_cache(keyboard_middleware_t handle, int ttl_ms, int per_key, int idle_ms) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (ttl_ms < 0 || idle_ms < 0) return LastError::fail(invalidParameter("ttl_ms and idle_ms must not be negative"));
+    
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    
+    try {
+        h->middleware.SetVerificationCache(static_cast<uint32_t>(ttl_ms), per_key != 0, static_cast<uint32_t>(idle_ms));
+        return SIMON_SUCCESS;
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+simon_error_t km_invalidate_verification(keyboard_middleware_t handle) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    
+    try {
+        h->middleware.InvalidateVerification();
+        return SIMON_SUCCESS;
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+simon_error_t km_set_adaptive_length(keyboard_middleware_t handle, int min_length, int max_length, int window) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (window < 0) return LastError::fail(invalidParameter("window is negative"));
+    
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    
+    try {
+        if (h->middleware.SetAdaptiveLength(min_length, max_length, static_cast<size_t>(window))) {
+            return SIMON_SUCCESS;
+        } else {
+            return LastError::fail(invalidParameter("Invalid length range"));
+        }
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+simon_error_t km_set_speculation(keyboard_middleware_t handle, int ttl_ms) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (ttl_ms < 0) return LastError::fail(invalidParameter("ttl_ms is negative"));
+    
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    
+    try {
+        h->middleware.SetSpeculation(static_cast<uint32_t>(ttl_ms));
+        return SIMON_SUCCESS;
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+simon_error_t km_set_lockout(keyboard_middleware_t handle, const simon_lockout_policy* policy, const char* state_path) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    
+    try {
+        if (!policy) {
+            h->middleware.DisableLockout();
+            return SIMON_SUCCESS;
+        }
+        if (policy->key_threshold < 0 || policy->device_threshold < 0 || policy->window_ms < 0 ||
+            policy->decay_ms < 0 || (!policy->steps_ms && policy->step_count > 0)) {
+            return LastError::fail(invalidParameter("Invalid lockout policy"));
+        }
+
+        Lockout::Policy settings;
+        settings.keyThreshold = static_cast<uint32_t>(policy->key_threshold);
+        settings.deviceThreshold = static_cast<uint32_t>(policy->device_threshold);
+        settings.windowMs = static_cast<uint32_t>(policy->window_ms);
+        settings.decayMs = static_cast<uint32_t>(policy->decay_ms);
+        if (policy->steps_ms) {
+            settings.stepsMs.clear();
+            for (size_t i = 0; i < policy->step_count; i++) {
+                if (policy->steps_ms[i] <= 0) return LastError::fail(invalidParameter("Lockout steps must be positive"));
+                settings.stepsMs.push_back(static_cast<uint32_t>(policy->steps_ms[i]));
+            }
+        }
+
+        if (h->middleware.SetLockout(settings, state_path ? state_path : "")) {
+            return SIMON_SUCCESS;
+        } else {
+            return LastError::fail(invalidParameter("Invalid lockout policy"));
+        }
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+simon_error_t km_use_device_pool(keyboard_middleware_t handle, device_pool_t pool) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+    if (!pool) return LastError::fail(invalidParameter("pool is NULL"));
+    
+    KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
+    DevicePool* devicePool = &static_cast<DevicePoolHandle*>(pool)->pool;
+    
+    try {
+        if (reactor.load() != nullptr) {
+            // Pool and middleware share the caller's loop, so the result
+            // arrives as a completion instead of being waited for
+            h->middleware.RegisterAsyncHardware([devicePool](int length, std::function<void(bool)> done) {
+                devicePool->submit(length, std::move(done));
+            });
+            return SIMON_SUCCESS;
+        }
+
+        // The middleware runs one challenge at a time and always calls send
+        // then receive on the same thread, so one pending result suffices
+        auto pending = std::make_shared<std::future<bool>>();
+        h->middleware.RegisterHardwareCallbacks(
+            [devicePool, pending](int counter) { *pending = devicePool->submit(counter); },
+            [pending]() { return pending->valid() && pending->get(); }
+        );
+        return SIMON_SUCCESS;
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+screen_lock_t lock_begin(int seconds, keyboard_middleware_t release_on_success) {
+    if (seconds <= 0 || seconds > 3600) {
+        LastError::set(invalidParameter("seconds must be between 1 and 3600"));
+        return nullptr;
+    }
+
+    try {
+        std::unique_ptr<ScreenLockHandle> handle(new ScreenLockHandle());
+        handle->lock = std::make_shared<ScreenLock>(ScreenLock::platformBackend(), reactor.load());
+        // Attached first, so a challenge passing right away still ends it
+        if (release_on_success) {
+            release_on_success->middleware.AttachScreenLock(handle->lock);
+        }
+        if (!handle->lock->begin(std::chrono::seconds(seconds))) {
+            if (release_on_success) {
+                release_on_success->middleware.AttachScreenLock(nullptr);
+            }
+            LastError::set({ SIMON_ERROR_HOOK_FAILED, 0, "Input could not be locked" });
+            return nullptr;
+        }
+        return handle.release();
+    } catch (...) {
+        LastError::set({ SIMON_ERROR_UNKNOWN, 0, "Screen lock could not be created" });
+        return nullptr;
+    }
+}
+
+simon_error_t lock_end(screen_lock_t handle) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+
+    handle->lock->end();
+    return SIMON_SUCCESS;
+}
+
+int lock_wait_until(screen_lock_t handle, uint64_t deadline_ns) {
+    if (!handle) return LastError::fail(NULL_HANDLE);
+
+    return handle->lock->waitUntil(fromClockNs(deadline_ns)) ? 1 : 0;
+}
+
+void lock_destroy(screen_lock_t handle) {
+    if (!handle) return;
+
+    // A middleware may still hold the lock, so release input explicitly
+    handle->lock->end();
+    delete handle;
+}
+
 simon_error_t km_cleanup(keyboard_middleware_t handle) {
-    if (!handle) return SIMON_ERROR_NULL_HANDLE;
+    if (!handle) return LastError::fail(NULL_HANDLE);
     KeyboardMiddlewareHandle* h = static_cast<KeyboardMiddlewareHandle*>(handle);
     
     try {
-        if (h->initialized) {
-            KeyboardMiddleware::Cleanup();
-            h->initialized = false;
+        h->middleware.Cleanup();
+        h->middleware.RegisterHardwareCallbacks(nullptr, nullptr);
+        return SIMON_SUCCESS;
+    } catch (...) {
+        return LastError::fail(INTERNAL_ERROR);
+    }
+}
+
+// Metrics implementation
+size_t simon_metrics_dump(char* buffer, size_t size) {
+    try {
+        return copyOut(Metrics::dump(), buffer, size);
+    } catch (...) {
+        if (buffer && size > 0) {
+            buffer[0] = '\0';
+        }
+        return 0;
+    }
+}
+
+simon_error_t simon_metrics_serve(const char* address) {
+    if (!address) return SIMON_ERROR_INVALID_PARAMETER;
+
+    try {
+        std::lock_guard<std::mutex> lock(metricsServerMutex);
+        if (metricsServer && metricsServer->isRunning()) {
+            return SIMON_ERROR_INVALID_PARAMETER;
+        }
+        metricsServer.reset(new MetricsServer(reactor.load()));
+        return metricsServer->start(address) ? SIMON_SUCCESS : SIMON_ERROR_CONNECTION_FAILED;
+    } catch (...) {
+        return SIMON_ERROR_UNKNOWN;
+    }
+}
+
+simon_error_t simon_metrics_stop_serving(void) {
+    try {
+        std::lock_guard<std::mutex> lock(metricsServerMutex);
+        metricsServer.reset();
+        return SIMON_SUCCESS;
+    } catch (...) {
+        return SIMON_ERROR_UNKNOWN;
+    }
+}
+
+// Trace implementation
+simon_error_t simon_trace_enable(int enabled) {
+    Trace::setEnabled(enabled != 0);
+    return SIMON_SUCCESS;
+}
+
+simon_error_t simon_trace_clear(void) {
+    try {
+        Trace::clear();
+        return SIMON_SUCCESS;
+    } catch (...) {
+        return SIMON_ERROR_UNKNOWN;
+    }
+}
+
+size_t simon_trace_dump(char* buffer, size_t size) {
+    try {
+        return copyOut(Trace::exportChromeJson(), buffer, size);
+    } catch (...) {
+        if (buffer && size > 0) {
+            buffer[0] = '\0';
+        }
+        return 0;
+    }
+}
+
+simon_error_t simon_trace_save(const char* path) {
+    if (!path) return SIMON_ERROR_INVALID_PARAMETER;
+
+    try {
+        return Trace::writeChromeJson(path) ? SIMON_SUCCESS : SIMON_ERROR_INVALID_PARAMETER;
+    } catch (...) {
+        return SIMON_ERROR_UNKNOWN;
+    }
+}
+
+simon_subscription_t simon_events_subscribe(void) {
+    try {
+        if (!EventChannel::open()) {
+            return nullptr;
+        }
+        return new EventSubscriptionHandle();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void simon_events_unsubscribe(simon_subscription_t handle) {
+    delete handle;
+}
+
+int simon_events_next(simon_subscription_t handle, simon_event_t* event) {
+    if (!handle || !event) return 0;
+
+    EventChannel::Event next;
+    if (!handle->subscription.next(next)) {
+        return 0;
+    }
+    std::memcpy(event, &next, sizeof(next));
+    return 1;
+}
+
+int simon_events_wait(simon_subscription_t handle, int timeout_ms) {
+    if (!handle) return 0;
+    return handle->subscription.wait(timeout_ms) ? 1 : 0;
+}
+
+uint64_t simon_events_dropped(simon_subscription_t handle) {
+    return handle ? handle->subscription.dropped() : 0;
+}
+
+simon_error_t simon_events_status(simon_status_t* status) {
+    if (!status) return SIMON_ERROR_INVALID_PARAMETER;
+
+    status->challenges_succeeded = EventChannel::status(EventChannel::CHALLENGES_SUCCEEDED);
+    status->challenges_failed = EventChannel::status(EventChannel::CHALLENGES_FAILED);
+    status->challenges_in_flight = EventChannel::status(EventChannel::CHALLENGES_IN_FLIGHT);
+    status->devices_connected = EventChannel::status(EventChannel::DEVICES_CONNECTED);
+    status->last_challenge_length = EventChannel::status(EventChannel::LAST_CHALLENGE_LENGTH);
+    return SIMON_SUCCESS;
+}
+
+const void* simon_events_region(size_t* size) {
+    size_t mapped = 0;
+    const void* region = EventChannel::region(mapped);
+    if (size) {
+        *size = mapped;
+    }
+    return region;
+}
+
+int simon_events_fd(void) {
+    return EventChannel::fd();
+}
+
+// Reactor implementation
+simon_error_t simon_reactor_enable(void) {
+    try {
+        static std::mutex enableMutex;
+        std::lock_guard<std::mutex> lock(enableMutex);
+        if (reactor.load() == nullptr) {
+            reactor.store(new EventLoop());
+            LOG_INFO("Reactor mode enabled, work runs inside simon_process_events");
+        }
+        return SIMON_SUCCESS;
+    } catch (...) {
+        return SIMON_ERROR_UNKNOWN;
+    }
+}
+
+int simon_get_poll_fds(simon_pollfd_t* fds, int max) {
+    EventLoop* loop = reactor.load();
+    if (!loop) return 0;
+
+    try {
+        std::vector<SerialMonitor::NativeHandle> handles;
+        loop->pollHandles(handles);
+#ifndef _WIN32
+        for (size_t i = 0; fds && i < handles.size() && i < static_cast<size_t>(max); i++) {
+            fds[i].fd = handles[i];
+            fds[i].events = POLLIN;
         }
-        g_send_callback = nullptr;
-        g_receive_callback = nullptr;
+#else
+        (void)fds;
+        (void)max;
+#endif
+        return static_cast<int>(handles.size());
+    } catch (...) {
+        return 0;
+    }
+}
+
+void* simon_get_wake_handle(void) {
+#ifdef _WIN32
+    EventLoop* loop = reactor.load();
+    return loop ? loop->wakeHandle() : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+int simon_next_timeout_ms(void) {
+    EventLoop* loop = reactor.load();
+    if (!loop) return -1;
+
+    EventLoop::Clock::time_point next = loop->nextDeadline();
+    if (next == EventLoop::Clock::time_point::max()) {
+        return -1;
+    }
+    EventLoop::Clock::time_point now = EventLoop::Clock::now();
+    if (next <= now) {
+        return 0;
+    }
+    // Rounded up so the caller never wakes before the timer is due
+    long long us = std::chrono::duration_cast<std::chrono::microseconds>(next - now).count();
+    return static_cast<int>(std::min<long long>((us + 999) / 1000, INT_MAX));
+}
+
+uint64_t simon_clock_ns(void) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        EventLoop::Clock::now().time_since_epoch()).count());
+}
+
+simon_error_t simon_process_events(uint64_t deadline_ns) {
+    EventLoop* loop = reactor.load();
+    if (!loop) return SIMON_ERROR_INVALID_PARAMETER;
+
+    try {
+        loop->runOnce(fromClockNs(deadline_ns));
         return SIMON_SUCCESS;
     } catch (...) {
         return SIMON_ERROR_UNKNOWN;
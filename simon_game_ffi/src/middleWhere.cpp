@@ -1,75 +1,735 @@
 #include "middleWhere.hpp"
+#include "EventChannel.hpp"
+#include "EventLoop.hpp"
+#include "Metrics.hpp"
+#include "ScreenLock.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
-std::atomic<bool> KeyboardMiddleware::blockKeys(false);
-HHOOK KeyboardMiddleware::keyboardHook = NULL;
-std::vector<KeyboardMiddleware::KeyConfig> KeyboardMiddleware::keyConfigs;
-bool KeyboardMiddleware::shouldExit = false;
-std::atomic<int> KeyboardMiddleware::targetCounter(0);
-std::mutex KeyboardMiddleware::counterMutex;
-std::function<void(int)> KeyboardMiddleware::sendToHardwareCallback;
-std::function<bool()> KeyboardMiddleware::receiveFromHardwareCallback;
+namespace {
+#ifdef _WIN32
+    // Instance whose hooks were installed on the current thread
+    thread_local KeyboardMiddleware* hookOwner = nullptr;
+#endif
+
+    uint32_t CurrentTickCount() {
+#ifdef _WIN32
+        return GetTickCount();
+#else
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    int64_t SteadyMillis() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct MiddlewareMetrics {
+        Metrics::Counter& succeeded = Metrics::counter("simon_challenges_total{result=\"success\"}",
+                                                       "Challenges completed, by result");
+        Metrics::Counter& failed = Metrics::counter("simon_challenges_total{result=\"failure\"}",
+                                                    "Challenges completed, by result");
+        Metrics::Histogram& duration = Metrics::histogram("simon_challenge_duration_seconds",
+                                                          "Time from trigger key to verification result");
+        Metrics::Gauge& inFlight = Metrics::gauge("simon_challenges_in_flight", "Challenges awaiting a result");
+        Metrics::Gauge& length = Metrics::gauge("simon_challenge_length", "Length of the latest challenge");
+        Metrics::Counter& keysHeld = Metrics::counter("simon_keys_held_total",
+                                                      "Key events held back from the application");
+        Metrics::Counter& keysReplayed = Metrics::counter("simon_keys_replayed_total",
+                                                          "Buffered key events replayed after a success");
+        Metrics::Counter& keysDiscarded = Metrics::counter("simon_keys_discarded_total",
+                                                           "Buffered key events dropped after a failure");
+        Metrics::Counter& cacheHits = Metrics::counter("simon_verification_cache_total{result=\"hit\"}",
+                                                       "Triggers checked against the verification cache");
+        Metrics::Counter& cacheMisses = Metrics::counter("simon_verification_cache_total{result=\"miss\"}",
+                                                         "Triggers checked against the verification cache");
+        Metrics::Counter& cacheInvalidations = Metrics::counter("simon_verification_cache_invalidations_total",
+                                                                "Cached verifications dropped on request or idle");
+        Metrics::Counter& lockouts = Metrics::counter("simon_lockouts_total",
+                                                      "Input lockouts after repeated challenge failures");
+        Metrics::Counter& armedByKeys = Metrics::counter("simon_speculative_challenges_total{reason=\"keys\"}",
+                                                         "Challenge rounds started ahead of a trigger, by prediction");
+        Metrics::Counter& armedByFocus = Metrics::counter("simon_speculative_challenges_total{reason=\"focus\"}",
+                                                          "Challenge rounds started ahead of a trigger, by prediction");
+        Metrics::Counter& speculationHits = Metrics::counter("simon_speculative_results_total{result=\"hit\"}",
+                                                             "Speculative rounds, by whether a trigger claimed them");
+        Metrics::Counter& speculationCancelled = Metrics::counter(
+            "simon_speculative_results_total{result=\"cancelled\"}",
+            "Speculative rounds, by whether a trigger claimed them");
+        Metrics::Counter& speculationExpired = Metrics::counter("simon_speculative_results_total{result=\"expired\"}",
+                                                                "Speculative rounds, by whether a trigger claimed them");
+    };
+
+    MiddlewareMetrics& metrics() {
+        static MiddlewareMetrics instance;
+        return instance;
+    }
+}
+
+#ifdef _WIN32
+KeyboardMiddleware::KeyboardMiddleware()
+    : blockKeys(false), initialized(false), keyboardHook(NULL), hookThreadId(0), triggerMatcher(nullptr), matcherEpoch(0),
+      matcherReaders{}, callbacks(nullptr), targetCounter(0),
+      activeChallenges(0), eventLoop(nullptr), bufferingEnabled(false), capturingKeys(false), cacheTtlMs(0), cacheIdleMs(0),
+      cachePerKey(true), lastActivityMs(0), speculationTtlMs(0), predictedTrigger(-1), foregroundHook(NULL) {
+    ClearVerifications();
+}
+#else
+KeyboardMiddleware::KeyboardMiddleware()
+    : blockKeys(false), initialized(false), triggerMatcher(nullptr), matcherEpoch(0), matcherReaders{},
+      callbacks(nullptr), targetCounter(0),
+      activeChallenges(0), eventLoop(nullptr), bufferingEnabled(false), capturingKeys(false), cacheTtlMs(0), cacheIdleMs(0),
+      cachePerKey(true), lastActivityMs(0), speculationTtlMs(0), predictedTrigger(-1) {
+    ClearVerifications();
+}
+#endif
+
+KeyboardMiddleware::~KeyboardMiddleware() {
+    Cleanup();
+    delete callbacks.load();
+    delete triggerMatcher.load();
+}
+
+KeyboardMiddleware::MatcherPin::MatcherPin(KeyboardMiddleware& owner)
+    : readers(owner.matcherReaders[owner.matcherEpoch.load() & 1]) {
+    // Counted before the load, so a writer that swapped the matcher out
+    // either sees this reader or was done before it looked
+    readers.fetch_add(1);
+    matcher = owner.triggerMatcher.load();
+}
+
+KeyboardMiddleware::MatcherPin::~MatcherPin() {
+    readers.fetch_sub(1);
+}
 
 void KeyboardMiddleware::LogMessage(const std::string& message) {
     LOG_DEBUG("Middleware: " + message);
 }
 
-void KeyboardMiddleware::SendResponseToApplication(WORD key) {
-    std::lock_guard<std::mutex> lock(counterMutex);
-    auto keyConfig = std::find_if(keyConfigs.begin(), keyConfigs.end(),
-        [key](const KeyConfig& config) { return config.key == key; });
+void KeyboardMiddleware::SendResponseToApplication(uint16_t key, int targetCount) {
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    LOG_INFO("Processing key response for key: " + std::to_string(key) + 
+             " with target counter: " + std::to_string(targetCount));
+    
+    int length = 0;
+    {
+        std::lock_guard<std::mutex> lock(counterMutex);
+        length = adaptiveLength.nextLength(targetCount);
+    }
+    metrics().length.set(length);
+    EventChannel::setStatus(EventChannel::LAST_CHALLENGE_LENGTH, length);
+    EventChannel::publish(EventChannel::CHALLENGE_STARTED, key, length);
 
-    if (keyConfig != keyConfigs.end()) {
-        LOG_INFO("Processing key response for key: " + std::to_string(key) + 
-                 " with target counter: " + std::to_string(keyConfig->targetCounter));
-        
-        if (sendToHardwareCallback) {
-            sendToHardwareCallback(keyConfig->targetCounter);
+    RunDeviceRound(length, [this, key, length, started](bool success) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        metrics().duration.observe(seconds);
+        {
+            std::lock_guard<std::mutex> lock(counterMutex);
+            adaptiveLength.record(success, seconds, length);
+        }
+        FinishChallenge(key, success, seconds);
+        EndChallenge();
+    });
+}
+
+void KeyboardMiddleware::RunDeviceRound(int length, std::function<void(bool)> done) {
+    const HardwareCallbacks* hardware = callbacks.load(std::memory_order_acquire);
+
+    if (hardware && hardware->start) {
+        // `done` may run before start() returns and end the last challenge;
+        // holding one more keeps `hardware` from being freed under us if it
+        // was replaced meanwhile
+        Trace::Span span("challenge", "start callback", length);
+        HoldChallenge();
+        hardware->start(length, std::move(done));
+        ReleaseChallenge();
+        return;
+    }
+    
+    bool success = false;
+    {
+        // The callbacks talk to one device, so rounds take turns
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        if (hardware && hardware->send) {
+            Trace::Span span("challenge", "send callback", length);
+            hardware->send(length);
         }
         
-        if (receiveFromHardwareCallback && receiveFromHardwareCallback()) {
-            LOG_INFO("Hardware verification successful for key: " + std::to_string(key));
+        if (hardware && hardware->receive) {
+            Trace::Span span("challenge", "receive callback");
+            success = hardware->receive();
+        }
+    }
+    done(success);
+}
+
+void KeyboardMiddleware::FinishChallenge(uint16_t key, bool success, double seconds) {
+    (success ? metrics().succeeded : metrics().failed).inc();
+    EventChannel::addStatus(success ? EventChannel::CHALLENGES_SUCCEEDED : EventChannel::CHALLENGES_FAILED, 1);
+    EventChannel::publish(EventChannel::CHALLENGE_FINISHED, key, success ? 1 : 0, static_cast<int32_t>(seconds * 1000));
+
+    if (success) {
+        LOG_INFO("Hardware verification successful for key: " + std::to_string(key));
+        RecordVerification(key);
+        std::shared_ptr<ScreenLock> lock;
+        {
+            std::lock_guard<std::mutex> guard(screenLockMutex);
+            lock = screenLock;
+        }
+        if (lock) {
+            lock->end();
+        }
+        // Unblocked first, so a trigger typed as the replay finishes starts
+        // a new challenge instead of meeting a block about to be lifted.
+        // Keys arriving during the replay are still captured, so this
+        // cannot reorder them; triggers among them are dropped rather than
+        // replayed (see BufferKeyEvent).
+        blockKeys = false;
+        ReplayBufferedKeys();
+    } else {
+        LOG_WARNING("Hardware verification failed for key: " + std::to_string(key));
+        verifiedUntil[cachePerKey ? (key & 0xFF) : 0] = 0;
+        DiscardBufferedKeys();
+        // Without lockouts a failure leaves the triggers blocked; with them
+        // the lockout is the penalty and the trigger can be tried again
+        if (ApplyLockout(key)) {
             blockKeys = false;
+        }
+    }
+}
+
+bool KeyboardMiddleware::Rearm() {
+    std::lock_guard<std::mutex> lock(challengeMutex);
+    if (activeChallenges > 0) {
+        return false;
+    }
+    blockKeys = false;
+    return true;
+}
+
+bool KeyboardMiddleware::ApplyLockout(uint16_t key) {
+    std::lock_guard<std::mutex> lock(lockoutMutex);
+    if (!lockout.isEnabled()) {
+        return false;
+    }
+
+    uint32_t lockMs = lockout.recordFailure(key, Lockout::nowMs());
+    if (!lockoutStatePath.empty() && !lockout.save(lockoutStatePath)) {
+        LOG_WARNING("Failed to save lockout state to " + lockoutStatePath);
+    }
+    if (lockMs == 0) {
+        return true;
+    }
+
+    metrics().lockouts.inc();
+    LOG_WARNING("Repeated verification failures, locking input for " + std::to_string(lockMs) + " ms");
+    if (!lockoutLock->begin(std::chrono::milliseconds(lockMs))) {
+        LOG_ERROR("Lockout could not lock input");
+    }
+    return true;
+}
+
+void KeyboardMiddleware::StartChallenge(uint16_t key, int targetCount, ChallengeMode mode) {
+    HoldChallenge();
+    metrics().inFlight.add(1);
+    EventChannel::setStatus(EventChannel::CHALLENGES_IN_FLIGHT, metrics().inFlight.value());
+
+    uint64_t queuedAt = Trace::isEnabled() ? Trace::now() : 0;
+    auto run = [this, key, targetCount, mode, queuedAt]() {
+        if (queuedAt != 0) {
+            Trace::record("challenge", "queue wait", queuedAt, Trace::now());
+        }
+        RunChallenge(key, targetCount, mode);
+    };
+
+    if (eventLoop != nullptr) {
+        eventLoop->post(run);
+        return;
+    }
+    std::thread([run]() {
+        Trace::setThreadName("challenge");
+        run();
+    }).detach();
+}
+
+void KeyboardMiddleware::RunChallenge(uint16_t key, int targetCount, ChallengeMode mode) {
+    // Each path ends in EndChallenge(), possibly later from a completion
+    if (mode == ChallengeMode::SPECULATE) {
+        RunSpeculation(targetCount);
+    } else if (mode == ChallengeMode::CLAIM) {
+        ResolveClaim();
+    } else {
+        SendResponseToApplication(key, targetCount);
+    }
+}
+
+void KeyboardMiddleware::EndChallenge() {
+    metrics().inFlight.add(-1);
+    EventChannel::setStatus(EventChannel::CHALLENGES_IN_FLIGHT, metrics().inFlight.value());
+    ReleaseChallenge();
+}
+
+void KeyboardMiddleware::HoldChallenge() {
+    std::lock_guard<std::mutex> lock(challengeMutex);
+    activeChallenges++;
+}
+
+void KeyboardMiddleware::ReleaseChallenge() {
+    // Freed outside the lock, in case a callback's captures call back in
+    std::vector<std::unique_ptr<const HardwareCallbacks>> retired;
+    std::lock_guard<std::mutex> lock(challengeMutex);
+    if (--activeChallenges == 0) {
+        retired.swap(retiredCallbacks);
+    }
+    challengeDone.notify_all();
+}
+
+void KeyboardMiddleware::Speculate(int targetCount, bool fromFocus) {
+    if (speculationTtlMs == 0 || blockKeys) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(speculationMutex);
+        if (speculation.state == Speculation::READY && !speculation.claimed &&
+            SteadyMillis() - speculation.readyAtMs > speculationTtlMs) {
+            speculation.state = Speculation::IDLE;
+            metrics().speculationExpired.inc();
+        }
+        if (speculation.state != Speculation::IDLE) {
+            return;
+        }
+        speculation = Speculation();
+        speculation.state = Speculation::RUNNING;
+        speculation.fromFocus = fromFocus;
+        speculation.baseLength = targetCount;
+    }
+
+    LOG_DEBUG(std::string("Pre-arming challenge on ") + (fromFocus ? "focus change" : "key prediction") +
+              " for target count: " + std::to_string(targetCount));
+    (fromFocus ? metrics().armedByFocus : metrics().armedByKeys).inc();
+    StartChallenge(0, targetCount, ChallengeMode::SPECULATE);
+}
+
+void KeyboardMiddleware::RunSpeculation(int targetCount) {
+    int length = 0;
+    {
+        std::lock_guard<std::mutex> lock(counterMutex);
+        length = adaptiveLength.nextLength(targetCount);
+    }
+    metrics().length.set(length);
+    EventChannel::setStatus(EventChannel::LAST_CHALLENGE_LENGTH, length);
+    EventChannel::publish(EventChannel::CHALLENGE_STARTED, 0, length, 1);
+
+    RunDeviceRound(length, [this, length](bool success) {
+        CompleteSpeculation(length, success);
+        EndChallenge();
+    });
+}
+
+void KeyboardMiddleware::CompleteSpeculation(int length, bool success) {
+    Speculation result;
+    {
+        std::lock_guard<std::mutex> lock(speculationMutex);
+        if (speculation.cancelled) {
+            LOG_DEBUG("Dropping result of cancelled speculative challenge");
+            speculation.state = Speculation::IDLE;
+            return;
+        }
+        speculation.state = Speculation::READY;
+        speculation.length = length;
+        speculation.success = success;
+        speculation.readyAtMs = SteadyMillis();
+        if (!speculation.claimWaiting) {
+            return;
+        }
+        result = speculation;
+        speculation = Speculation();
+    }
+
+    // The trigger's own challenge has been waiting on this round
+    FinishClaim(result);
+    EndChallenge();
+}
+
+bool KeyboardMiddleware::ClaimSpeculation(uint16_t key, int targetCount) {
+    std::lock_guard<std::mutex> lock(speculationMutex);
+    if (speculation.state == Speculation::IDLE || speculation.claimed || speculation.cancelled) {
+        return false;
+    }
+    if (speculation.state == Speculation::READY && SteadyMillis() - speculation.readyAtMs > speculationTtlMs) {
+        speculation.state = Speculation::IDLE;
+        metrics().speculationExpired.inc();
+        return false;
+    }
+    // A shorter round than the trigger asks for must not stand in for it
+    if (speculation.baseLength < targetCount) {
+        if (speculation.state == Speculation::READY) {
+            speculation.state = Speculation::IDLE;
         } else {
-            LOG_WARNING("Hardware verification failed for key: " + std::to_string(key));
+            speculation.cancelled = true;
         }
+        metrics().speculationCancelled.inc();
+        return false;
     }
+    speculation.claimed = true;
+    speculation.claimKey = key;
+    speculation.claimedAt = std::chrono::steady_clock::now();
+    return true;
 }
 
-LRESULT CALLBACK KeyboardMiddleware::LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam) {
-    if (nCode != HC_ACTION) {
-        return CallNextHookEx(keyboardHook, nCode, wParam, lParam);
+void KeyboardMiddleware::ResolveClaim() {
+    Speculation result;
+    {
+        std::lock_guard<std::mutex> lock(speculationMutex);
+        if (speculation.state != Speculation::READY) {
+            // Still on the device; CompleteSpeculation finishes this challenge
+            speculation.claimWaiting = true;
+            return;
+        }
+        result = speculation;
+        speculation = Speculation();
+    }
+    FinishClaim(result);
+    EndChallenge();
+}
+
+void KeyboardMiddleware::FinishClaim(const Speculation& result) {
+    metrics().speculationHits.inc();
+    LOG_INFO("Key " + std::to_string(result.claimKey) + " answered by pre-armed challenge of length: " +
+             std::to_string(result.length));
+    // Timed from the claim: a round armed early ran before the user meant to
+    // answer it, and counting that would make their pace look slower
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - result.claimedAt).count();
+    metrics().duration.observe(seconds);
+    {
+        std::lock_guard<std::mutex> lock(counterMutex);
+        adaptiveLength.record(result.success, seconds, result.length);
+    }
+    FinishChallenge(result.claimKey, result.success, seconds);
+}
+
+void KeyboardMiddleware::CancelSpeculation(bool fromFocus) {
+    std::lock_guard<std::mutex> lock(speculationMutex);
+    if (speculation.state == Speculation::IDLE || speculation.claimed || speculation.cancelled ||
+        speculation.fromFocus != fromFocus) {
+        return;
+    }
+    if (speculation.state == Speculation::READY) {
+        speculation.state = Speculation::IDLE;
+    } else {
+        // Still on the device; RunSpeculation drops the result
+        speculation.cancelled = true;
+    }
+    metrics().speculationCancelled.inc();
+    LOG_DEBUG("Speculative challenge cancelled");
+}
+
+void KeyboardMiddleware::OnForegroundChanged(bool wasGated) {
+    bool gated = foregroundScope.isGated();
+    if (gated == wasGated) {
+        return;
+    }
+    if (!gated) {
+        CancelSpeculation(true);
+        return;
+    }
+
+    // Any trigger may follow, so arm for the longest
+    MatcherPin pin(*this);
+    const TriggerMatcher* matcher = pin.get();
+    int longest = 0;
+    if (matcher) {
+        for (const KeyConfig& trigger : matcher->all()) {
+            longest = std::max(longest, trigger.targetCounter);
+        }
+    }
+    if (longest > 0) {
+        Speculate(longest, true);
+    }
+}
+
+bool KeyboardMiddleware::IsVerificationCached(uint16_t key, int64_t nowMs) {
+    std::atomic<int64_t>& slot = verifiedUntil[cachePerKey ? (key & 0xFF) : 0];
+    int64_t until = slot.load();
+    if (until == 0) {
+        return false;
+    }
+    if (nowMs >= until) {
+        slot.compare_exchange_strong(until, 0);
+        return false;
+    }
+    return true;
+}
+
+void KeyboardMiddleware::RecordVerification(uint16_t key) {
+    uint32_t ttl = cacheTtlMs;
+    if (ttl > 0) {
+        verifiedUntil[cachePerKey ? (key & 0xFF) : 0] = SteadyMillis() + ttl;
+    }
+}
+
+void KeyboardMiddleware::ClearVerifications() {
+    for (std::atomic<int64_t>& slot : verifiedUntil) {
+        slot = 0;
+    }
+}
+
+bool KeyboardMiddleware::BufferKeyEvent(const KeyEvent& event, bool gatedTrigger) {
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    if (!capturingKeys) {
+        return false;
+    }
+
+    // The replay bypasses the hook, so a trigger held back here would pass
+    // ungated on the current challenge's success. It is dropped instead and
+    // can be pressed again once the challenge is over.
+    if (gatedTrigger) {
+        LOG_INFO("Dropping registered key pressed during a challenge: " + std::to_string(event.vkCode));
+        metrics().keysDiscarded.inc();
+        return true;
+    }
+
+    bool taken = keyBuffer.push(event);
+    if (!taken && !event.keyUp) {
+        LOG_WARNING("Key buffer full, dropping key: " + std::to_string(event.vkCode));
+    }
+    // Key-downs are swallowed even when the buffer is full; key-ups only
+    // when their key-down was held back.
+    return taken || !event.keyUp;
+}
+
+void KeyboardMiddleware::ReplayBufferedKeys() {
+    std::vector<KeyEvent> events;
+
+    // Events that arrive while a batch is being injected are still captured
+    // by the hook, so keep draining until the buffer stays empty. Capture is
+    // only released under the lock to preserve the original key order.
+    while (true) {
+        uint32_t oldest = 0;
+        {
+            std::lock_guard<std::mutex> lock(bufferMutex);
+            if (keyBuffer.empty()) {
+                capturingKeys = false;
+                keyBuffer.clear();
+                return;
+            }
+            oldest = keyBuffer.oldestTime();
+            events.clear();
+            keyBuffer.drainTo(events);
+        }
+
+        LOG_DEBUG("Replaying " + std::to_string(events.size()) + " buffered key events held for " +
+                  std::to_string(CurrentTickCount() - oldest) + " ms");
+        metrics().keysReplayed.inc(events.size());
+        InjectKeyEvents(events);
+    }
+}
+
+void KeyboardMiddleware::InjectKeyEvents(const std::vector<KeyEvent>& events) {
+    std::shared_ptr<const KeyInjector> injector = std::atomic_load(&keyInjector);
+    if (injector) {
+        (*injector)(events);
+        return;
+    }
+
+#ifdef _WIN32
+    std::vector<INPUT> inputs;
+    inputs.reserve(events.size());
+    for (const KeyEvent& ev : events) {
+        INPUT input = {};
+        input.type = INPUT_KEYBOARD;
+        input.ki.wVk = ev.vkCode;
+        input.ki.wScan = ev.scanCode;
+        input.ki.dwFlags = ev.extended ? KEYEVENTF_EXTENDEDKEY : 0;
+        if (ev.keyUp) {
+            input.ki.dwFlags |= KEYEVENTF_KEYUP;
+        }
+        input.ki.dwExtraInfo = REPLAY_EXTRA_INFO;
+        inputs.push_back(input);
+    }
+
+    UINT sent = SendInput(static_cast<UINT>(inputs.size()), inputs.data(), sizeof(INPUT));
+    if (sent != inputs.size()) {
+        LOG_ERROR("SendInput replayed " + std::to_string(sent) + " of " + std::to_string(inputs.size()) +
+                  " key events, GetLastError: " + std::to_string(GetLastError()));
+    }
+#else
+    LOG_WARNING("No key injector set, dropping " + std::to_string(events.size()) + " buffered key events");
+#endif
+}
+
+bool KeyboardMiddleware::CanReplayKeys() const {
+#ifdef _WIN32
+    return true;
+#else
+    return std::atomic_load(&keyInjector) != nullptr;
+#endif
+}
+
+void KeyboardMiddleware::DiscardBufferedKeys() {
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    if (!keyBuffer.empty()) {
+        LOG_INFO("Discarding " + std::to_string(keyBuffer.size()) + " buffered key events");
+        metrics().keysDiscarded.inc(keyBuffer.size());
+    }
+    keyBuffer.clear();
+    capturingKeys = false;
+}
+
+bool KeyboardMiddleware::ProcessKeyEvent(const KeyEvent& event) {
+    Trace::Span span("keyboard", "hook", event.vkCode);
+
+    // Any keyboard input counts as the user still being present
+    int64_t nowMs = 0;
+    if (cacheTtlMs > 0) {
+        nowMs = SteadyMillis();
+        uint32_t idleMs = cacheIdleMs;
+        if (idleMs > 0 && lastActivityMs != 0 && nowMs - lastActivityMs > idleMs) {
+            LOG_INFO("Keyboard idle for " + std::to_string(nowMs - lastActivityMs) +
+                     " ms, dropping cached verifications");
+            ClearVerifications();
+            metrics().cacheInvalidations.inc();
+        }
+        lastActivityMs = nowMs;
+    }
+
+    // Windows outside the configured scopes are never gated
+    if (!capturingKeys && !foregroundScope.isGated()) {
+        return false;
+    }
+
+    bool keyDown = !event.keyUp;
+    uint16_t key = event.vkCode;
+
+    // Every event goes through the matcher so modifier state stays current
+    MatcherPin pin(*this);
+    const TriggerMatcher* matcher = pin.get();
+    int fired = matcher ? matcher->advance(triggerCursor, key, keyDown, event.time) : -1;
+
+    bool gatedTrigger = fired >= 0 && (nowMs == 0 || !IsVerificationCached(key, nowMs));
+    if (capturingKeys && BufferKeyEvent(event, gatedTrigger)) {
+        metrics().keysHeld.inc();
+        return true;
     }
 
-    if (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN) {
-        KBDLLHOOKSTRUCT* kbStruct = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
-        WORD key = kbStruct->vkCode;
+    // Arm when a prediction starts, not on every repeat of a held modifier
+    if (fired < 0 && matcher && speculationTtlMs > 0) {
+        int likely = matcher->predict(triggerCursor);
+        if (likely < 0) {
+            CancelSpeculation(false);
+        } else if (predictedTrigger < 0 && keyDown) {
+            const KeyConfig& trigger = matcher->trigger(likely);
+            if (nowMs == 0 || !IsVerificationCached(trigger.steps.back().key, nowMs)) {
+                Speculate(trigger.targetCounter, false);
+            }
+        }
+        predictedTrigger = likely;
+    }
+
+    if (keyDown && matcher && matcher->isFinalKey(key)) {
+        if (blockKeys) {
+            LOG_DEBUG("Key blocked: " + std::to_string(key));
+            metrics().keysHeld.inc();
+            return true;
+        }
 
-        auto keyConfig = std::find_if(keyConfigs.begin(), keyConfigs.end(),
-            [key](const KeyConfig& config) { return config.key == key; });
+        if (fired >= 0) {
+            int targetCount = matcher->trigger(fired).targetCounter;
 
-        if (keyConfig != keyConfigs.end()) {
-            if (blockKeys) {
-                LOG_DEBUG("Key blocked: " + std::to_string(key));
-                return 1;
+            if (nowMs != 0) {
+                if (IsVerificationCached(key, nowMs)) {
+                    metrics().cacheHits.inc();
+                    LOG_DEBUG("Registered key " + std::to_string(key) + " passed by cached verification");
+                    return false;
+                }
+                metrics().cacheMisses.inc();
             }
 
             LOG_INFO("Registered key pressed: " + std::to_string(key));
             blockKeys = true;
-            std::thread([key]() {
-                SendResponseToApplication(key);
-            }).detach();
+            if (bufferingEnabled) {
+                std::lock_guard<std::mutex> lock(bufferMutex);
+                keyBuffer.clear();
+                keyBuffer.push(event);
+                capturingKeys = true;
+            }
+            bool claimed = speculationTtlMs > 0 && ClaimSpeculation(key, targetCount);
+            StartChallenge(key, targetCount, claimed ? ChallengeMode::CLAIM : ChallengeMode::DEVICE);
+            metrics().keysHeld.inc();
 
-            return 1;
+            return true;
         }
     }
 
+    return false;
+}
+
+#ifdef _WIN32
+LRESULT CALLBACK KeyboardMiddleware::LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam) {
+    if (hookOwner == nullptr) {
+        return CallNextHookEx(NULL, nCode, wParam, lParam);
+    }
+    return hookOwner->HandleKeyEvent(nCode, wParam, lParam);
+}
+
+LRESULT KeyboardMiddleware::HandleKeyEvent(int nCode, WPARAM wParam, LPARAM lParam) {
+    if (nCode != HC_ACTION) {
+        return CallNextHookEx(keyboardHook, nCode, wParam, lParam);
+    }
+
+    KBDLLHOOKSTRUCT* kbStruct = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
+
+    // Our own replayed keystrokes must reach the application untouched
+    if (kbStruct->dwExtraInfo == REPLAY_EXTRA_INFO) {
+        return CallNextHookEx(keyboardHook, nCode, wParam, lParam);
+    }
+
+    KeyEvent event = {
+        static_cast<uint16_t>(kbStruct->vkCode),
+        static_cast<uint16_t>(kbStruct->scanCode),
+        static_cast<uint32_t>(kbStruct->time),
+        !(wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN),
+        (kbStruct->flags & LLKHF_EXTENDED) != 0
+    };
+
+    if (ProcessKeyEvent(event)) {
+        return 1;
+    }
     return CallNextHookEx(keyboardHook, nCode, wParam, lParam);
 }
 
-bool KeyboardMiddleware::Initialize() {
-    LOG_MAIN("Initializing keyboard middleware...");
-    
+void CALLBACK KeyboardMiddleware::ForegroundChangedProc(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
+                                                       LONG idObject, LONG idChild, DWORD thread, DWORD time) {
+    (void)hook; (void)event; (void)idObject; (void)idChild; (void)thread; (void)time;
+
+    if (hookOwner == nullptr) {
+        return;
+    }
+
+    // Delivered on the hook thread, so the cursor can be touched directly.
+    // Modifier events may have been skipped while an ungated app had focus.
+    bool wasGated = hookOwner->foregroundScope.isGated();
+    hookOwner->foregroundScope.update(hwnd);
+    TriggerMatcher::syncModifiers(hookOwner->triggerCursor);
+    hookOwner->OnForegroundChanged(wasGated);
+}
+
+void KeyboardMiddleware::HookThreadMain(std::promise<bool> ready) {
+    Trace::setThreadName("keyboard hook");
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST)) {
+        LOG_WARNING("Failed to raise hook thread priority, GetLastError: " + std::to_string(GetLastError()));
+    }
+
+    // Create this thread's message queue before Cleanup can post WM_QUIT to it
+    MSG msg;
+    PeekMessage(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+    hookOwner = this;
+
     keyboardHook = SetWindowsHookEx(
         WH_KEYBOARD_LL,
         LowLevelKeyboardProc,
@@ -79,17 +739,155 @@ bool KeyboardMiddleware::Initialize() {
 
     if (!keyboardHook) {
         LOG_ERROR("Failed to initialize keyboard hook, GetLastError: " + std::to_string(GetLastError()));
+        hookOwner = nullptr;
+        ready.set_value(false);
+        return;
+    }
+
+    foregroundHook = SetWinEventHook(
+        EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND,
+        NULL,
+        ForegroundChangedProc,
+        0, 0,
+        WINEVENT_OUTOFCONTEXT
+    );
+    if (!foregroundHook) {
+        LOG_WARNING("Failed to watch foreground changes, scoped gating will not follow focus");
+    }
+    foregroundScope.update(GetForegroundWindow());
+
+    hookThreadId = GetCurrentThreadId();
+    initialized = true;
+    ready.set_value(true);
+    LOG_INFO("Hook thread running");
+
+    // Both hooks are serviced from this loop; it ends when Cleanup posts WM_QUIT
+    while (GetMessage(&msg, NULL, 0, 0) > 0) {
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
+    }
+
+    if (foregroundHook != NULL) {
+        UnhookWinEvent(foregroundHook);
+        foregroundHook = NULL;
+    }
+    UnhookWindowsHookEx(keyboardHook);
+    keyboardHook = NULL;
+    hookOwner = nullptr;
+    LOG_INFO("Hook thread stopped");
+}
+
+#endif
+
+bool KeyboardMiddleware::Initialize() {
+    LOG_MAIN("Initializing keyboard middleware...");
+
+#ifdef _WIN32
+    if (hookThread.joinable()) {
+        LOG_WARNING("Keyboard middleware already initialized");
+        return true;
+    }
+
+    // The hook only fires while its thread pumps messages, so it gets a
+    // thread of its own instead of relying on the caller's message loop.
+    std::promise<bool> ready;
+    std::future<bool> started = ready.get_future();
+    hookThread = std::thread(&KeyboardMiddleware::HookThreadMain, this, std::move(ready));
+
+    if (!started.get()) {
+        hookThread.join();
         return false;
     }
+#else
+    if (initialized) {
+        LOG_WARNING("Keyboard middleware already initialized");
+        return true;
+    }
+
+    LOG_WARNING("No system keyboard hook on this platform, key events must be fed through ProcessKeyEvent");
+    initialized = true;
+#endif
 
     LOG_MAIN("Keyboard middleware initialized successfully");
     return true;
 }
 
-void KeyboardMiddleware::RegisterKey(WORD key, int targetCount) {
-    keyConfigs.emplace_back(key, targetCount);
-    LOG_INFO("Registered key: " + std::to_string(key) + 
-             " with target count: " + std::to_string(targetCount));
+bool KeyboardMiddleware::RegisterKey(uint16_t key, int targetCount) {
+    // A plain key fires regardless of which modifiers are held
+    return RegisterTrigger({ { key, TriggerMatcher::MOD_ANY } }, 0, targetCount);
+}
+
+bool KeyboardMiddleware::RegisterTrigger(const std::vector<TriggerMatcher::Step>& steps, uint32_t windowMs, int targetCount) {
+    std::lock_guard<std::mutex> lock(configMutex);
+
+    std::vector<KeyConfig> configs;
+    if (const TriggerMatcher* current = triggerMatcher.load()) {
+        configs = current->all();
+    }
+    configs.push_back(KeyConfig{ steps, windowMs, targetCount });
+    if (!PublishTriggers(std::move(configs))) {
+        return false;
+    }
+
+    LOG_INFO("Registered trigger of " + std::to_string(steps.size()) + " step(s) ending in key: " +
+             std::to_string(steps.empty() ? 0 : steps.back().key) +
+             " with target count: " + std::to_string(targetCount) +
+             " (" + std::to_string(triggerMatcher.load()->stateCount()) + " matcher states)");
+    return true;
+}
+
+bool KeyboardMiddleware::RegisterTriggers(const std::vector<TriggerMatcher::Trigger>& triggers) {
+    std::lock_guard<std::mutex> lock(configMutex);
+
+    std::vector<KeyConfig> configs;
+    if (const TriggerMatcher* current = triggerMatcher.load()) {
+        configs = current->all();
+    }
+    configs.insert(configs.end(), triggers.begin(), triggers.end());
+    if (!PublishTriggers(std::move(configs))) {
+        return false;
+    }
+
+    LOG_INFO("Registered " + std::to_string(triggers.size()) + " trigger(s) (" +
+             std::to_string(triggerMatcher.load()->stateCount()) + " matcher states)");
+    return true;
+}
+
+bool KeyboardMiddleware::ApplyConfig(const Config& config) {
+    {
+        std::lock_guard<std::mutex> lock(configMutex);
+        if (!PublishTriggers(config.triggers)) {
+            return false;
+        }
+    }
+    foregroundScope.replace(config.processes, config.windowClasses);
+
+    LOG_INFO("Applied configuration of " + std::to_string(config.triggers.size()) + " trigger(s)");
+    return true;
+}
+
+bool KeyboardMiddleware::PublishTriggers(std::vector<KeyConfig> configs) {
+    // Compiled before the swap; the hook keeps matching against the old
+    // set until then, and a failed build leaves it in place
+    std::unique_ptr<const TriggerMatcher> previous;
+    try {
+        previous.reset(triggerMatcher.exchange(new TriggerMatcher(std::move(configs))));
+    } catch (const std::exception& e) {
+        LOG_ERROR(std::string("Failed to register trigger: ") + e.what());
+        return false;
+    }
+
+    // Any reader still holding the old matcher was counted before the
+    // exchange. Each flip sends new readers to the other counter, so
+    // waiting for the one left behind, twice, drains both without chasing
+    // readers that keep arriving.
+    for (int flip = 0; flip < 2; flip++) {
+        std::atomic<int>& readers = matcherReaders[matcherEpoch.fetch_add(1) & 1];
+        while (readers.load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+    return true;
 }
 
 void KeyboardMiddleware::SetTargetCounter(int counter) {
@@ -97,21 +895,206 @@ void KeyboardMiddleware::SetTargetCounter(int counter) {
     LOG_INFO("Set target counter to: " + std::to_string(counter));
 }
 
+void KeyboardMiddleware::AddProcessScope(const std::string& exeName) {
+    foregroundScope.addProcess(exeName);
+}
+
+void KeyboardMiddleware::AddWindowClassScope(const std::string& className) {
+    foregroundScope.addWindowClass(className);
+}
+
+void KeyboardMiddleware::ClearScopes() {
+    foregroundScope.clear();
+}
+
+bool KeyboardMiddleware::SetKeyBuffering(bool enabled, size_t capacity) {
+    if (enabled && !CanReplayKeys()) {
+        LOG_ERROR("Key buffering needs a key injector on this platform, leaving it disabled");
+        bufferingEnabled = false;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(bufferMutex);
+        if (!capturingKeys) {
+            keyBuffer.setCapacity(capacity);
+        }
+    }
+    bufferingEnabled = enabled;
+    LOG_INFO(std::string("Key buffering ") + (enabled ? "enabled" : "disabled") +
+             " with capacity: " + std::to_string(capacity));
+    return true;
+}
+
+void KeyboardMiddleware::SetVerificationCache(uint32_t ttlMs, bool perKey, uint32_t idleMs) {
+    // Entries recorded under the other scope would be read from wrong slots
+    if (perKey != cachePerKey) {
+        ClearVerifications();
+    }
+    cachePerKey = perKey;
+    cacheIdleMs = idleMs;
+    cacheTtlMs = ttlMs;
+    if (ttlMs == 0) {
+        ClearVerifications();
+    }
+    LOG_INFO("Verification cache " + (ttlMs > 0 ? "TTL " + std::to_string(ttlMs) + " ms " +
+             (perKey ? "per key" : "for all keys") + ", idle timeout " + std::to_string(idleMs) + " ms"
+             : std::string("disabled")));
+}
+
+void KeyboardMiddleware::InvalidateVerification() {
+    ClearVerifications();
+    metrics().cacheInvalidations.inc();
+    LOG_INFO("Cached verifications invalidated");
+}
+
+void KeyboardMiddleware::AttachScreenLock(std::shared_ptr<ScreenLock> lock) {
+    std::lock_guard<std::mutex> guard(screenLockMutex);
+    screenLock = std::move(lock);
+}
+
+bool KeyboardMiddleware::SetLockout(const Lockout::Policy& policy, const std::string& statePath,
+                                    std::shared_ptr<ScreenLock> lock) {
+    std::lock_guard<std::mutex> guard(lockoutMutex);
+    if (!lockout.configure(policy)) {
+        return false;
+    }
+    lockoutLock = lock ? std::move(lock) : std::make_shared<ScreenLock>(ScreenLock::platformBackend(), eventLoop);
+    lockoutStatePath = statePath;
+    LOG_INFO("Lockout enabled after " + std::to_string(policy.keyThreshold) + " failures per key or " +
+             std::to_string(policy.deviceThreshold) + " per device in " + std::to_string(policy.windowMs) + " ms");
+
+    // A restart must not cut a lockout short
+    if (!statePath.empty() && lockout.load(statePath)) {
+        int64_t remainingMs = lockout.remainingMs(Lockout::nowMs());
+        if (remainingMs > 0) {
+            LOG_WARNING("Resuming lockout, " + std::to_string(remainingMs) + " ms left");
+            lockoutLock->begin(std::chrono::milliseconds(remainingMs));
+        }
+    }
+    return true;
+}
+
+void KeyboardMiddleware::DisableLockout() {
+    std::lock_guard<std::mutex> guard(lockoutMutex);
+    lockout.disable();
+    if (lockoutLock) {
+        lockoutLock->end();
+        lockoutLock.reset();
+    }
+    lockoutStatePath.clear();
+    LOG_INFO("Lockout disabled");
+}
+
+bool KeyboardMiddleware::SetAdaptiveLength(int minLength, int maxLength, size_t window) {
+    std::lock_guard<std::mutex> lock(counterMutex);
+    if (window == 0) {
+        adaptiveLength.disable();
+        LOG_INFO("Adaptive challenge length disabled");
+        return true;
+    }
+    if (!adaptiveLength.configure(minLength, maxLength, window)) {
+        LOG_ERROR("Invalid adaptive challenge length bounds: " + std::to_string(minLength) + ".." +
+                  std::to_string(maxLength));
+        return false;
+    }
+    LOG_INFO("Adaptive challenge length " + std::to_string(minLength) + ".." + std::to_string(maxLength) +
+             " over the last " + std::to_string(window) + " challenges");
+    return true;
+}
+
+void KeyboardMiddleware::SetSpeculation(uint32_t ttlMs) {
+    speculationTtlMs = ttlMs;
+    if (ttlMs == 0) {
+        CancelSpeculation(false);
+        CancelSpeculation(true);
+    }
+    LOG_INFO(ttlMs > 0 ? "Speculative challenges kept for " + std::to_string(ttlMs) + " ms"
+                       : std::string("Speculative challenges disabled"));
+}
+
+void KeyboardMiddleware::UpdateForeground(const std::string& process, const std::string& windowClass) {
+    bool wasGated = foregroundScope.isGated();
+    foregroundScope.update(process, windowClass);
+    OnForegroundChanged(wasGated);
+}
+
+void KeyboardMiddleware::SetKeyInjector(KeyInjector injector) {
+    std::shared_ptr<const KeyInjector> published;
+    if (injector) {
+        published = std::make_shared<const KeyInjector>(std::move(injector));
+    }
+    std::atomic_store(&keyInjector, published);
+    LOG_INFO(published ? "Custom key injector set" : "Default key injector restored");
+
+    // Held keys could only be dropped from here on
+    if (!CanReplayKeys() && bufferingEnabled.exchange(false)) {
+        LOG_WARNING("No key injector left on this platform, key buffering disabled");
+    }
+}
+
 void KeyboardMiddleware::RegisterHardwareCallbacks(
     std::function<void(int)> sendCallback,
     std::function<bool()> receiveCallback
 ) {
-    sendToHardwareCallback = sendCallback;
-    receiveFromHardwareCallback = receiveCallback;
+    ReplaceCallbacks(std::unique_ptr<const HardwareCallbacks>(
+        new HardwareCallbacks{ std::move(sendCallback), std::move(receiveCallback), nullptr }));
     LOG_INFO("Hardware callbacks registered");
 }
 
+void KeyboardMiddleware::RegisterAsyncHardware(AsyncHardware start) {
+    ReplaceCallbacks(std::unique_ptr<const HardwareCallbacks>(new HardwareCallbacks{ nullptr, nullptr, std::move(start) }));
+    LOG_INFO("Asynchronous hardware registered");
+}
+
+void KeyboardMiddleware::ReplaceCallbacks(std::unique_ptr<const HardwareCallbacks> published) {
+    // Challenges only read the callbacks while counted in activeChallenges,
+    // and one counted after the exchange sees the new set. So with none
+    // running the old set is freed at once; otherwise it is retired until
+    // the last running challenge ends.
+    std::unique_ptr<const HardwareCallbacks> previous;
+    std::lock_guard<std::mutex> lock(challengeMutex);
+    previous.reset(callbacks.exchange(published.release(), std::memory_order_acq_rel));
+    if (previous && activeChallenges > 0) {
+        retiredCallbacks.push_back(std::move(previous));
+    }
+}
+
+void KeyboardMiddleware::SetEventLoop(EventLoop* loop) {
+    eventLoop = loop;
+    LOG_INFO(loop ? "Challenges run on the caller's event loop" : "Challenges run on their own threads");
+}
+
 void KeyboardMiddleware::Cleanup() {
-    if (keyboardHook != NULL) {
-        UnhookWindowsHookEx(keyboardHook);
-        keyboardHook = NULL;
+#ifdef _WIN32
+    if (hookThread.joinable()) {
+        PostThreadMessage(hookThreadId, WM_QUIT, 0, 0);
+        hookThread.join();
+        hookThreadId = 0;
         LOG_INFO("Keyboard hook cleaned up");
     }
-    shouldExit = true;
+#endif
+    if (initialized.exchange(false)) {
+        DiscardBufferedKeys();
+    }
+    ClearVerifications();
+    CancelSpeculation(false);
+    CancelSpeculation(true);
+
+    // Challenges reference this instance, so wait them out; on an event loop
+    // they can only finish if the loop keeps running
+    std::unique_lock<std::mutex> lock(challengeMutex);
+    if (activeChallenges > 0) {
+        LOG_INFO("Waiting for " + std::to_string(activeChallenges) + " challenge(s) to finish");
+        if (eventLoop != nullptr) {
+            while (activeChallenges > 0) {
+                lock.unlock();
+                eventLoop->runOnce(EventLoop::Clock::now() + std::chrono::milliseconds(10));
+                lock.lock();
+            }
+        } else {
+            challengeDone.wait(lock, [this]() { return activeChallenges == 0; });
+        }
+    }
     LOG_MAIN("Middleware cleanup complete");
 }
\ No newline at end of file
@@ -1,6 +1,15 @@
 #pragma once
 #include "Logger.hpp"
+#include "AdaptiveLength.hpp"
+#include "KeyEventBuffer.hpp"
+#include "TriggerMatcher.hpp"
+#include "ForegroundScope.hpp"
+#include "Lockout.hpp"
+#ifdef _WIN32
 #include <windows.h>
+#endif
+#include <array>
+#include <chrono>
 #include <vector>
 #include <atomic>
 #include <thread>
@@ -9,35 +18,280 @@
 #include <queue>
 #include <string>
 #include <mutex>
+#include <future>
+#include <condition_variable>
 
+class EventLoop;
+class ScreenLock;
+
+// One independent gating instance: its own hook thread, trigger set,
+// callbacks and buffered keys. Several can run side by side, e.g. one per
+// attached Simon device.
+//
+// The gating itself (ProcessKeyEvent) is platform independent. On Windows it
+// is driven by a low-level keyboard hook; elsewhere the embedder feeds it.
+//
+// Challenges run on detached threads, or, given an EventLoop, as tasks on
+// the thread driving that loop; with asynchronous hardware the latter
+// creates no threads at all (the Windows hook thread aside).
 class KeyboardMiddleware {
-    struct KeyConfig {
-        WORD key;
-        int targetCounter;
-        KeyConfig(WORD k, int t) : key(k), targetCounter(t) {}
+    using KeyConfig = TriggerMatcher::Trigger;
+
+public:
+    using KeyInjector = std::function<void(const std::vector<KeyEvent>&)>;
+
+    // Everything ApplyConfig replaces
+    struct Config {
+        std::vector<TriggerMatcher::Trigger> triggers;
+        std::vector<std::string> processes;
+        std::vector<std::string> windowClasses;
     };
+    // Starts a round of `length` and reports its result through `done`,
+    // without blocking
+    using AsyncHardware = std::function<void(int length, std::function<void(bool success)> done)>;
 
 private:
-    static std::atomic<bool> blockKeys;
-    static HHOOK keyboardHook;
-    static std::vector<KeyConfig> keyConfigs;
-    static bool shouldExit;
-    static std::function<void(int)> sendToHardwareCallback;
-    static std::function<bool()> receiveFromHardwareCallback;
-    static std::atomic<int> targetCounter;
-    static std::mutex counterMutex;
-
-    static void LogMessage(const std::string& message);
-    static void SendResponseToApplication(WORD key);
+    // Published as a whole and never modified, so readers need no lock
+    struct HardwareCallbacks {
+        std::function<void(int)> send;
+        std::function<bool()> receive;
+        AsyncHardware start;    // used instead of send/receive when set
+    };
+
+    std::atomic<bool> blockKeys;
+    std::atomic<bool> initialized;
+#ifdef _WIN32
+    HHOOK keyboardHook;
+    std::thread hookThread;
+    std::atomic<DWORD> hookThreadId;
+#endif
+
+    // Compiled from every registered config; replaced wholesale on
+    // registration, under configMutex. The hook reads it through a
+    // MatcherPin, which counts it as a reader of the current epoch; a
+    // replaced matcher is freed once both epochs' readers have drained.
+    std::atomic<const TriggerMatcher*> triggerMatcher;
+    std::atomic<unsigned> matcherEpoch;
+    std::atomic<int> matcherReaders[2];
+    TriggerMatcher::Cursor triggerCursor;
+    std::mutex configMutex;
+
+    class MatcherPin {
+    public:
+        explicit MatcherPin(KeyboardMiddleware& owner);
+        ~MatcherPin();
+        MatcherPin(const MatcherPin&) = delete;
+        MatcherPin& operator=(const MatcherPin&) = delete;
+        const TriggerMatcher* get() const { return matcher; }
+    private:
+        std::atomic<int>& readers;
+        const TriggerMatcher* matcher;
+    };
+
+    std::atomic<const HardwareCallbacks*> callbacks;
+    // Replaced sets a running challenge may still be using; guarded by
+    // challengeMutex and freed once no challenge is running
+    std::vector<std::unique_ptr<const HardwareCallbacks>> retiredCallbacks;
+    std::atomic<int> targetCounter;
+    std::mutex counterMutex;
+    AdaptiveLength adaptiveLength;      // guarded by counterMutex
+    std::mutex deviceMutex;             // one blocking round at a time
+
+    // Challenges still running; Cleanup waits for them
+    int activeChallenges;
+    std::mutex challengeMutex;
+    std::condition_variable challengeDone;
+    EventLoop* eventLoop;
+
+    // Keystroke buffering while a challenge is pending
+    static constexpr uintptr_t REPLAY_EXTRA_INFO = 0x53494D4E; // "SIMN"
+    std::atomic<bool> bufferingEnabled;
+    std::atomic<bool> capturingKeys;
+    KeyEventBuffer keyBuffer;
+    std::mutex bufferMutex;
+    std::shared_ptr<const KeyInjector> keyInjector;
+
+    // Foreground process/window scoping
+    ForegroundScope foregroundScope;
+
+    // Screen lock ended early by a passed challenge
+    std::shared_ptr<ScreenLock> screenLock;
+    std::mutex screenLockMutex;
+
+    // Escalating lockouts after failures, and the screen lock they drive
+    Lockout lockout;
+    std::shared_ptr<ScreenLock> lockoutLock;
+    std::string lockoutStatePath;
+    std::mutex lockoutMutex;
+
+    // Verification cache: steady-clock ms until which a passed challenge
+    // answers repeat triggers, per trigger key (or slot 0 for all keys)
+    std::atomic<uint32_t> cacheTtlMs;
+    std::atomic<uint32_t> cacheIdleMs;
+    std::atomic<bool> cachePerKey;
+    std::array<std::atomic<int64_t>, 256> verifiedUntil;
+    int64_t lastActivityMs;     // hook thread only
+
+    // Speculative challenges: a device round started when a trigger looks
+    // imminent, which the trigger then claims instead of starting its own.
+    // The device protocol has no abort, so a cancelled round still runs to
+    // its end and only its result is dropped.
+    struct Speculation {
+        enum State { IDLE, RUNNING, READY };
+        State state = IDLE;
+        bool fromFocus = false;
+        bool claimed = false;
+        bool cancelled = false;
+        int baseLength = 0;         // registered length the round was armed for
+        int length = 0;             // length actually sent
+        bool success = false;
+        int64_t readyAtMs = 0;
+        uint16_t claimKey = 0;
+        std::chrono::steady_clock::time_point claimedAt;
+        bool claimWaiting = false;  // claimed before the round finished
+    };
+    enum class ChallengeMode { DEVICE, SPECULATE, CLAIM };
+    std::atomic<uint32_t> speculationTtlMs;
+    Speculation speculation;
+    std::mutex speculationMutex;
+    int predictedTrigger;       // hook thread only
+
+    void LogMessage(const std::string& message);
+    bool PublishTriggers(std::vector<KeyConfig> configs);
+    void SendResponseToApplication(uint16_t key, int targetCount);
+    void RunDeviceRound(int length, std::function<void(bool)> done);
+    void FinishChallenge(uint16_t key, bool success, double seconds);
+    bool ApplyLockout(uint16_t key);
+    // Holds `event` back while capturing; a gated trigger is dropped
+    bool BufferKeyEvent(const KeyEvent& event, bool gatedTrigger);
+    void ReplayBufferedKeys();
+    void DiscardBufferedKeys();
+    void InjectKeyEvents(const std::vector<KeyEvent>& events);
+    bool CanReplayKeys() const;
+    void StartChallenge(uint16_t key, int targetCount, ChallengeMode mode = ChallengeMode::DEVICE);
+    void RunChallenge(uint16_t key, int targetCount, ChallengeMode mode);
+    void EndChallenge();
+    void HoldChallenge();
+    void ReleaseChallenge();
+    void ReplaceCallbacks(std::unique_ptr<const HardwareCallbacks> published);
+    void Speculate(int targetCount, bool fromFocus);
+    void RunSpeculation(int targetCount);
+    void CompleteSpeculation(int length, bool success);
+    bool ClaimSpeculation(uint16_t key, int targetCount);
+    void ResolveClaim();
+    void FinishClaim(const Speculation& result);
+    void CancelSpeculation(bool fromFocus);
+    void OnForegroundChanged(bool wasGated);
+    bool IsVerificationCached(uint16_t key, int64_t nowMs);
+    void RecordVerification(uint16_t key);
+    void ClearVerifications();
+
+#ifdef _WIN32
+    HWINEVENTHOOK foregroundHook;
+
+    void HookThreadMain(std::promise<bool> ready);
+    LRESULT HandleKeyEvent(int nCode, WPARAM wParam, LPARAM lParam);
+
+    // Win32 hooks carry no context pointer; both are delivered on the hook
+    // thread that installed them, which records its owner in a thread_local.
     static LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lParam);
+    static void CALLBACK ForegroundChangedProc(HWINEVENTHOOK hook, DWORD event, HWND hwnd,
+                                               LONG idObject, LONG idChild, DWORD thread, DWORD time);
+#endif
 
 public:
-    static bool Initialize();
-    static void RegisterKey(WORD key, int targetCount);
-    static void SetTargetCounter(int counter);
-    static void RegisterHardwareCallbacks(
+    KeyboardMiddleware();
+    ~KeyboardMiddleware();
+
+    KeyboardMiddleware(const KeyboardMiddleware&) = delete;
+    KeyboardMiddleware& operator=(const KeyboardMiddleware&) = delete;
+
+    bool Initialize();
+    bool IsInitialized() const { return initialized.load(); }
+    bool RegisterKey(uint16_t key, int targetCount);
+    bool RegisterTrigger(const std::vector<TriggerMatcher::Step>& steps, uint32_t windowMs, int targetCount);
+    // Adds several triggers with one matcher rebuild; none are added if any
+    // is invalid
+    bool RegisterTriggers(const std::vector<TriggerMatcher::Trigger>& triggers);
+    // Replaces every trigger and scope. The new trigger set is compiled
+    // first and published in one swap, so the hook sees either the old set
+    // or the new one; on an invalid config nothing changes.
+    bool ApplyConfig(const Config& config);
+    void SetTargetCounter(int counter);
+    void AddProcessScope(const std::string& exeName);
+    void AddWindowClassScope(const std::string& className);
+    void ClearScopes();
+    // Held keys are replayed through the key injector, and outside Windows
+    // there is none by default: enabling buffering there before
+    // SetKeyInjector returns false and leaves it off.
+    bool SetKeyBuffering(bool enabled, size_t capacity = KeyEventBuffer::DEFAULT_CAPACITY);
+
+    // Lets a passed challenge answer repeat triggers for `ttlMs` (0 turns
+    // the cache off) without the device, either per trigger key or for all
+    // keys. Cached passes are dropped after `idleMs` without keyboard input
+    // (0 = never), after a failed challenge and on InvalidateVerification().
+    void SetVerificationCache(uint32_t ttlMs, bool perKey, uint32_t idleMs);
+    // Call when the session locks or the user otherwise changes
+    void InvalidateVerification();
+
+    // Adapts each trigger's challenge length to the recent success rate and
+    // pace (see AdaptiveLength), within [minLength, maxLength]. A window of
+    // 0 turns adaptation off. Returns false on invalid bounds.
+    bool SetAdaptiveLength(int minLength, int maxLength, size_t window);
+
+    // Starts a challenge round ahead of the trigger when one looks imminent:
+    // a chord's modifiers are held, a sequence is one key from done, or focus
+    // moves into a gated scope. The trigger then only waits for the user's
+    // input. A finished round is kept for `ttlMs` (0 turns speculation off)
+    // and dropped once the prediction lapses.
+    void SetSpeculation(uint32_t ttlMs);
+
+    // Reports a foreground change on platforms without a foreground hook.
+    // Must be called from the thread that calls ProcessKeyEvent.
+    void UpdateForeground(const std::string& process, const std::string& windowClass);
+
+    // Ends `lock` as soon as a challenge passes, so a locked-out user can
+    // unlock by beating the device. Pass nullptr to detach.
+    void AttachScreenLock(std::shared_ptr<ScreenLock> lock);
+
+    // Locks input for escalating durations after repeated failures (see
+    // Lockout), through `lock` or else the platform's ScreenLock; passed
+    // challenges do not end it. A failed trigger can then be tried again
+    // instead of staying blocked. With a `statePath` the counts survive
+    // restarts and a lockout still running is resumed here. Returns false
+    // on an invalid policy. The platform lock runs on the event loop, if
+    // one is set; a `lock` given here should share it.
+    bool SetLockout(const Lockout::Policy& policy, const std::string& statePath,
+                    std::shared_ptr<ScreenLock> lock = nullptr);
+    void DisableLockout();
+
+    // Replaces SendInput for replaying buffered keys, e.g. for a uinput
+    // device or a test harness. Pass nullptr to restore the default, which
+    // outside Windows also turns buffering off.
+    void SetKeyInjector(KeyInjector injector);
+
+    // Runs one event through the gate and returns true if it must be held
+    // back from the application. Must always be called from the same thread;
+    // on Windows that is the hook thread.
+    bool ProcessKeyEvent(const KeyEvent& event);
+    // True while triggers are held back: from a trigger until its challenge
+    // has finished, and after a failure unless lockouts are on
+    bool IsBlocking() const { return blockKeys; }
+    // Lifts the block a failed challenge leaves on the triggers. Returns
+    // false, changing nothing, while a challenge is still running. Call it
+    // from the thread that feeds ProcessKeyEvent.
+    bool Rearm();
+    void RegisterHardwareCallbacks(
         std::function<void(int)> sendCallback,
         std::function<bool()> receiveCallback
     );
-    static void Cleanup();
-};
\ No newline at end of file
+    // Replaces the blocking callbacks with hardware that reports each result
+    // later, e.g. through a DevicePool
+    void RegisterAsyncHardware(AsyncHardware start);
+
+    // Runs challenges on `loop` instead of on threads of their own. Must be
+    // set before Initialize(); Cleanup() must then be called from the thread
+    // driving the loop, which it pumps until running challenges finish.
+    void SetEventLoop(EventLoop* loop);
+    void Cleanup();
+};
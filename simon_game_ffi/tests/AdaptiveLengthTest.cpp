@@ -0,0 +1,83 @@
+#include "AdaptiveLength.hpp"
+#include "TestSupport.hpp"
+#include <cmath>
+
+TEST_CASE(DisabledPolicyKeepsTheBaseLength) {
+    AdaptiveLength policy;
+    CHECK(!policy.isEnabled());
+    policy.record(false, 10.0, 4);
+    CHECK_EQ(policy.nextLength(4), 4);
+    CHECK_EQ(policy.offset(), 0);
+}
+
+TEST_CASE(RejectsInvalidBounds) {
+    AdaptiveLength policy;
+    CHECK(!policy.configure(0, 8, 10));
+    CHECK(!policy.configure(6, 5, 10));
+    CHECK(!policy.configure(3, 8, 0));
+    CHECK(!policy.isEnabled());
+    CHECK(policy.configure(3, 8, 10));
+    CHECK(policy.isEnabled());
+}
+
+TEST_CASE(FailuresLengthenUpToTheMaximum) {
+    AdaptiveLength policy;
+    REQUIRE(policy.configure(3, 8, 10));
+    CHECK_EQ(policy.nextLength(4), 4);
+    for (int i = 0; i < 20; i++) {
+        policy.record(false, 5.0, policy.nextLength(4));
+    }
+    CHECK_EQ(policy.nextLength(4), 8);
+    CHECK_EQ(policy.offset(), 5);
+    CHECK(policy.successRate() == 0.0);
+}
+
+TEST_CASE(FluentPassesShortenDownToTheMinimum) {
+    AdaptiveLength policy;
+    REQUIRE(policy.configure(3, 8, 10));
+    for (int i = 0; i < 20; i++) {
+        int length = policy.nextLength(6);
+        policy.record(true, 0.5 * length, length);
+    }
+    CHECK_EQ(policy.nextLength(6), 3);
+    CHECK(policy.successRate() == 1.0);
+    CHECK(policy.averageStepSeconds() == 0.5);
+}
+
+TEST_CASE(SlowPassesHoldTheLength) {
+    AdaptiveLength policy;
+    REQUIRE(policy.configure(3, 8, 10));
+    for (int i = 0; i < 20; i++) {
+        policy.record(true, 3.0 * 5, 5);
+    }
+    CHECK_EQ(policy.nextLength(5), 5);
+}
+
+TEST_CASE(OldResultsLeaveTheWindow) {
+    AdaptiveLength policy;
+    REQUIRE(policy.configure(1, 10, 4));
+    for (int i = 0; i < 4; i++) {
+        policy.record(false, 1.0, 5);
+    }
+    CHECK(policy.successRate() == 0.0);
+    for (int i = 0; i < 4; i++) {
+        policy.record(true, 1.0, 5);
+    }
+    // Only the four passes remain in the window
+    CHECK(policy.successRate() == 1.0);
+    CHECK(std::fabs(policy.averageStepSeconds() - 0.2) < 1e-9);
+}
+
+TEST_CASE(ReconfiguringStartsOver) {
+    AdaptiveLength policy;
+    REQUIRE(policy.configure(3, 8, 10));
+    policy.record(false, 1.0, 4);
+    CHECK_EQ(policy.offset(), 1);
+    REQUIRE(policy.configure(3, 8, 10));
+    CHECK_EQ(policy.offset(), 0);
+    CHECK(policy.successRate() == 0.0);
+    policy.disable();
+    CHECK_EQ(policy.nextLength(4), 4);
+}
+
+TEST_MAIN()
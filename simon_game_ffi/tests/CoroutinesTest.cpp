@@ -0,0 +1,98 @@
+#include "Coroutines.hpp"
+#include "SimonSimulator.hpp"
+#include "TestSupport.hpp"
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+    // Plays `rounds` challenges back to back and counts the passes
+    simon::task<int> playRounds(simon::device& board, int rounds) {
+        int passed = 0;
+        for (int i = 0; i < rounds; i++) {
+            if (co_await simon::run_challenge(board, 3 + i % 4, std::chrono::milliseconds(500))) {
+                passed++;
+            }
+        }
+        co_return passed;
+    }
+
+    template <typename Done>
+    void runUntil(EventLoop& loop, Done done) {
+        auto deadline = EventLoop::Clock::now() + std::chrono::seconds(10);
+        while (!done() && EventLoop::Clock::now() < deadline) {
+            loop.runOnce(std::min(loop.nextDeadline(), deadline));
+        }
+    }
+}
+
+TEST_CASE(DrivesManyBoardsFromOneThread) {
+    EventLoop loop;
+    std::vector<std::unique_ptr<SimonSimulator>> boards;
+    std::vector<std::unique_ptr<SerialMonitor>> ports;
+    std::vector<std::unique_ptr<simon::device>> devices;
+    for (int i = 0; i < 4; i++) {
+        bool passes = i != 3;
+        boards.emplace_back(new SimonSimulator([passes](int) { return SimonSimulator::answer(passes, 2); }));
+        ports.emplace_back(new SerialMonitor(boards.back()->path()));
+        REQUIRE(ports.back()->connect());
+        devices.emplace_back(new simon::device(loop, *ports.back()));
+    }
+
+    int finished = 0;
+    int passed = 0;
+    bool offThread = false;
+    std::thread::id caller = std::this_thread::get_id();
+    for (std::unique_ptr<simon::device>& device : devices) {
+        simon::spawn(playRounds(*device, 5), [&](int count) {
+            finished++;
+            passed += count;
+            offThread = offThread || std::this_thread::get_id() != caller;
+        });
+    }
+
+    runUntil(loop, [&]() { return finished == 4; });
+    CHECK_EQ(finished, 4);
+    CHECK_EQ(passed, 15);
+    CHECK(!offThread);
+    for (const std::unique_ptr<SimonSimulator>& board : boards) {
+        CHECK_EQ(board->received().size(), 5u);
+    }
+}
+
+TEST_CASE(SilentBoardTimesOut) {
+    EventLoop loop;
+    SimonSimulator board([](int) { return SimonSimulator::silent(); });
+    SerialMonitor port(board.path());
+    REQUIRE(port.connect());
+    simon::device device(loop, port);
+
+    bool done = false;
+    bool result = true;
+    auto started = EventLoop::Clock::now();
+    simon::spawn(simon::run_challenge(device, 4, std::chrono::milliseconds(50)), [&](bool passed) {
+        done = true;
+        result = passed;
+    });
+
+    runUntil(loop, [&]() { return done; });
+    CHECK(done);
+    CHECK(!result);
+    CHECK(EventLoop::Clock::now() - started >= std::chrono::milliseconds(50));
+}
+
+TEST_CASE(SleepResumesOnTheLoop) {
+    EventLoop loop;
+    auto wake = EventLoop::Clock::now() + std::chrono::milliseconds(20);
+    bool done = false;
+    simon::spawn([](EventLoop& loop, EventLoop::Clock::time_point when) -> simon::task<void> {
+        co_await simon::sleep_until(loop, when);
+    }(loop, wake), [&]() { done = true; });
+
+    CHECK(!done);
+    runUntil(loop, [&]() { return done; });
+    CHECK(done);
+    CHECK(EventLoop::Clock::now() >= wake);
+}
+
+TEST_MAIN()
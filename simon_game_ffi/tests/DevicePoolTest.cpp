@@ -0,0 +1,205 @@
+#include "DevicePool.hpp"
+#include "SimonSimulator.hpp"
+#include "TestSupport.hpp"
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+    DevicePool::Options fastOptions() {
+        DevicePool::Options options;
+        options.challengeTimeoutMs = 200;
+        options.maxMissedReplies = 2;
+        options.reconnectIntervalMs = 60000;
+        return options;
+    }
+}
+
+TEST_CASE(SpreadsChallengesOverAllBoards) {
+    std::vector<std::unique_ptr<SimonSimulator>> boards;
+    DevicePool pool(fastOptions());
+    for (int i = 0; i < 4; i++) {
+        boards.emplace_back(new SimonSimulator([](int) { return SimonSimulator::answer(true, 50); }));
+        REQUIRE(pool.addDevice(boards.back()->path()));
+    }
+    pool.start();
+
+    std::vector<std::future<bool>> results;
+    for (int i = 0; i < 8; i++) {
+        results.push_back(pool.submit(3 + i));
+    }
+    for (std::future<bool>& result : results) {
+        CHECK(result.get());
+    }
+
+    size_t total = 0;
+    for (const std::unique_ptr<SimonSimulator>& board : boards) {
+        CHECK(!board->received().empty());
+        total += board->received().size();
+    }
+    CHECK_EQ(total, 8u);
+}
+
+TEST_CASE(SendsToIdleBoardWhileAnotherIsBusy) {
+    SimonSimulator slow([](int) { return SimonSimulator::answer(true, 150); });
+    SimonSimulator fast([](int) { return SimonSimulator::answer(true, 5); });
+    DevicePool pool(fastOptions());
+    REQUIRE(pool.addDevice(slow.path()));
+    REQUIRE(pool.addDevice(fast.path()));
+    pool.start();
+
+    std::future<bool> first = pool.submit(4);
+    CHECK(pool.runChallenge(4));
+    CHECK(pool.runChallenge(4));
+    CHECK(pool.runChallenge(4));
+    CHECK(first.get());
+
+    CHECK_EQ(slow.received().size(), 1u);
+    CHECK_EQ(fast.received().size(), 3u);
+}
+
+TEST_CASE(ReportsFailureFromBoard) {
+    SimonSimulator board([](int) { return SimonSimulator::answer(false, 5); });
+    DevicePool pool(fastOptions());
+    REQUIRE(pool.addDevice(board.path()));
+    pool.start();
+
+    CHECK(!pool.runChallenge(3));
+    CHECK_EQ(pool.healthyCount(), 1);
+}
+
+TEST_CASE(FailsOverWhenBoardIsUnplugged) {
+    SimonSimulator unplugged([](int) { return SimonSimulator::hangUpReply(20); });
+    SimonSimulator backup([](int) { return SimonSimulator::answer(true, 5); });
+    DevicePool pool(fastOptions());
+    REQUIRE(pool.addDevice(unplugged.path()));
+    REQUIRE(pool.addDevice(backup.path()));
+    pool.start();
+
+    CHECK(pool.runChallenge(5));
+    CHECK_EQ(unplugged.received().size(), 1u);
+    CHECK_EQ(backup.received().size(), 1u);
+    CHECK_EQ(pool.healthyCount(), 1);
+}
+
+TEST_CASE(DropsBoardThatStopsAnswering) {
+    SimonSimulator silent([](int) { return SimonSimulator::silent(); });
+    SimonSimulator working([](int) { return SimonSimulator::answer(true, 5); });
+    DevicePool::Options options = fastOptions();
+    options.lateReplyGraceMs = 0;
+    DevicePool pool(options);
+    REQUIRE(pool.addDevice(silent.path()));
+    REQUIRE(pool.addDevice(working.path()));
+    pool.start();
+
+    // Ties go to the board added first, and with no grace period after a
+    // timeout the silent one is tried again until dropped
+    CHECK(!pool.runChallenge(3));
+    CHECK(!pool.runChallenge(3));
+    CHECK_EQ(pool.healthyCount(), 1);
+
+    CHECK(pool.runChallenge(3));
+    CHECK_EQ(silent.received().size(), 2u);
+    CHECK_EQ(working.received().size(), 1u);
+}
+
+TEST_CASE(IgnoresReplyThatArrivesAfterTheTimeout) {
+    // The first round is answered "True" 100 ms too late; every later one
+    // promptly fails
+    SimonSimulator board([](int length) {
+        return length == 3 ? SimonSimulator::answer(true, 300) : SimonSimulator::answer(false, 5);
+    });
+    DevicePool::Options options = fastOptions();
+    options.lateReplyGraceMs = 300;
+    DevicePool pool(options);
+    REQUIRE(pool.addDevice(board.path()));
+    pool.start();
+
+    std::future<bool> abandoned = pool.submit(3);
+    std::future<bool> next = pool.submit(4);
+    CHECK(!abandoned.get());
+    CHECK(!next.get());
+    CHECK_EQ(board.received().size(), 2u);
+    CHECK_EQ(pool.healthyCount(), 1);
+}
+
+TEST_CASE(ReconnectsDroppedBoard) {
+    std::atomic<bool> answering(false);
+    SimonSimulator board([&answering](int) {
+        return answering ? SimonSimulator::answer(true, 5) : SimonSimulator::silent();
+    });
+
+    DevicePool::Options options = fastOptions();
+    options.challengeTimeoutMs = 50;
+    options.maxMissedReplies = 1;
+    options.reconnectIntervalMs = 50;
+    DevicePool pool(options);
+    REQUIRE(pool.addDevice(board.path()));
+    pool.start();
+
+    CHECK(!pool.runChallenge(3));
+    CHECK_EQ(pool.healthyCount(), 0);
+    CHECK(!pool.runChallenge(3));
+
+    answering = true;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (pool.healthyCount() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    CHECK_EQ(pool.healthyCount(), 1);
+    CHECK(pool.runChallenge(3));
+}
+
+TEST_CASE(StopFailsPendingChallenges) {
+    SimonSimulator board([](int) { return SimonSimulator::answer(true, 1000); });
+    DevicePool pool(fastOptions());
+    REQUIRE(pool.addDevice(board.path()));
+
+    std::future<bool> queued = pool.submit(3);
+    pool.start();
+    std::future<bool> waiting = pool.submit(3);
+    pool.stop();
+
+    CHECK(!queued.get());
+    CHECK(!waiting.get());
+}
+
+TEST_CASE(AddDeviceFailsForMissingPort) {
+    DevicePool pool(fastOptions());
+    CHECK(!pool.addDevice("/dev/does-not-exist"));
+    CHECK_EQ(pool.healthyCount(), 0);
+}
+
+TEST_CASE(SharedLoopRunsOnTheCallersThread) {
+    SimonSimulator first([](int) { return SimonSimulator::answer(true, 20); });
+    SimonSimulator second([](int) { return SimonSimulator::answer(false, 5); });
+    EventLoop loop;
+    DevicePool pool(fastOptions(), &loop);
+    REQUIRE(pool.addDevice(first.path()));
+    REQUIRE(pool.addDevice(second.path()));
+    pool.start();
+
+    int passed = 0;
+    int failed = 0;
+    bool offThread = false;
+    std::thread::id caller = std::this_thread::get_id();
+    for (int i = 0; i < 4; i++) {
+        pool.submit(3, [&](bool success) {
+            (success ? passed : failed)++;
+            offThread = offThread || std::this_thread::get_id() != caller;
+        });
+    }
+
+    auto deadline = EventLoop::Clock::now() + std::chrono::seconds(5);
+    while (passed + failed < 4 && EventLoop::Clock::now() < deadline) {
+        loop.runOnce(loop.nextDeadline());
+    }
+    CHECK_EQ(passed + failed, 4);
+    CHECK_EQ(static_cast<size_t>(passed), first.received().size());
+    CHECK_EQ(static_cast<size_t>(failed), second.received().size());
+    CHECK(!offThread);
+    CHECK(!pool.runChallenge(3));
+}
+
+TEST_MAIN()
\ No newline at end of file
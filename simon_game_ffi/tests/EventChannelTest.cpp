@@ -0,0 +1,148 @@
+#include "EventChannel.hpp"
+#include "TestSupport.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+TEST_CASE(RegionCarriesTheHeader) {
+    REQUIRE(EventChannel::open());
+    size_t size = 0;
+    const uint32_t* header = static_cast<const uint32_t*>(EventChannel::region(size));
+    REQUIRE(header != nullptr);
+    CHECK_EQ(size, 64u * (3 + EventChannel::CAPACITY));
+    CHECK_EQ(header[0], EventChannel::MAGIC);
+    CHECK_EQ(header[1], EventChannel::VERSION);
+    CHECK_EQ(header[2], EventChannel::CAPACITY);
+#ifdef __linux__
+    CHECK(EventChannel::fd() >= 0);
+#endif
+}
+
+TEST_CASE(SubscriberSeesEventsInOrder) {
+    EventChannel::Subscription subscription;
+    EventChannel::Event event;
+    CHECK(!subscription.next(event));
+
+    EventChannel::publish(EventChannel::CHALLENGE_STARTED, 0x53, 4);
+    EventChannel::publish(EventChannel::CHALLENGE_FINISHED, 0x53, 1, 250);
+    EventChannel::publish(EventChannel::DEVICE_CONNECTED, -1, 1, 0, "/dev/ttyACM0");
+
+    REQUIRE(subscription.next(event));
+    uint64_t first = event.sequence;
+    CHECK_EQ(event.type, EventChannel::CHALLENGE_STARTED);
+    CHECK_EQ(event.key, 0x53);
+    CHECK_EQ(event.value, 4);
+
+    REQUIRE(subscription.next(event));
+    CHECK_EQ(event.sequence, first + 1);
+    CHECK_EQ(event.type, EventChannel::CHALLENGE_FINISHED);
+    CHECK_EQ(event.detail, 250);
+
+    REQUIRE(subscription.next(event));
+    CHECK_EQ(event.type, EventChannel::DEVICE_CONNECTED);
+    CHECK(std::strcmp(event.text, "/dev/ttyACM0") == 0);
+    CHECK(!subscription.next(event));
+    CHECK_EQ(subscription.dropped(), 0u);
+}
+
+TEST_CASE(SlowReaderSkipsOverwrittenEvents) {
+    EventChannel::Subscription subscription;
+    for (uint32_t i = 0; i < EventChannel::CAPACITY + 10; i++) {
+        EventChannel::publish(EventChannel::CHALLENGE_STARTED, 0, static_cast<int32_t>(i));
+    }
+
+    EventChannel::Event event;
+    REQUIRE(subscription.next(event));
+    CHECK_EQ(event.value, 10);
+    CHECK_EQ(subscription.dropped(), 10u);
+
+    uint32_t read = 1;
+    while (subscription.next(event)) {
+        read++;
+    }
+    CHECK_EQ(read, EventChannel::CAPACITY);
+    CHECK_EQ(event.value, static_cast<int32_t>(EventChannel::CAPACITY + 9));
+}
+
+TEST_CASE(ConcurrentProducersLoseNothingUnread) {
+    const int PRODUCERS = 4;
+    const int EACH = 20000;
+    EventChannel::Subscription subscription;
+    std::atomic<bool> done(false);
+
+    uint64_t received = 0;
+    bool ordered = true;
+    bool intact = true;
+    std::thread reader([&]() {
+        EventChannel::Event event;
+        uint64_t last = 0;
+        bool any = false;
+        while (true) {
+            bool finished = done;
+            while (subscription.next(event)) {
+                ordered = ordered && (!any || event.sequence > last);
+                // Producers write key == value, so a torn read shows up here
+                intact = intact && event.key == event.value;
+                last = event.sequence;
+                any = true;
+                received++;
+            }
+            if (finished) {
+                break;
+            }
+            subscription.wait(10);
+        }
+    });
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([p]() {
+            for (int i = 0; i < EACH; i++) {
+                int32_t value = p * EACH + i;
+                EventChannel::publish(EventChannel::CHALLENGE_STARTED, value, value);
+            }
+        });
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    done = true;
+    reader.join();
+
+    CHECK(ordered);
+    CHECK(intact);
+    CHECK_EQ(received + subscription.dropped(), static_cast<uint64_t>(PRODUCERS * EACH));
+}
+
+TEST_CASE(WaitWakesOnPublishAndTimesOut) {
+    EventChannel::Subscription subscription;
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK(!subscription.wait(30));
+    CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(30));
+
+    std::thread publisher([]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        EventChannel::publish(EventChannel::CHALLENGE_STARTED, 0, 1);
+    });
+    start = std::chrono::steady_clock::now();
+    CHECK(subscription.wait(5000));
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+    publisher.join();
+
+    EventChannel::Event event;
+    CHECK(subscription.next(event));
+}
+
+TEST_CASE(StatusFieldsAreShared) {
+    REQUIRE(EventChannel::open());
+    EventChannel::setStatus(EventChannel::DEVICES_CONNECTED, 2);
+    EventChannel::addStatus(EventChannel::CHALLENGES_SUCCEEDED, 3);
+    EventChannel::addStatus(EventChannel::CHALLENGES_SUCCEEDED, 1);
+    CHECK_EQ(EventChannel::status(EventChannel::DEVICES_CONNECTED), 2);
+    CHECK(EventChannel::status(EventChannel::CHALLENGES_SUCCEEDED) >= 4);
+}
+
+TEST_MAIN()
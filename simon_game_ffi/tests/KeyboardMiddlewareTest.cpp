@@ -0,0 +1,473 @@
+#include "middleWhere.hpp"
+#include "EventLoop.hpp"
+#include "TestSupport.hpp"
+#include "simon_game.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    const uint16_t KEY_S = 0x53;
+    const uint16_t KEY_D = 0x44;
+    const uint16_t KEY_K = 0x4B;
+
+    // Middleware fed synthetic events, with a device that always passes
+    struct Harness {
+        KeyboardMiddleware middleware;
+        std::atomic<int> challenges{0};
+        std::atomic<int> released{0};
+        std::atomic<int> lastLength{0};
+        uint32_t time = 1000;
+
+        Harness() {
+            middleware.SetKeyInjector([this](const std::vector<KeyEvent>&) { released++; });
+            middleware.SetKeyBuffering(true);
+            middleware.RegisterHardwareCallbacks([this](int length) {
+                lastLength = length;
+                challenges++;
+            }, []() { return true; });
+            middleware.RegisterKey(KEY_S, 3);
+            middleware.RegisterKey(KEY_D, 3);
+        }
+
+        // Presses and releases `key`; returns true if the press was held back
+        // for a challenge, after waiting for that challenge to pass
+        bool press(uint16_t key) {
+            int before = released;
+            bool held = middleware.ProcessKeyEvent(KeyEvent{ key, 0, time++, false, false });
+            if (held) {
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+                while (released == before && std::chrono::steady_clock::now() < deadline) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+            middleware.ProcessKeyEvent(KeyEvent{ key, 0, time++, true, false });
+            return held;
+        }
+
+        void modifier(uint16_t key, bool down) {
+            middleware.ProcessKeyEvent(KeyEvent{ key, 0, time++, !down, false });
+        }
+
+        bool waitForChallenges(int count) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (challenges < count && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return challenges == count;
+        }
+    };
+}
+
+TEST_CASE(WithoutCacheEveryTriggerIsChallenged) {
+    Harness harness;
+    CHECK(harness.press(KEY_S));
+    CHECK(harness.press(KEY_S));
+    CHECK_EQ(harness.challenges.load(), 2);
+}
+
+TEST_CASE(CachedPassSkipsTheDevice) {
+    Harness harness;
+    harness.middleware.SetVerificationCache(10000, true, 0);
+
+    CHECK(harness.press(KEY_S));
+    CHECK(!harness.press(KEY_S));
+    CHECK(!harness.press(KEY_S));
+    CHECK_EQ(harness.challenges.load(), 1);
+
+    // Per-key scope: another trigger still needs its own pass
+    CHECK(harness.press(KEY_D));
+    CHECK_EQ(harness.challenges.load(), 2);
+}
+
+TEST_CASE(SharedScopeCoversAllKeys) {
+    Harness harness;
+    harness.middleware.SetVerificationCache(10000, false, 0);
+
+    CHECK(harness.press(KEY_S));
+    CHECK(!harness.press(KEY_D));
+    CHECK_EQ(harness.challenges.load(), 1);
+}
+
+TEST_CASE(CachedPassExpires) {
+    Harness harness;
+    harness.middleware.SetVerificationCache(50, true, 0);
+
+    CHECK(harness.press(KEY_S));
+    CHECK(!harness.press(KEY_S));
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    CHECK(harness.press(KEY_S));
+    CHECK_EQ(harness.challenges.load(), 2);
+}
+
+TEST_CASE(InvalidationAndIdleDropThePass) {
+    Harness harness;
+    harness.middleware.SetVerificationCache(10000, true, 40);
+
+    CHECK(harness.press(KEY_S));
+    harness.middleware.InvalidateVerification();
+    CHECK(harness.press(KEY_S));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    CHECK(harness.press(KEY_S));
+    CHECK_EQ(harness.challenges.load(), 3);
+
+    // Disabling the cache forgets passes too
+    harness.middleware.SetVerificationCache(0, true, 0);
+    CHECK(harness.press(KEY_S));
+    CHECK_EQ(harness.challenges.load(), 4);
+}
+
+TEST_CASE(FluentPassesShortenTheChallenge) {
+    Harness harness;
+    CHECK(!harness.middleware.SetAdaptiveLength(4, 2, 8));
+    CHECK(harness.middleware.SetAdaptiveLength(2, 5, 8));
+
+    CHECK(harness.press(KEY_S));
+    CHECK_EQ(harness.lastLength.load(), 3);
+    CHECK(harness.press(KEY_D));
+    CHECK_EQ(harness.lastLength.load(), 2);
+    CHECK(harness.press(KEY_S));
+    CHECK_EQ(harness.lastLength.load(), 2);
+
+    CHECK(harness.middleware.SetAdaptiveLength(0, 0, 0));
+    CHECK(harness.press(KEY_S));
+    CHECK_EQ(harness.lastLength.load(), 3);
+}
+
+TEST_CASE(HeldModifierPreArmsTheChord) {
+    Harness harness;
+    harness.middleware.SetSpeculation(10000);
+    harness.middleware.RegisterTrigger({ { KEY_K, TriggerMatcher::MOD_CTRL } }, 0, 3);
+
+    harness.modifier(KeyCodes::LCONTROL, true);
+    CHECK(harness.waitForChallenges(1));
+    CHECK(harness.press(KEY_K));
+    harness.modifier(KeyCodes::LCONTROL, false);
+    CHECK_EQ(harness.challenges.load(), 1);
+}
+
+TEST_CASE(ReleasedModifierCancelsThePreArm) {
+    Harness harness;
+    harness.middleware.SetSpeculation(10000);
+    harness.middleware.RegisterTrigger({ { KEY_K, TriggerMatcher::MOD_CTRL } }, 0, 3);
+
+    harness.modifier(KeyCodes::LCONTROL, true);
+    CHECK(harness.waitForChallenges(1));
+    harness.modifier(KeyCodes::LCONTROL, false);
+
+    harness.modifier(KeyCodes::LCONTROL, true);
+    CHECK(harness.press(KEY_K));
+    harness.modifier(KeyCodes::LCONTROL, false);
+    // Either a fresh pre-arm or the trigger's own round, never the old one
+    CHECK_EQ(harness.challenges.load(), 2);
+}
+
+TEST_CASE(ShorterPreArmDoesNotAnswerALongerTrigger) {
+    Harness harness;
+    harness.middleware.SetSpeculation(10000);
+    harness.middleware.RegisterTrigger({ { KEY_K, TriggerMatcher::MOD_CTRL } }, 0, 2);
+
+    harness.modifier(KeyCodes::LCONTROL, true);
+    CHECK(harness.waitForChallenges(1));
+    CHECK(harness.press(KEY_S));
+    harness.modifier(KeyCodes::LCONTROL, false);
+    CHECK_EQ(harness.challenges.load(), 2);
+    CHECK_EQ(harness.lastLength.load(), 3);
+}
+
+TEST_CASE(FocusIntoScopePreArms) {
+    Harness harness;
+    harness.middleware.SetSpeculation(10000);
+    harness.middleware.AddProcessScope("editor.exe");
+    harness.middleware.UpdateForeground("shell.exe", "Shell");
+    CHECK(!harness.press(KEY_S));
+
+    harness.middleware.UpdateForeground("editor.exe", "Edit");
+    CHECK(harness.waitForChallenges(1));
+    CHECK(harness.press(KEY_S));
+    CHECK_EQ(harness.challenges.load(), 1);
+}
+
+TEST_CASE(AppliedConfigReplacesEveryTrigger) {
+    Harness harness;
+    CHECK(harness.middleware.RegisterTriggers({ { { { KEY_K, TriggerMatcher::MOD_ANY } }, 0, 3 } }));
+    CHECK(harness.press(KEY_K));
+    CHECK(harness.press(KEY_S));
+
+    KeyboardMiddleware::Config config;
+    config.triggers.push_back({ { { KEY_D, TriggerMatcher::MOD_ANY } }, 0, 4 });
+    CHECK(harness.middleware.ApplyConfig(config));
+    CHECK(!harness.press(KEY_S));
+    CHECK(!harness.press(KEY_K));
+    CHECK(harness.press(KEY_D));
+    CHECK_EQ(harness.lastLength.load(), 4);
+
+    // A bad trigger leaves the applied set untouched
+    config.triggers.push_back({ { { 0, TriggerMatcher::MOD_ANY } }, 0, 3 });
+    CHECK(!harness.middleware.ApplyConfig(config));
+    CHECK(!harness.middleware.RegisterTriggers(config.triggers));
+    CHECK(harness.press(KEY_D));
+    CHECK(!harness.press(KEY_S));
+}
+
+TEST_CASE(ConfigCanBeReplacedWhileKeysArrive) {
+    KeyboardMiddleware middleware;
+    KeyboardMiddleware::Config config;
+    config.triggers.push_back({ { { KEY_D, TriggerMatcher::MOD_ANY } }, 0, 4 });
+
+    // Keys that never trigger, so the matcher is read on every event
+    std::atomic<bool> typing(true);
+    std::thread keys([&middleware, &typing]() {
+        for (uint32_t time = 0; typing; time++) {
+            middleware.ProcessKeyEvent(KeyEvent{ KEY_K, 0, time, (time & 1) != 0, false });
+        }
+    });
+    for (int i = 0; i < 200; i++) {
+        CHECK(middleware.ApplyConfig(config));
+    }
+    typing = false;
+    keys.join();
+    middleware.Cleanup();
+}
+
+TEST_CASE(EventLoopRunsChallengesOnTheCallersThread) {
+    EventLoop loop;
+    KeyboardMiddleware middleware;
+    middleware.SetEventLoop(&loop);
+    middleware.SetSpeculation(10000);
+
+    int rounds = 0;
+    int released = 0;
+    bool offThread = false;
+    std::thread::id caller = std::this_thread::get_id();
+    middleware.SetKeyInjector([&](const std::vector<KeyEvent>&) {
+        released++;
+        offThread = offThread || std::this_thread::get_id() != caller;
+    });
+    middleware.SetKeyBuffering(true);
+    middleware.RegisterAsyncHardware([&](int, std::function<void(bool)> done) {
+        rounds++;
+        offThread = offThread || std::this_thread::get_id() != caller;
+        loop.addTimer(EventLoop::Clock::now() + std::chrono::milliseconds(20), [done]() { done(true); });
+    });
+    middleware.RegisterTrigger({ { KEY_K, TriggerMatcher::MOD_CTRL } }, 0, 3);
+
+    // The trigger claims the pre-armed round while it is still on the device
+    uint32_t time = 1000;
+    middleware.ProcessKeyEvent(KeyEvent{ KeyCodes::LCONTROL, 0, time++, false, false });
+    CHECK(middleware.ProcessKeyEvent(KeyEvent{ KEY_K, 0, time++, false, false }));
+    CHECK(middleware.ProcessKeyEvent(KeyEvent{ KEY_K, 0, time++, true, false }));
+
+    auto deadline = EventLoop::Clock::now() + std::chrono::seconds(5);
+    while (released == 0 && EventLoop::Clock::now() < deadline) {
+        loop.runOnce(loop.nextDeadline());
+    }
+    CHECK_EQ(released, 1);
+    CHECK_EQ(rounds, 1);
+    CHECK(!offThread);
+    middleware.Cleanup();
+}
+
+TEST_CASE(ReplacedCallbacksAreFreedOnceNoChallengeRuns) {
+    KeyboardMiddleware middleware;
+    middleware.RegisterKey(KEY_S, 3);
+
+    // Freed at once while idle
+    auto idle = std::make_shared<int>(0);
+    std::weak_ptr<int> idleWatch = idle;
+    middleware.RegisterHardwareCallbacks([idle](int) {}, []() { return true; });
+    idle.reset();
+    middleware.RegisterHardwareCallbacks([](int) {}, []() { return true; });
+    CHECK(idleWatch.expired());
+
+    // Kept while a challenge is still inside them
+    std::atomic<bool> inside(false);
+    std::atomic<bool> finish(false);
+    auto busy = std::make_shared<int>(0);
+    std::weak_ptr<int> busyWatch = busy;
+    middleware.RegisterHardwareCallbacks([busy](int) {}, [&inside, &finish]() {
+        inside = true;
+        while (!finish) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    });
+    busy.reset();
+    REQUIRE(middleware.ProcessKeyEvent(KeyEvent{ KEY_S, 0, 1, false, false }));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!inside && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    middleware.RegisterHardwareCallbacks([](int) {}, []() { return true; });
+    CHECK(!busyWatch.expired());
+
+    finish = true;
+    while (!busyWatch.expired() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(busyWatch.expired());
+    middleware.Cleanup();
+}
+
+TEST_CASE(TriggersAreArmedAgainBeforeTheReplay) {
+    std::atomic<bool> finish(false);
+    std::atomic<int> blockedDuringReplay(-1);
+    KeyboardMiddleware middleware;
+    middleware.SetKeyInjector([&middleware, &blockedDuringReplay](const std::vector<KeyEvent>&) {
+        blockedDuringReplay = middleware.IsBlocking() ? 1 : 0;
+    });
+    REQUIRE(middleware.SetKeyBuffering(true));
+    middleware.RegisterHardwareCallbacks([](int) {}, [&finish]() {
+        while (!finish) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    });
+    middleware.RegisterKey(KEY_S, 3);
+
+    CHECK(middleware.ProcessKeyEvent(KeyEvent{ KEY_S, 0, 1, false, false }));
+    CHECK(middleware.ProcessKeyEvent(KeyEvent{ KEY_K, 0, 2, false, false }));
+    finish = true;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (blockedDuringReplay < 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK_EQ(blockedDuringReplay.load(), 0);
+    middleware.Cleanup();
+}
+
+TEST_CASE(TriggersTypedDuringAChallengeAreNotReplayed) {
+    std::atomic<bool> finish(false);
+    std::atomic<int> challenges(0);
+    std::mutex replayedMutex;
+    std::vector<KeyEvent> replayed;
+    KeyboardMiddleware middleware;
+    middleware.SetKeyInjector([&replayedMutex, &replayed](const std::vector<KeyEvent>& events) {
+        std::lock_guard<std::mutex> lock(replayedMutex);
+        replayed.insert(replayed.end(), events.begin(), events.end());
+    });
+    REQUIRE(middleware.SetKeyBuffering(true));
+    middleware.RegisterHardwareCallbacks([&challenges](int) { challenges++; }, [&finish]() {
+        while (!finish) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    });
+    middleware.RegisterKey(KEY_S, 3);
+    middleware.RegisterKey(KEY_D, 8);
+
+    CHECK(middleware.ProcessKeyEvent(KeyEvent{ KEY_S, 0, 1, false, false }));
+    CHECK(middleware.ProcessKeyEvent(KeyEvent{ KEY_K, 0, 2, false, false }));
+    CHECK(middleware.ProcessKeyEvent(KeyEvent{ KEY_D, 0, 3, false, false }));
+    finish = true;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!middleware.Rearm() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    middleware.Cleanup();
+
+    // The passed S challenge releases S and K, but D has to be pressed again
+    std::lock_guard<std::mutex> lock(replayedMutex);
+    CHECK_EQ(replayed.size(), 2u);
+    for (const KeyEvent& event : replayed) {
+        CHECK(event.vkCode != KEY_D);
+    }
+    CHECK_EQ(challenges.load(), 1);
+}
+
+TEST_CASE(RearmLiftsTheBlockAfterAFailure) {
+    std::atomic<bool> finish(false);
+    std::atomic<int> challenges(0);
+    KeyboardMiddleware middleware;
+    middleware.RegisterHardwareCallbacks([&challenges](int) { challenges++; }, [&finish]() {
+        while (!finish) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return false;
+    });
+    middleware.RegisterKey(KEY_S, 3);
+
+    CHECK(middleware.ProcessKeyEvent(KeyEvent{ KEY_S, 0, 1, false, false }));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (challenges == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(!middleware.Rearm());
+    CHECK(middleware.IsBlocking());
+
+    finish = true;
+    while (!middleware.Rearm() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(!middleware.IsBlocking());
+    CHECK(middleware.ProcessKeyEvent(KeyEvent{ KEY_S, 0, 2, false, false }));
+    while (challenges < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK_EQ(challenges.load(), 2);
+    middleware.Cleanup();
+}
+
+TEST_CASE(BufferingNeedsAKeyInjectorOffWindows) {
+    std::atomic<bool> finish(false);
+    KeyboardMiddleware middleware;
+    middleware.RegisterHardwareCallbacks([](int) {}, [&finish]() {
+        while (!finish) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    });
+    middleware.RegisterKey(KEY_S, 3);
+
+    // With nothing to replay them through, keys typed behind a trigger go
+    // straight to the application instead of being held and lost
+    auto challenge = [&middleware, &finish](uint32_t time) {
+        finish = false;
+        CHECK(middleware.ProcessKeyEvent(KeyEvent{ KEY_S, 0, time, false, false }));
+        bool held = middleware.ProcessKeyEvent(KeyEvent{ KEY_K, 0, time + 1, false, false });
+        finish = true;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (middleware.IsBlocking() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return held;
+    };
+    CHECK(!middleware.SetKeyBuffering(true));
+    CHECK(!challenge(10));
+
+    middleware.SetKeyInjector([](const std::vector<KeyEvent>&) {});
+    CHECK(middleware.SetKeyBuffering(true));
+    CHECK(challenge(20));
+
+    // Removing the injector takes buffering with it
+    middleware.SetKeyInjector(nullptr);
+    CHECK(!challenge(30));
+    middleware.Cleanup();
+}
+
+TEST_CASE(CApiRejectsOutOfRangeKeyCodes) {
+    keyboard_middleware_t handle = km_create();
+    REQUIRE(handle != nullptr);
+    REQUIRE(km_initialize(handle) == SIMON_SUCCESS);
+
+    // 0x153 would wrap to 'S' if it were cast unchecked
+    simon_clear_error();
+    CHECK(km_register_key(handle, 0x153, 3) == SIMON_ERROR_INVALID_PARAMETER);
+    simon_error_info_t error = simon_last_error();
+    CHECK(error.code == SIMON_ERROR_INVALID_PARAMETER);
+    CHECK(std::string(error.message) == "key_code out of range");
+    CHECK(km_register_key(handle, 0, 3) == SIMON_ERROR_INVALID_PARAMETER);
+    CHECK(km_register_key(handle, -1, 3) == SIMON_ERROR_INVALID_PARAMETER);
+    CHECK(km_register_key(handle, KEY_S, 3) == SIMON_SUCCESS);
+    CHECK(km_register_key(handle, 0xFF, 3) == SIMON_SUCCESS);
+
+    km_cleanup(handle);
+    km_destroy(handle);
+}
+
+TEST_MAIN()
@@ -0,0 +1,64 @@
+#include "LatencyHistogram.hpp"
+#include "TestSupport.hpp"
+#include <cstdint>
+
+TEST_CASE(SmallValuesAreExact) {
+    LatencyHistogram histogram;
+    for (uint64_t v = 1; v <= 100; v++) {
+        histogram.record(v);
+    }
+    CHECK_EQ(histogram.count(), 100u);
+    CHECK_EQ(histogram.min(), 1u);
+    CHECK_EQ(histogram.max(), 100u);
+    CHECK_EQ(histogram.percentile(0.5), 50u);
+    CHECK_EQ(histogram.percentile(0.99), 99u);
+    CHECK_EQ(histogram.percentile(1.0), 100u);
+    CHECK(histogram.mean() == 50.5);
+}
+
+TEST_CASE(LargeValuesStayWithinBucketPrecision) {
+    for (uint64_t v = 128; v < (1ull << 40); v = v * 3 + 7) {
+        size_t index = LatencyHistogram::bucketIndex(v);
+        REQUIRE(index < LatencyHistogram::BUCKET_COUNT);
+        uint64_t upper = LatencyHistogram::bucketUpperBound(index);
+        CHECK(upper >= v);
+        CHECK(upper - v <= v / 64);
+        CHECK_EQ(LatencyHistogram::bucketIndex(upper), index);
+        CHECK_EQ(LatencyHistogram::bucketIndex(upper + 1), index + 1);
+    }
+    CHECK_EQ(LatencyHistogram::bucketIndex(UINT64_MAX), LatencyHistogram::BUCKET_COUNT - 1);
+    CHECK_EQ(LatencyHistogram::bucketUpperBound(LatencyHistogram::BUCKET_COUNT - 1), UINT64_MAX);
+}
+
+TEST_CASE(TailPercentilesSeeOutliers) {
+    LatencyHistogram histogram;
+    for (int i = 0; i < 9990; i++) {
+        histogram.record(20000);
+    }
+    for (int i = 0; i < 10; i++) {
+        histogram.record(5000000);
+    }
+    CHECK(histogram.percentile(0.99) < 20400);
+    CHECK(histogram.percentile(0.999) < 20400);
+    CHECK(histogram.percentile(0.9995) >= 5000000);
+    CHECK_EQ(histogram.percentile(1.0), 5000000u);
+}
+
+TEST_CASE(MergeAndReset) {
+    LatencyHistogram a;
+    LatencyHistogram b;
+    a.record(10);
+    b.record(1000);
+    b.record(3);
+    a.merge(b);
+    CHECK_EQ(a.count(), 3u);
+    CHECK_EQ(a.min(), 3u);
+    CHECK_EQ(a.max(), 1000u);
+
+    a.reset();
+    CHECK_EQ(a.count(), 0u);
+    CHECK_EQ(a.percentile(0.5), 0u);
+    CHECK_EQ(a.min(), 0u);
+}
+
+TEST_MAIN()
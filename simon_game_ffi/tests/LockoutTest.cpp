@@ -0,0 +1,245 @@
+#include "Lockout.hpp"
+#include "EventLoop.hpp"
+#include "ScreenLock.hpp"
+#include "middleWhere.hpp"
+#include "TestSupport.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+
+namespace {
+    const uint16_t KEY_S = 0x53;
+    const uint16_t KEY_D = 0x44;
+    const int64_t T0 = 1700000000000;   // any wall-clock time
+
+    Lockout::Policy quickPolicy() {
+        Lockout::Policy policy;
+        policy.keyThreshold = 2;
+        policy.deviceThreshold = 3;
+        policy.windowMs = 8000;
+        policy.decayMs = 60000;
+        policy.stepsMs = { 1000, 5000, 30000 };
+        return policy;
+    }
+
+    // Threads in this process, or -1 where that cannot be counted
+    int threadCount() {
+#ifdef __linux__
+        std::error_code error;
+        int count = 0;
+        for (std::filesystem::directory_iterator it("/proc/self/task", error), end; !error && it != end; it.increment(error)) {
+            count++;
+        }
+        return error ? -1 : count;
+#else
+        return -1;
+#endif
+    }
+
+    std::string statePath(const char* name) {
+        return (std::filesystem::temp_directory_path() / name).string();
+    }
+
+    // Records how long each lock was asked for, without touching input
+    struct RecordingBackend : ScreenLock::Backend {
+        std::atomic<int>* engaged;
+        explicit RecordingBackend(std::atomic<int>* engaged) : engaged(engaged) {}
+        bool engage() override { (*engaged)++; return true; }
+        void release() override {}
+    };
+}
+
+TEST_CASE(DisabledLockoutNeverLocks) {
+    Lockout lockout;
+    for (int i = 0; i < 10; i++) {
+        CHECK_EQ(lockout.recordFailure(KEY_S, T0 + i), 0u);
+    }
+    CHECK_EQ(lockout.remainingMs(T0), 0);
+}
+
+TEST_CASE(RejectsInvalidPolicies) {
+    Lockout lockout;
+    Lockout::Policy policy = quickPolicy();
+    policy.stepsMs.clear();
+    CHECK(!lockout.configure(policy));
+    policy = quickPolicy();
+    policy.windowMs = 0;
+    CHECK(!lockout.configure(policy));
+    policy = quickPolicy();
+    policy.keyThreshold = 0;
+    policy.deviceThreshold = 0;
+    CHECK(!lockout.configure(policy));
+    CHECK(!lockout.isEnabled());
+    CHECK(lockout.configure(quickPolicy()));
+}
+
+TEST_CASE(RepeatedKeyFailuresEscalate) {
+    Lockout lockout;
+    Lockout::Policy policy = quickPolicy();
+    policy.deviceThreshold = 0;
+    REQUIRE(lockout.configure(policy));
+
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0), 0u);
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0 + 100), 1000u);
+    CHECK_EQ(lockout.remainingMs(T0 + 600), 500);
+    CHECK_EQ(lockout.keyStep(KEY_S, T0 + 100), 1);
+
+    // The window starts over after a lockout; the next one is a step up
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0 + 2000), 0u);
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0 + 2100), 5000u);
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0 + 9000), 0u);
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0 + 9100), 30000u);
+
+    // The top step repeats
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0 + 40000), 0u);
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0 + 40100), 30000u);
+}
+
+TEST_CASE(FailuresOutsideTheWindowAreForgotten) {
+    Lockout lockout;
+    REQUIRE(lockout.configure(quickPolicy()));
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0), 0u);
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0 + 20000), 0u);
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0 + 40000), 0u);
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0 + 40100), 1000u);
+}
+
+TEST_CASE(DeviceCountsFailuresAcrossKeys) {
+    Lockout lockout;
+    REQUIRE(lockout.configure(quickPolicy()));
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0), 0u);
+    CHECK_EQ(lockout.recordFailure(KEY_D, T0 + 100), 0u);
+    CHECK_EQ(lockout.recordFailure(0x41, T0 + 200), 1000u);
+    CHECK_EQ(lockout.deviceStep(T0 + 200), 1);
+    CHECK_EQ(lockout.keyStep(KEY_S, T0 + 200), 0);
+}
+
+TEST_CASE(QuietPeriodsStepBackDown) {
+    Lockout lockout;
+    REQUIRE(lockout.configure(quickPolicy()));
+    lockout.recordFailure(KEY_S, T0);
+    lockout.recordFailure(KEY_S, T0 + 1);
+    lockout.recordFailure(KEY_S, T0 + 2000);
+    lockout.recordFailure(KEY_S, T0 + 2001);
+    CHECK_EQ(lockout.keyStep(KEY_S, T0 + 2001), 2);
+    CHECK_EQ(lockout.keyStep(KEY_S, T0 + 2001 + 60000), 1);
+    CHECK_EQ(lockout.keyStep(KEY_S, T0 + 2001 + 600000), 0);
+
+    lockout.recordFailure(KEY_S, T0 + 70000);
+    CHECK_EQ(lockout.recordFailure(KEY_S, T0 + 70001), 5000u);
+}
+
+TEST_CASE(StateSurvivesARestart) {
+    std::string path = statePath("simon_lockout_test.state");
+    {
+        Lockout lockout;
+        REQUIRE(lockout.configure(quickPolicy()));
+        lockout.recordFailure(KEY_S, T0);
+        lockout.recordFailure(KEY_S, T0 + 100);
+        // The third failure also locks the device, until T0 + 1200
+        lockout.recordFailure(KEY_D, T0 + 200);
+        REQUIRE(lockout.save(path));
+    }
+
+    Lockout restored;
+    REQUIRE(restored.configure(quickPolicy()));
+    REQUIRE(restored.load(path));
+    CHECK_EQ(restored.remainingMs(T0 + 600), 600);
+    CHECK_EQ(restored.deviceStep(T0 + 1000), 1);
+    CHECK_EQ(restored.keyStep(KEY_S, T0 + 1000), 1);
+    // KEY_D's pending failure came back too
+    CHECK_EQ(restored.recordFailure(KEY_D, T0 + 1500), 1000u);
+
+    std::remove(path.c_str());
+    Lockout fresh;
+    REQUIRE(fresh.configure(quickPolicy()));
+    CHECK(!fresh.load(path));
+    CHECK_EQ(fresh.keyStep(KEY_S, T0), 0);
+}
+
+TEST_CASE(MiddlewareLocksInputAfterRepeatedFailures) {
+    std::string path = statePath("simon_lockout_middleware.state");
+    std::remove(path.c_str());
+
+    std::atomic<int> engaged(0);
+    auto lock = std::make_shared<ScreenLock>(std::unique_ptr<ScreenLock::Backend>(new RecordingBackend(&engaged)));
+
+    std::atomic<int> challenges(0);
+    KeyboardMiddleware middleware;
+    middleware.RegisterHardwareCallbacks([&challenges](int) { challenges++; }, []() { return false; });
+    middleware.RegisterKey(KEY_S, 3);
+    REQUIRE(middleware.SetLockout(quickPolicy(), path, lock));
+
+    // The state file is written once the first failure has been counted
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    middleware.ProcessKeyEvent(KeyEvent{ KEY_S, 0, 1, false, false });
+    middleware.ProcessKeyEvent(KeyEvent{ KEY_S, 0, 2, true, false });
+    while (!std::filesystem::exists(path) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK_EQ(engaged.load(), 0);
+
+    middleware.ProcessKeyEvent(KeyEvent{ KEY_S, 0, 3, false, false });
+    middleware.ProcessKeyEvent(KeyEvent{ KEY_S, 0, 4, true, false });
+    while (engaged == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK_EQ(challenges.load(), 2);
+    middleware.Cleanup();
+
+    CHECK_EQ(engaged.load(), 1);
+    CHECK(lock->isLocked());
+    lock->end();
+
+    // A new instance picks the running lockout up from the saved state
+    std::atomic<int> resumed(0);
+    auto secondLock = std::make_shared<ScreenLock>(std::unique_ptr<ScreenLock::Backend>(new RecordingBackend(&resumed)));
+    KeyboardMiddleware restarted;
+    REQUIRE(restarted.SetLockout(quickPolicy(), path, secondLock));
+    CHECK_EQ(resumed.load(), 1);
+    restarted.DisableLockout();
+    CHECK(secondLock->waitUntil(std::chrono::steady_clock::now() + std::chrono::seconds(5)));
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE(ReactorModeLockoutRunsOnTheLoop) {
+    EventLoop loop;
+    std::atomic<int> engaged(0);
+    auto lock = std::make_shared<ScreenLock>(std::unique_ptr<ScreenLock::Backend>(new RecordingBackend(&engaged)), &loop);
+
+    int challenges = 0;
+    KeyboardMiddleware middleware;
+    middleware.SetEventLoop(&loop);
+    middleware.RegisterHardwareCallbacks([&challenges](int) { challenges++; }, []() { return false; });
+    middleware.RegisterKey(KEY_S, 3);
+    Lockout::Policy policy = quickPolicy();
+    policy.stepsMs = { 50 };
+    REQUIRE(middleware.SetLockout(policy, "", lock));
+
+    int threadsBefore = threadCount();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    for (uint32_t time = 1; time <= 4; time += 2) {
+        CHECK(middleware.ProcessKeyEvent(KeyEvent{ KEY_S, 0, time, false, false }));
+        middleware.ProcessKeyEvent(KeyEvent{ KEY_S, 0, time + 1, true, false });
+        int expected = static_cast<int>(time / 2) + 1;
+        while ((challenges < expected || middleware.IsBlocking()) && std::chrono::steady_clock::now() < deadline) {
+            loop.runOnce(std::chrono::steady_clock::now() + std::chrono::milliseconds(10));
+        }
+    }
+    CHECK_EQ(challenges, 2);
+    CHECK_EQ(engaged.load(), 1);
+    CHECK(lock->isLocked());
+    CHECK_EQ(threadCount(), threadsBefore);
+
+    // Released by the loop's timer once the step has passed
+    while (lock->isLocked() && std::chrono::steady_clock::now() < deadline) {
+        loop.runOnce(std::chrono::steady_clock::now() + std::chrono::milliseconds(10));
+    }
+    CHECK(!lock->isLocked());
+    middleware.Cleanup();
+}
+
+TEST_MAIN()
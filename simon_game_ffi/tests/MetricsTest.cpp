@@ -0,0 +1,128 @@
+#include "Metrics.hpp"
+#include "simon_game.h"
+#include "TestSupport.hpp"
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    bool contains(const std::string& text, const std::string& part) {
+        return text.find(part) != std::string::npos;
+    }
+
+    std::string fetch(const std::string& socketPath) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        socketPath.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return "";
+        }
+
+        std::string request = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        send(fd, request.data(), request.size(), 0);
+        std::string response;
+        char buffer[4096];
+        ssize_t n;
+        while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            response.append(buffer, static_cast<size_t>(n));
+        }
+        close(fd);
+        return response;
+    }
+}
+
+TEST_CASE(CountersSumAcrossThreads) {
+    Metrics::Counter& counter = Metrics::counter("test_events_total", "Events seen by the test");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&counter]() {
+            for (int i = 0; i < 10000; i++) {
+                counter.inc();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    CHECK_EQ(counter.value(), 80000u);
+    CHECK(&Metrics::counter("test_events_total", "ignored") == &counter);
+}
+
+TEST_CASE(DumpsPrometheusText) {
+    Metrics::gauge("test_depth", "Queue depth").set(-3);
+    Metrics::counter("test_results_total{result=\"ok\"}", "Results by outcome").inc(2);
+    Metrics::counter("test_results_total{result=\"error\"}", "Results by outcome").inc();
+    Metrics::Histogram& histogram = Metrics::histogram("test_wait_seconds", "Wait time", {0.1, 1});
+    histogram.observe(0.05);
+    histogram.observe(0.5);
+    histogram.observe(5);
+
+    std::string text = Metrics::dump();
+    CHECK(contains(text, "# TYPE test_depth gauge\ntest_depth -3\n"));
+    CHECK(contains(text, "# HELP test_results_total Results by outcome\n# TYPE test_results_total counter\n"
+                         "test_results_total{result=\"error\"} 1\ntest_results_total{result=\"ok\"} 2\n"));
+    CHECK(contains(text, "# TYPE test_wait_seconds histogram\n"
+                         "test_wait_seconds_bucket{le=\"0.1\"} 1\n"
+                         "test_wait_seconds_bucket{le=\"1\"} 2\n"
+                         "test_wait_seconds_bucket{le=\"+Inf\"} 3\n"
+                         "test_wait_seconds_sum 5.55\n"
+                         "test_wait_seconds_count 3\n"));
+}
+
+TEST_CASE(RejectsConflictingRegistrations) {
+    Metrics::counter("test_conflict", "A counter");
+    bool threw = false;
+    try {
+        Metrics::gauge("test_conflict{kind=\"x\"}", "Not a counter");
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    threw = false;
+    try {
+        Metrics::counter("9starts_with_digit", "Bad name");
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+TEST_CASE(CApiDumpSizesAndTruncates) {
+    Metrics::counter("test_capi_total", "Counted through the C API test").inc();
+    size_t length = simon_metrics_dump(nullptr, 0);
+    REQUIRE(length > 0);
+
+    std::vector<char> full(length + 1);
+    CHECK_EQ(simon_metrics_dump(full.data(), full.size()), length);
+    CHECK(contains(full.data(), "test_capi_total 1"));
+
+    char small[8];
+    CHECK_EQ(simon_metrics_dump(small, sizeof(small)), length);
+    CHECK_EQ(std::string(small).size(), 7u);
+}
+
+TEST_CASE(ServesOverUnixSocket) {
+    std::string path = "/tmp/simon_metrics_test_" + std::to_string(getpid()) + ".sock";
+    REQUIRE(simon_metrics_serve(("unix:" + path).c_str()) == SIMON_SUCCESS);
+    CHECK(simon_metrics_serve(("unix:" + path).c_str()) != SIMON_SUCCESS);
+
+    Metrics::counter("test_scraped_total", "Seen by the scrape test").inc(7);
+    std::string response = fetch(path);
+    CHECK(contains(response, "HTTP/1.1 200 OK\r\n"));
+    CHECK(contains(response, "test_scraped_total 7\n"));
+
+    CHECK(simon_metrics_stop_serving() == SIMON_SUCCESS);
+    CHECK(access(path.c_str(), F_OK) != 0);
+    CHECK(simon_metrics_serve("no-port-here") != SIMON_SUCCESS);
+}
+
+TEST_MAIN()
@@ -0,0 +1,248 @@
+#include "ScreenLock.hpp"
+#include "EventLoop.hpp"
+#include "middleWhere.hpp"
+#include "TestSupport.hpp"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    using Clock = ScreenLock::Clock;
+
+    // Counts what the lock asks of it instead of touching real input
+    struct FakeBackend : ScreenLock::Backend {
+        std::atomic<int>* engaged;
+        std::atomic<int>* released;
+        bool fail;
+
+        FakeBackend(std::atomic<int>* engaged, std::atomic<int>* released, bool fail = false)
+            : engaged(engaged), released(released), fail(fail) {}
+
+        bool engage() override {
+            if (fail) {
+                return false;
+            }
+            (*engaged)++;
+            return true;
+        }
+
+        void release() override {
+            (*released)++;
+        }
+    };
+
+    std::unique_ptr<ScreenLock::Backend> fake(std::atomic<int>& engaged, std::atomic<int>& released, bool fail = false) {
+        return std::unique_ptr<ScreenLock::Backend>(new FakeBackend(&engaged, &released, fail));
+    }
+
+    Clock::time_point in(int ms) {
+        return Clock::now() + std::chrono::milliseconds(ms);
+    }
+}
+
+TEST_CASE(LockExpiresOnItsOwn) {
+    std::atomic<int> engaged(0), released(0);
+    ScreenLock lock(fake(engaged, released));
+
+    Clock::time_point start = Clock::now();
+    REQUIRE(lock.begin(std::chrono::milliseconds(30)));
+    CHECK(lock.isLocked());
+    CHECK_EQ(engaged.load(), 1);
+
+    CHECK(lock.waitUntil(in(5000)));
+    CHECK(Clock::now() - start >= std::chrono::milliseconds(30));
+    CHECK(!lock.isLocked());
+    CHECK_EQ(released.load(), 1);
+}
+
+TEST_CASE(EndReleasesEarly) {
+    std::atomic<int> engaged(0), released(0);
+    ScreenLock lock(fake(engaged, released));
+    REQUIRE(lock.begin(std::chrono::seconds(30)));
+
+    // Still held when the wait times out
+    CHECK(!lock.waitUntil(in(10)));
+
+    Clock::time_point start = Clock::now();
+    std::thread other([&lock]() { lock.end(); });
+    CHECK(lock.waitUntil(in(5000)));
+    other.join();
+    CHECK(Clock::now() - start < std::chrono::seconds(5));
+    CHECK_EQ(released.load(), 1);
+
+    lock.end();
+    CHECK_EQ(released.load(), 1);
+}
+
+TEST_CASE(BeginExtendsAHeldLock) {
+    std::atomic<int> engaged(0), released(0);
+    ScreenLock lock(fake(engaged, released));
+    REQUIRE(lock.begin(std::chrono::milliseconds(20)));
+    REQUIRE(lock.begin(std::chrono::milliseconds(300)));
+    CHECK_EQ(engaged.load(), 1);
+
+    CHECK(!lock.waitUntil(in(100)));
+    CHECK(lock.waitUntil(in(5000)));
+
+    // A finished lock can be taken again
+    REQUIRE(lock.begin(std::chrono::milliseconds(10)));
+    CHECK(lock.waitUntil(in(5000)));
+    CHECK_EQ(engaged.load(), 2);
+    CHECK_EQ(released.load(), 2);
+}
+
+TEST_CASE(FailedEngageHoldsNothing) {
+    std::atomic<int> engaged(0), released(0);
+    ScreenLock lock(fake(engaged, released, true));
+    CHECK(!lock.begin(std::chrono::seconds(30)));
+    CHECK(!lock.isLocked());
+    CHECK(lock.waitUntil(Clock::now()));
+    CHECK_EQ(released.load(), 0);
+}
+
+TEST_CASE(DestroyingReleasesInput) {
+    std::atomic<int> engaged(0), released(0);
+    {
+        ScreenLock lock(fake(engaged, released));
+        REQUIRE(lock.begin(std::chrono::seconds(30)));
+    }
+    CHECK_EQ(released.load(), 1);
+}
+
+TEST_CASE(LoopLockIsReleasedByTheLoop) {
+    std::atomic<int> engaged(0), released(0);
+    EventLoop loop;
+    ScreenLock lock(fake(engaged, released), &loop);
+
+    REQUIRE(lock.begin(std::chrono::milliseconds(20)));
+    REQUIRE(lock.begin(std::chrono::milliseconds(60)));
+    CHECK_EQ(engaged.load(), 1);
+
+    // No thread of its own: the expiry passes unnoticed until the loop runs
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    CHECK(lock.isLocked());
+    loop.runOnce(in(5000));
+    CHECK(!lock.isLocked());
+    CHECK_EQ(released.load(), 1);
+
+    // end() from another thread is carried out by the loop
+    REQUIRE(lock.begin(std::chrono::seconds(30)));
+    std::thread other([&lock]() { lock.end(); });
+    other.join();
+    CHECK(lock.isLocked());
+    loop.runOnce(in(5000));
+    CHECK(!lock.isLocked());
+    CHECK_EQ(released.load(), 2);
+
+    // An expiry pushed out is waited for again
+    Clock::time_point start = Clock::now();
+    REQUIRE(lock.begin(std::chrono::milliseconds(10)));
+    REQUIRE(lock.begin(std::chrono::milliseconds(100)));
+    while (lock.isLocked() && Clock::now() < start + std::chrono::seconds(5)) {
+        loop.runOnce(in(5000));
+    }
+    CHECK(Clock::now() - start >= std::chrono::milliseconds(100));
+    CHECK_EQ(released.load(), 3);
+}
+
+TEST_CASE(DestroyingALoopLockReleasesInput) {
+    std::atomic<int> engaged(0), released(0);
+    EventLoop loop;
+    {
+        ScreenLock lock(fake(engaged, released), &loop);
+        REQUIRE(lock.begin(std::chrono::seconds(30)));
+        lock.end();
+    }
+    CHECK_EQ(released.load(), 1);
+    // The end() posted before destruction finds nothing left to release
+    loop.runOnce(Clock::now());
+    CHECK_EQ(released.load(), 1);
+}
+
+TEST_CASE(PassedChallengeEndsTheLock) {
+    std::atomic<int> engaged(0), released(0);
+    auto lock = std::make_shared<ScreenLock>(fake(engaged, released));
+
+    KeyboardMiddleware middleware;
+    middleware.RegisterHardwareCallbacks([](int) {}, []() { return true; });
+    middleware.RegisterKey(0x53, 3);
+    middleware.AttachScreenLock(lock);
+
+    REQUIRE(lock->begin(std::chrono::seconds(30)));
+    CHECK(middleware.ProcessKeyEvent(KeyEvent{ 0x53, 0, 1, false, false }));
+    CHECK(lock->waitUntil(in(5000)));
+    CHECK_EQ(released.load(), 1);
+    middleware.Cleanup();
+}
+
+#ifdef __linux__
+TEST_CASE(EvdevBackendRejectsAMissingDevice) {
+    ScreenLock lock(ScreenLock::platformBackend({ "/dev/input/no-such-device" }));
+    CHECK(!lock.begin(std::chrono::seconds(30)));
+    CHECK(!lock.isLocked());
+}
+
+// The evdev backend against a uinput keyboard: while locked, nobody else
+// can grab the device. Needs /dev/uinput, so it passes vacuously without.
+TEST_CASE(EvdevBackendGrabsTheDevice) {
+    int uinput = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (uinput < 0) {
+        std::cout << "  skipped: /dev/uinput unavailable (" << std::strerror(errno) << ")" << std::endl;
+        return;
+    }
+
+    ioctl(uinput, UI_SET_EVBIT, EV_KEY);
+    ioctl(uinput, UI_SET_KEYBIT, KEY_A);
+    uinput_setup setup = {};
+    setup.id.bustype = BUS_VIRTUAL;
+    std::strncpy(setup.name, "simon screen lock test", UINPUT_MAX_NAME_SIZE - 1);
+    REQUIRE(ioctl(uinput, UI_DEV_SETUP, &setup) == 0);
+    REQUIRE(ioctl(uinput, UI_DEV_CREATE) == 0);
+
+    // The event node appears under the sysfs device once udev is done
+    char sysName[64] = {};
+    REQUIRE(ioctl(uinput, UI_GET_SYSNAME(sizeof(sysName)), sysName) >= 0);
+    std::string node;
+    for (int attempt = 0; attempt < 100 && node.empty(); attempt++) {
+        for (int n = 0; n < 64; n++) {
+            std::string path = "/sys/devices/virtual/input/" + std::string(sysName) + "/event" + std::to_string(n);
+            if (access(path.c_str(), F_OK) == 0 && access(("/dev/input/event" + std::to_string(n)).c_str(), R_OK) == 0) {
+                node = "/dev/input/event" + std::to_string(n);
+                break;
+            }
+        }
+        if (node.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    REQUIRE(!node.empty());
+
+    ScreenLock lock(ScreenLock::platformBackend({ node }));
+    REQUIRE(lock.begin(std::chrono::seconds(30)));
+
+    int probe = open(node.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    REQUIRE(probe >= 0);
+    CHECK(ioctl(probe, EVIOCGRAB, 1) < 0 && errno == EBUSY);
+
+    lock.end();
+    CHECK(lock.waitUntil(in(5000)));
+    CHECK(ioctl(probe, EVIOCGRAB, 1) == 0);
+    ioctl(probe, EVIOCGRAB, 0);
+    close(probe);
+
+    ioctl(uinput, UI_DEV_DESTROY);
+    close(uinput);
+}
+#endif
+
+TEST_MAIN()
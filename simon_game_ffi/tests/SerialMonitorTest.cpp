@@ -0,0 +1,192 @@
+#include "SerialMonitor.hpp"
+#include "SimonSimulator.hpp"
+#include "TestSupport.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <poll.h>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double elapsedMs(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
+
+TEST_CASE(PlaysChallengeOverPty) {
+    SimonSimulator board([](int) { return SimonSimulator::answer(true, 10); });
+    SerialMonitor monitor(board.path());
+    REQUIRE(monitor.connect());
+
+    REQUIRE(monitor.sendSimonGameLength(4));
+    CHECK(monitor.verifySimonGameSuccess(1000));
+    CHECK(board.received() == std::vector<int>{ 4 });
+}
+
+TEST_CASE(ReportsFailedChallenge) {
+    SimonSimulator board([](int) { return SimonSimulator::answer(false, 10); });
+    SerialMonitor monitor(board.path());
+    REQUIRE(monitor.connect());
+
+    REQUIRE(monitor.sendSimonGameLength(2));
+    CHECK(!monitor.verifySimonGameSuccess(1000));
+}
+
+TEST_CASE(ReadAvailableDoesNotBlock) {
+    SimonSimulator board([](int) { return SimonSimulator::silent(); });
+    SerialMonitor monitor(board.path());
+    REQUIRE(monitor.connect());
+
+    char buffer[16];
+    Result<size_t> bytesRead = monitor.readAvailable(buffer, sizeof(buffer));
+    REQUIRE(bytesRead.ok());
+    CHECK_EQ(bytesRead.value(), 0u);
+}
+
+TEST_CASE(ReadAvailableReportsHangUp) {
+    SimonSimulator board([](int) { return SimonSimulator::silent(); });
+    SerialMonitor monitor(board.path());
+    REQUIRE(monitor.connect());
+
+    // The hang-up reaches the port asynchronously
+    board.hangUp();
+    pollfd pfd = { monitor.nativeHandle(), POLLIN, 0 };
+    REQUIRE(poll(&pfd, 1, 1000) == 1);
+    char buffer[16];
+    Result<size_t> bytesRead = monitor.readAvailable(buffer, sizeof(buffer));
+    REQUIRE(!bytesRead);
+    CHECK_EQ(bytesRead.error().code, SIMON_ERROR_CONNECTION_FAILED);
+}
+
+TEST_CASE(ReceiveTimeoutIsAccurate) {
+    SimonSimulator board([](int) { return SimonSimulator::silent(); });
+    SerialMonitor monitor(board.path());
+    REQUIRE(monitor.connect());
+
+    // Never early; the median overshoot stays under 1 ms (single runs can
+    // be delayed by the scheduler, so the median is taken over many)
+    const int RUNS = 21;
+    for (int timeoutMs : { 1, 5, 20, 100 }) {
+        std::vector<double> overshoot;
+        for (int run = 0; run < RUNS; run++) {
+            Clock::time_point start = Clock::now();
+            CHECK(monitor.receiveData(timeoutMs).empty());
+            double elapsed = elapsedMs(start);
+            CHECK(elapsed >= timeoutMs);
+            overshoot.push_back(elapsed - timeoutMs);
+        }
+        std::sort(overshoot.begin(), overshoot.end());
+        double median = overshoot[RUNS / 2];
+        if (median >= 1.0) {
+            std::cerr << "timeout " << timeoutMs << " ms overshot by " << median << " ms" << std::endl;
+        }
+        CHECK(median < 1.0);
+    }
+}
+
+TEST_CASE(ReplyEndsTheWaitEarly) {
+    SimonSimulator board([](int) { return SimonSimulator::answer(true, 20); });
+    SerialMonitor monitor(board.path());
+    REQUIRE(monitor.connect());
+
+    REQUIRE(monitor.sendSimonGameLength(3));
+    Clock::time_point start = Clock::now();
+    CHECK(monitor.verifySimonGameSuccess(5000));
+    double elapsed = elapsedMs(start);
+    CHECK(elapsed >= 15.0);
+    CHECK(elapsed < 100.0);
+}
+
+TEST_CASE(ReadLinesHandsOutViewsIntoTheReceiveBuffer) {
+    SimonSimulator board([](int length) { return SimonSimulator::answer(length % 2 == 0); });
+    SerialMonitor monitor(board.path());
+    REQUIRE(monitor.connect());
+
+    for (int length : { 2, 3, 4 }) {
+        REQUIRE(monitor.sendSimonGameLength(length));
+    }
+
+    std::vector<std::string> replies;
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(1);
+    LineFramer::View lines[2];
+    while (replies.size() < 3) {
+        Result<size_t> count = monitor.readLines(lines, 2, deadline);
+        REQUIRE(count && count.value() > 0);
+        for (size_t i = 0; i < count.value(); i++) {
+            replies.emplace_back(lines[i].data, lines[i].length);
+        }
+        monitor.releaseLines();
+    }
+    CHECK(replies == std::vector<std::string>({ "True", "False", "True" }));
+    CHECK_EQ(monitor.readLines(lines, 2, Clock::now()).value(), 0u);
+}
+
+TEST_CASE(FramerPendingIsOnlyTheUnterminatedTail) {
+    LineFramer framer;
+    std::string burst;
+    for (int i = 0; i < 400; i++) {
+        burst += "True\r\n";
+    }
+    framer.append(burst.data(), burst.size());
+    CHECK_EQ(framer.pending(), 0u);
+    CHECK_EQ(framer.unread(), burst.size());
+
+    framer.append("Fal", 3);
+    CHECK_EQ(framer.pending(), 3u);
+
+    std::string line;
+    REQUIRE(framer.nextLine(line));
+    CHECK_EQ(framer.pending(), 3u);
+    while (framer.nextLine(line)) {
+    }
+    CHECK(line == "True");
+    CHECK_EQ(framer.pending(), 3u);
+    CHECK_EQ(framer.unread(), 3u);
+
+    framer.append("se\n", 3);
+    CHECK_EQ(framer.pending(), 0u);
+    REQUIRE(framer.nextLine(line));
+    CHECK(line == "False");
+}
+
+TEST_CASE(ReadFillsTheCallersBuffer) {
+    SimonSimulator board([](int) { return SimonSimulator::answer(true); });
+    SerialMonitor monitor(board.path());
+    REQUIRE(monitor.connect());
+
+    REQUIRE(monitor.sendSimonGameLength(1));
+    char buffer[2];
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(1);
+    std::string reply;
+    while (reply.find('\n') == std::string::npos) {
+        Result<size_t> bytesRead = monitor.read(buffer, sizeof(buffer), deadline);
+        REQUIRE(bytesRead && bytesRead.value() > 0);
+        reply.append(buffer, bytesRead.value());
+    }
+    CHECK(reply == "True\r\n");
+    CHECK_EQ(monitor.read(buffer, sizeof(buffer), Clock::now()).value(), 0u);
+}
+
+TEST_CASE(ConnectFailureCarriesTheOsError) {
+    SerialMonitor monitor("/nonexistent/simon-port");
+    Result<void> connected = monitor.connect();
+    REQUIRE(!connected);
+    CHECK_EQ(connected.error().code, SIMON_ERROR_CONNECTION_FAILED);
+    CHECK_EQ(connected.error().osError, ENOENT);
+}
+
+TEST_CASE(SilentBoardRecordsATimeout) {
+    SimonSimulator board([](int) { return SimonSimulator::silent(); });
+    SerialMonitor monitor(board.path());
+    REQUIRE(monitor.connect());
+
+    LastError::clear();
+    REQUIRE(monitor.sendSimonGameLength(2));
+    CHECK(!monitor.verifySimonGameSuccess(20));
+    CHECK_EQ(LastError::get().code, SIMON_ERROR_TIMEOUT);
+}
+
+TEST_MAIN()
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Minimal test runner so the tests build wherever the library does, without
+// a test framework. Each test file is its own executable registered with
+// CTest; a failed CHECK marks the test failed, a failed REQUIRE also ends it.
+namespace simon_test {
+    struct TestCase {
+        const char* name;
+        std::function<void()> body;
+    };
+
+    inline std::vector<TestCase>& registry() {
+        static std::vector<TestCase> tests;
+        return tests;
+    }
+
+    inline int& failures() {
+        static int count = 0;
+        return count;
+    }
+
+    struct Registrar {
+        Registrar(const char* name, std::function<void()> body) {
+            registry().push_back(TestCase{ name, std::move(body) });
+        }
+    };
+
+    inline void fail(const char* file, int line, const std::string& what) {
+        std::cerr << file << ":" << line << ": " << what << std::endl;
+        failures()++;
+    }
+
+    inline int runAll() {
+        int failedTests = 0;
+        for (const TestCase& test : registry()) {
+            int before = failures();
+            std::cout << "[ RUN  ] " << test.name << std::endl;
+            test.body();
+            bool passed = failures() == before;
+            std::cout << (passed ? "[  OK  ] " : "[ FAIL ] ") << test.name << std::endl;
+            if (!passed) {
+                failedTests++;
+            }
+        }
+        std::cout << registry().size() - failedTests << "/" << registry().size() << " tests passed" << std::endl;
+        return failedTests == 0 ? 0 : 1;
+    }
+}
+
+#define SIMON_TEST_CONCAT_(a, b) a##b
+#define SIMON_TEST_CONCAT(a, b) SIMON_TEST_CONCAT_(a, b)
+
+#define TEST_CASE(name)                                                             \
+    static void SIMON_TEST_CONCAT(test_, name)();                                   \
+    static simon_test::Registrar SIMON_TEST_CONCAT(registrar_, name)(#name,        \
+        SIMON_TEST_CONCAT(test_, name));                                            \
+    static void SIMON_TEST_CONCAT(test_, name)()
+
+#define CHECK(condition)                                                            \
+    do {                                                                            \
+        if (!(condition)) simon_test::fail(__FILE__, __LINE__, "CHECK(" #condition ") failed"); \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                  \
+    do {                                                                            \
+        auto actualValue_ = (actual);                                               \
+        auto expectedValue_ = (expected);                                           \
+        if (!(actualValue_ == expectedValue_)) {                                    \
+            simon_test::fail(__FILE__, __LINE__, "CHECK_EQ(" #actual ", " #expected ") failed: got " + \
+                std::to_string(actualValue_) + ", expected " + std::to_string(expectedValue_)); \
+        }                                                                           \
+    } while (0)
+
+#define REQUIRE(condition)                                                          \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            simon_test::fail(__FILE__, __LINE__, "REQUIRE(" #condition ") failed"); \
+            return;                                                                 \
+        }                                                                           \
+    } while (0)
+
+#define TEST_MAIN()                                                                 \
+    int main() { return simon_test::runAll(); }
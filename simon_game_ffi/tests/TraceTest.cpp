@@ -0,0 +1,99 @@
+#include "Trace.hpp"
+#include "SimonSimulator.hpp"
+#include "middleWhere.hpp"
+#include "simon_game.h"
+#include "TestSupport.hpp"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace {
+    size_t occurrences(const std::string& text, const std::string& part) {
+        size_t count = 0;
+        for (size_t pos = text.find(part); pos != std::string::npos; pos = text.find(part, pos + 1)) {
+            count++;
+        }
+        return count;
+    }
+}
+
+TEST_CASE(DisabledTracingRecordsNothing) {
+    Trace::setEnabled(false);
+    Trace::clear();
+    {
+        Trace::Span span("test", "invisible");
+    }
+    Trace::record("test", "invisible", 1, 2);
+    CHECK_EQ(occurrences(Trace::exportChromeJson(), "invisible"), 0u);
+}
+
+TEST_CASE(SpansCarryThreadNamesAndArgs) {
+    Trace::setEnabled(true);
+    Trace::clear();
+    std::thread([]() {
+        Trace::setThreadName("worker");
+        Trace::Span span("test", "work", 42);
+    }).join();
+    Trace::setEnabled(false);
+
+    std::string json = Trace::exportChromeJson();
+    CHECK(occurrences(json, "\"name\":\"thread_name\"") >= 1);
+    CHECK_EQ(occurrences(json, "\"args\":{\"name\":\"worker\"}"), 1u);
+    CHECK_EQ(occurrences(json, "\"cat\":\"test\",\"name\":\"work\""), 1u);
+    CHECK_EQ(occurrences(json, "\"args\":{\"value\":42}"), 1u);
+}
+
+TEST_CASE(FullRingKeepsNewestEvents) {
+    Trace::setEnabled(true);
+    Trace::clear();
+    for (size_t i = 0; i < Trace::EVENTS_PER_THREAD; i++) {
+        Trace::record("test", "old", 1000, 2000);
+    }
+    for (int i = 0; i < 10; i++) {
+        Trace::record("test", "new", 3000, 4000);
+    }
+    Trace::setEnabled(false);
+
+    std::string json = Trace::exportChromeJson();
+    CHECK_EQ(occurrences(json, "\"name\":\"new\""), 10u);
+    CHECK_EQ(occurrences(json, "\"name\":\"old\""), Trace::EVENTS_PER_THREAD - 10);
+    CHECK(occurrences(json, "\"ts\":3.000,\"dur\":1.000") == 10u);
+}
+
+TEST_CASE(CoversTheChallengeLifecycle) {
+    SimonSimulator board([](int) { return SimonSimulator::answer(true, 5); });
+    serial_monitor_t monitor = sm_create(board.path().c_str());
+    REQUIRE(sm_connect(monitor) == SIMON_SUCCESS);
+
+    std::atomic<bool> released(false);
+    KeyboardMiddleware middleware;
+    middleware.SetKeyInjector([&released](const std::vector<KeyEvent>&) { released = true; });
+    middleware.SetKeyBuffering(true);
+    middleware.RegisterHardwareCallbacks(
+        [monitor](int length) { sm_send_simon_game_length(monitor, length); },
+        [monitor]() { return sm_verify_simon_game_success(monitor, 1000) == 1; });
+    middleware.RegisterKey(0x53, 3);
+
+    REQUIRE(simon_trace_enable(1) == SIMON_SUCCESS);
+    REQUIRE(simon_trace_clear() == SIMON_SUCCESS);
+    CHECK(middleware.ProcessKeyEvent(KeyEvent{ 0x53, 0x1F, 100, false, false }));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!released && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(released);
+    middleware.Cleanup();
+    simon_trace_enable(0);
+
+    std::string json(simon_trace_dump(nullptr, 0), '\0');
+    simon_trace_dump(&json[0], json.size() + 1);
+    for (const char* span : { "\"hook\"", "\"queue wait\"", "\"send callback\"", "\"serial write\"",
+                              "\"device wait\"", "\"parse\"", "\"receive callback\"" }) {
+        CHECK_EQ(occurrences(json, std::string("\"name\":") + span), 1u);
+    }
+    CHECK_EQ(occurrences(json, "\"args\":{\"name\":\"challenge\"}"), 1u);
+    sm_destroy(monitor);
+}
+
+TEST_MAIN()
@@ -0,0 +1,125 @@
+#include "TriggerMatcher.hpp"
+#include "TestSupport.hpp"
+
+namespace {
+    const uint16_t KEY_A = 0x41;
+    const uint16_t KEY_S = 0x53;
+    const uint16_t KEY_D = 0x44;
+
+    using Step = TriggerMatcher::Step;
+
+    TriggerMatcher::Trigger trigger(std::vector<Step> steps, uint32_t windowMs = 0, int target = 4) {
+        return TriggerMatcher::Trigger{ std::move(steps), windowMs, target };
+    }
+
+    // A press and release, returning what the press completed
+    int tap(const TriggerMatcher& matcher, TriggerMatcher::Cursor& cursor, uint16_t key, uint32_t time) {
+        int fired = matcher.advance(cursor, key, true, time);
+        matcher.advance(cursor, key, false, time + 1);
+        return fired;
+    }
+
+    void press(const TriggerMatcher& matcher, TriggerMatcher::Cursor& cursor, uint16_t key, uint32_t time) {
+        matcher.advance(cursor, key, true, time);
+    }
+
+    void release(const TriggerMatcher& matcher, TriggerMatcher::Cursor& cursor, uint16_t key, uint32_t time) {
+        matcher.advance(cursor, key, false, time);
+    }
+}
+
+TEST_CASE(ChordNeedsExactlyItsModifiers) {
+    TriggerMatcher matcher({ trigger({ { KEY_S, TriggerMatcher::MOD_CTRL | TriggerMatcher::MOD_SHIFT } }) });
+    TriggerMatcher::Cursor cursor;
+
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 0), -1);
+
+    press(matcher, cursor, KeyCodes::LCONTROL, 10);
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 20), -1);
+    press(matcher, cursor, KeyCodes::RSHIFT, 30);
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 40), 0);
+
+    // An extra modifier is a different chord
+    press(matcher, cursor, KeyCodes::LMENU, 50);
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 60), -1);
+}
+
+TEST_CASE(AnyModifiersMatchWhateverIsHeld) {
+    TriggerMatcher matcher({ trigger({ { KEY_S, TriggerMatcher::MOD_ANY } }),
+                             trigger({ { KEY_D, TriggerMatcher::MOD_NONE } }) });
+    TriggerMatcher::Cursor cursor;
+
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 0), 0);
+    CHECK_EQ(tap(matcher, cursor, KEY_D, 10), 1);
+
+    press(matcher, cursor, KeyCodes::LCONTROL, 20);
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 30), 0);
+    CHECK_EQ(tap(matcher, cursor, KEY_D, 40), -1);
+    release(matcher, cursor, KeyCodes::LCONTROL, 50);
+    CHECK_EQ(tap(matcher, cursor, KEY_D, 60), 1);
+}
+
+TEST_CASE(SequenceFiresOnlyInsideItsWindow) {
+    TriggerMatcher matcher({ trigger({ { KEY_A, TriggerMatcher::MOD_NONE }, { KEY_S, TriggerMatcher::MOD_NONE } }, 500) });
+    TriggerMatcher::Cursor cursor;
+
+    CHECK_EQ(tap(matcher, cursor, KEY_A, 1000), -1);
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 1400), 0);
+
+    CHECK_EQ(tap(matcher, cursor, KEY_A, 2000), -1);
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 4000), -1);
+
+    // A key outside the sequence starts it over
+    CHECK_EQ(tap(matcher, cursor, KEY_A, 5000), -1);
+    CHECK_EQ(tap(matcher, cursor, KEY_D, 5100), -1);
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 5200), -1);
+}
+
+TEST_CASE(ExpiredSequenceFallsBackToTheKeyItEndsIn) {
+    TriggerMatcher matcher({ trigger({ { KEY_S, TriggerMatcher::MOD_NONE } }, 0, 3),
+                             trigger({ { KEY_A, TriggerMatcher::MOD_NONE }, { KEY_S, TriggerMatcher::MOD_NONE } }, 500, 6) });
+    TriggerMatcher::Cursor cursor;
+
+    // Inside the window the longer trigger wins
+    CHECK_EQ(tap(matcher, cursor, KEY_A, 1000), -1);
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 1200), 1);
+
+    // Past it, S on its own is still gated
+    CHECK_EQ(tap(matcher, cursor, KEY_A, 2000), -1);
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 4000), 0);
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 4100), 0);
+}
+
+TEST_CASE(ModifiersInsideASequenceDoNotBreakIt) {
+    TriggerMatcher matcher({ trigger({ { KEY_A, TriggerMatcher::MOD_NONE },
+                                       { KEY_S, TriggerMatcher::MOD_CTRL },
+                                       { KEY_D, TriggerMatcher::MOD_NONE } }, 1000) });
+    TriggerMatcher::Cursor cursor;
+
+    CHECK_EQ(tap(matcher, cursor, KEY_A, 0), -1);
+    press(matcher, cursor, KeyCodes::RCONTROL, 100);
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 200), -1);
+    release(matcher, cursor, KeyCodes::RCONTROL, 300);
+    CHECK_EQ(tap(matcher, cursor, KEY_D, 400), 0);
+
+    // The middle step needs Ctrl
+    CHECK_EQ(tap(matcher, cursor, KEY_A, 1000), -1);
+    CHECK_EQ(tap(matcher, cursor, KEY_S, 1100), -1);
+    CHECK_EQ(tap(matcher, cursor, KEY_D, 1200), -1);
+}
+
+TEST_CASE(SwappedMatcherStartsTheCursorOver) {
+    std::vector<TriggerMatcher::Trigger> triggers = {
+        trigger({ { KEY_A, TriggerMatcher::MOD_NONE }, { KEY_S, TriggerMatcher::MOD_NONE } })
+    };
+    TriggerMatcher first(triggers);
+    TriggerMatcher second(triggers);
+    TriggerMatcher::Cursor cursor;
+
+    CHECK_EQ(tap(first, cursor, KEY_A, 0), -1);
+    CHECK_EQ(tap(second, cursor, KEY_S, 100), -1);
+    CHECK_EQ(tap(second, cursor, KEY_A, 200), -1);
+    CHECK_EQ(tap(second, cursor, KEY_S, 300), 0);
+}
+
+TEST_MAIN()
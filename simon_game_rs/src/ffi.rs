@@ -8,6 +8,12 @@ pub type serial_monitor_t = *mut std::ffi::c_void;
 
 pub type keyboard_middleware_t = *mut std::ffi::c_void;
 
+pub type device_pool_t = *mut std::ffi::c_void;
+
+pub type simon_subscription_t = *mut std::ffi::c_void;
+
+pub type screen_lock_t = *mut std::ffi::c_void;
+
 #[repr(C)]
 #[derive(Debug, Copy, Clone, PartialEq, Eq)]
 pub enum simon_error_t {
@@ -21,10 +27,120 @@ pub enum simon_error_t {
     SIMON_ERROR_UNKNOWN = -99,
 }
 
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct simon_error_info_t {
+    pub code: simon_error_t,
+    pub os_error: c_int,
+    pub message: *const c_char,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct simon_key_step {
+    pub key_code: c_int,
+    pub modifiers: c_int,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct simon_key_config {
+    pub key_code: c_int,
+    pub modifiers: c_int,
+    pub target_count: c_int,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct simon_sequence_config {
+    pub steps: *const simon_key_step,
+    pub step_count: c_int,
+    pub window_ms: c_int,
+    pub target_count: c_int,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct simon_config {
+    pub keys: *const simon_key_config,
+    pub key_count: usize,
+    pub sequences: *const simon_sequence_config,
+    pub sequence_count: usize,
+    pub processes: *const *const c_char,
+    pub process_count: usize,
+    pub window_classes: *const *const c_char,
+    pub window_class_count: usize,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct simon_lockout_policy {
+    pub key_threshold: c_int,
+    pub device_threshold: c_int,
+    pub window_ms: c_int,
+    pub decay_ms: c_int,
+    pub steps_ms: *const c_int,
+    pub step_count: usize,
+}
+
+pub const SIMON_MOD_NONE: c_int = 0;
+pub const SIMON_MOD_CTRL: c_int = 1;
+pub const SIMON_MOD_SHIFT: c_int = 2;
+pub const SIMON_MOD_ALT: c_int = 4;
+pub const SIMON_MOD_WIN: c_int = 8;
+pub const SIMON_MOD_ANY: c_int = 0xFF;
+
+pub const SIMON_EVENT_CHALLENGE_STARTED: i32 = 1;
+pub const SIMON_EVENT_CHALLENGE_FINISHED: i32 = 2;
+pub const SIMON_EVENT_DEVICE_CONNECTED: i32 = 3;
+pub const SIMON_EVENT_DEVICE_DISCONNECTED: i32 = 4;
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct simon_event_t {
+    pub sequence: u64,
+    pub time_ns: u64,
+    pub type_: i32,
+    pub key: i32,
+    pub value: i32,
+    pub detail: i32,
+    pub text: [c_char; 32],
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default)]
+pub struct simon_status_t {
+    pub challenges_succeeded: i64,
+    pub challenges_failed: i64,
+    pub challenges_in_flight: i64,
+    pub devices_connected: i64,
+    pub last_challenge_length: i64,
+}
+
 pub type simon_send_callback_t = Option<unsafe extern "C" fn(counter: c_int)>;
 pub type simon_receive_callback_t = Option<unsafe extern "C" fn() -> c_int>;
+pub type simon_send_callback_ex_t = Option<unsafe extern "C" fn(user_data: *mut std::ffi::c_void, counter: c_int)>;
+pub type simon_receive_callback_ex_t = Option<unsafe extern "C" fn(user_data: *mut std::ffi::c_void) -> c_int>;
+pub type simon_challenge_callback_t = Option<unsafe extern "C" fn(user_data: *mut std::ffi::c_void, success: c_int)>;
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default)]
+pub struct simon_pollfd_t {
+    pub fd: c_int,
+    pub events: i16,
+}
+
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct simon_line_t {
+    pub data: *const c_char,
+    pub length: usize,
+}
 
 extern "C" {
+    pub fn simon_last_error() -> simon_error_info_t;
+    pub fn simon_clear_error();
+
     pub fn sm_create(port_name: *const c_char) -> serial_monitor_t;
     pub fn sm_destroy(handle: serial_monitor_t);
     pub fn sm_connect(handle: serial_monitor_t) -> simon_error_t;
@@ -33,15 +149,92 @@ extern "C" {
     pub fn sm_send_simon_game_length(handle: serial_monitor_t, length: c_int) -> simon_error_t;
     pub fn sm_verify_simon_game_success(handle: serial_monitor_t, timeout_ms: c_int) -> c_int;
     pub fn sm_is_connected(handle: serial_monitor_t) -> c_int;
+    pub fn sm_read(handle: serial_monitor_t, buffer: *mut std::ffi::c_void, capacity: usize, deadline_ns: u64) -> c_int;
+    pub fn sm_read_lines(handle: serial_monitor_t, lines: *mut simon_line_t, max_lines: usize, deadline_ns: u64) -> c_int;
+    pub fn sm_release_lines(handle: serial_monitor_t) -> simon_error_t;
+
+    pub fn dp_create(challenge_timeout_ms: c_int) -> device_pool_t;
+    pub fn dp_destroy(handle: device_pool_t);
+    pub fn dp_add_device(handle: device_pool_t, port_name: *const c_char) -> simon_error_t;
+    pub fn dp_start(handle: device_pool_t) -> simon_error_t;
+    pub fn dp_stop(handle: device_pool_t) -> simon_error_t;
+    pub fn dp_run_challenge(handle: device_pool_t, length: c_int) -> c_int;
+    pub fn dp_healthy_count(handle: device_pool_t) -> c_int;
+    pub fn dp_submit_challenge(
+        handle: device_pool_t,
+        length: c_int,
+        callback: simon_challenge_callback_t,
+        user_data: *mut std::ffi::c_void,
+    ) -> simon_error_t;
 
     pub fn km_create() -> keyboard_middleware_t;
     pub fn km_destroy(handle: keyboard_middleware_t);
     pub fn km_initialize(handle: keyboard_middleware_t) -> simon_error_t;
     pub fn km_register_key(handle: keyboard_middleware_t, key_code: c_int, target_count: c_int) -> simon_error_t;
+    pub fn km_register_chord(handle: keyboard_middleware_t, key_code: c_int, modifiers: c_int, target_count: c_int) -> simon_error_t;
+    pub fn km_register_sequence(
+        handle: keyboard_middleware_t,
+        steps: *const simon_key_step,
+        step_count: c_int,
+        window_ms: c_int,
+        target_count: c_int,
+    ) -> simon_error_t;
+    pub fn km_register_keys(handle: keyboard_middleware_t, keys: *const simon_key_config, count: usize) -> simon_error_t;
+    pub fn km_apply_config(handle: keyboard_middleware_t, config: *const simon_config) -> simon_error_t;
     pub fn km_cleanup(handle: keyboard_middleware_t) -> simon_error_t;
+    pub fn km_add_process_scope(handle: keyboard_middleware_t, exe_name: *const c_char) -> simon_error_t;
+    pub fn km_add_window_class_scope(handle: keyboard_middleware_t, window_class: *const c_char) -> simon_error_t;
+    pub fn km_clear_scopes(handle: keyboard_middleware_t) -> simon_error_t;
+    pub fn km_set_key_buffering(handle: keyboard_middleware_t, enabled: c_int, capacity: c_int) -> simon_error_t;
+    pub fn km_set_verification_cache(handle: keyboard_middleware_t, ttl_ms: c_int, per_key: c_int, idle_ms: c_int) -> simon_error_t;
+    pub fn km_invalidate_verification(handle: keyboard_middleware_t) -> simon_error_t;
+    pub fn km_set_adaptive_length(handle: keyboard_middleware_t, min_length: c_int, max_length: c_int, window: c_int) -> simon_error_t;
+    pub fn km_set_speculation(handle: keyboard_middleware_t, ttl_ms: c_int) -> simon_error_t;
+    pub fn km_set_lockout(
+        handle: keyboard_middleware_t,
+        policy: *const simon_lockout_policy,
+        state_path: *const c_char,
+    ) -> simon_error_t;
     pub fn km_register_callbacks(
         handle: keyboard_middleware_t,
         send_callback: simon_send_callback_t,
         receive_callback: simon_receive_callback_t,
     ) -> simon_error_t;
+    pub fn km_register_callbacks_ex(
+        handle: keyboard_middleware_t,
+        send_callback: simon_send_callback_ex_t,
+        receive_callback: simon_receive_callback_ex_t,
+        user_data: *mut std::ffi::c_void,
+    ) -> simon_error_t;
+    pub fn km_use_device_pool(handle: keyboard_middleware_t, pool: device_pool_t) -> simon_error_t;
+
+    pub fn lock_begin(seconds: c_int, release_on_success: keyboard_middleware_t) -> screen_lock_t;
+    pub fn lock_end(handle: screen_lock_t) -> simon_error_t;
+    pub fn lock_wait_until(handle: screen_lock_t, deadline_ns: u64) -> c_int;
+    pub fn lock_destroy(handle: screen_lock_t);
+
+    pub fn simon_metrics_dump(buffer: *mut c_char, size: usize) -> usize;
+    pub fn simon_metrics_serve(address: *const c_char) -> simon_error_t;
+    pub fn simon_metrics_stop_serving() -> simon_error_t;
+
+    pub fn simon_trace_enable(enabled: c_int) -> simon_error_t;
+    pub fn simon_trace_clear() -> simon_error_t;
+    pub fn simon_trace_dump(buffer: *mut c_char, size: usize) -> usize;
+    pub fn simon_trace_save(path: *const c_char) -> simon_error_t;
+
+    pub fn simon_events_subscribe() -> simon_subscription_t;
+    pub fn simon_events_unsubscribe(handle: simon_subscription_t);
+    pub fn simon_events_next(handle: simon_subscription_t, event: *mut simon_event_t) -> c_int;
+    pub fn simon_events_wait(handle: simon_subscription_t, timeout_ms: c_int) -> c_int;
+    pub fn simon_events_dropped(handle: simon_subscription_t) -> u64;
+    pub fn simon_events_status(status: *mut simon_status_t) -> simon_error_t;
+    pub fn simon_events_region(size: *mut usize) -> *const std::ffi::c_void;
+    pub fn simon_events_fd() -> c_int;
+
+    pub fn simon_reactor_enable() -> simon_error_t;
+    pub fn simon_get_poll_fds(fds: *mut simon_pollfd_t, max: c_int) -> c_int;
+    pub fn simon_get_wake_handle() -> *mut std::ffi::c_void;
+    pub fn simon_next_timeout_ms() -> c_int;
+    pub fn simon_clock_ns() -> u64;
+    pub fn simon_process_events(deadline_ns: u64) -> simon_error_t;
 }
\ No newline at end of file
@@ -1,7 +1,7 @@
 mod ffi;
 mod error;
 
-use std::ffi::CString;
+use std::ffi::{CStr, CString};
 use std::ptr;
 use std::sync::{Arc, Mutex};
 
@@ -220,4 +220,93 @@ impl Drop for KeyboardMiddleware {
 }
 
 unsafe impl Send for KeyboardMiddleware {}
-unsafe impl Sync for KeyboardMiddleware {}
\ No newline at end of file
+unsafe impl Sync for KeyboardMiddleware {}
+
+/// One event read from the library's shared-memory event ring
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct SimonEvent {
+    pub sequence: u64,
+    pub time_ns: u64,
+    /// One of the `SIMON_EVENT_*` constants
+    pub kind: i32,
+    pub key: i32,
+    pub value: i32,
+    pub detail: i32,
+    pub text: String,
+}
+
+/// A reader on the event ring. Each subscription sees the events published
+/// after it was created, at its own pace; reading never blocks the library.
+pub struct EventSubscription {
+    handle: ffi::simon_subscription_t,
+}
+
+impl EventSubscription {
+    pub fn new() -> Result<Self, SimonError> {
+        unsafe {
+            let handle = ffi::simon_events_subscribe();
+            if handle.is_null() {
+                return Err(SimonError::Unknown);
+            }
+            
+            Ok(EventSubscription { handle })
+        }
+    }
+    
+    /// The next event, if one is waiting
+    pub fn next_event(&self) -> Option<SimonEvent> {
+        unsafe {
+            let mut event: ffi::simon_event_t = std::mem::zeroed();
+            if ffi::simon_events_next(self.handle, &mut event) == 0 {
+                return None;
+            }
+            
+            Some(SimonEvent {
+                sequence: event.sequence,
+                time_ns: event.time_ns,
+                kind: event.type_,
+                key: event.key,
+                value: event.value,
+                detail: event.detail,
+                text: CStr::from_ptr(event.text.as_ptr()).to_string_lossy().into_owned(),
+            })
+        }
+    }
+    
+    /// Blocks until an event is waiting or the timeout passes
+    pub fn wait(&self, timeout_ms: i32) -> bool {
+        unsafe {
+            ffi::simon_events_wait(self.handle, timeout_ms) != 0
+        }
+    }
+    
+    /// Events that were overwritten before this subscription read them
+    pub fn dropped(&self) -> u64 {
+        unsafe {
+            ffi::simon_events_dropped(self.handle)
+        }
+    }
+    
+    pub fn status() -> Result<ffi::simon_status_t, SimonError> {
+        let mut status = ffi::simon_status_t::default();
+        unsafe {
+            match ffi::simon_events_status(&mut status) {
+                ffi::simon_error_t::SIMON_SUCCESS => Ok(status),
+                err => Err(SimonError::from(err)),
+            }
+        }
+    }
+}
+
+impl Drop for EventSubscription {
+    fn drop(&mut self) {
+        unsafe {
+            if !self.handle.is_null() {
+                ffi::simon_events_unsubscribe(self.handle);
+                self.handle = ptr::null_mut();
+            }
+        }
+    }
+}
+
+unsafe impl Send for EventSubscription {}
\ No newline at end of file
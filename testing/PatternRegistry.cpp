@@ -0,0 +1,57 @@
+// PatternRegistry.cpp
+#include "PatternRegistry.hpp"
+#include "Logger.hpp"
+#include <charconv>
+
+bool PatternRegistry::add(WORD key, const std::vector<int>& pattern) {
+    if (key >= KEYS || pattern.empty() || pattern.size() > UINT16_MAX) {
+        LOG_ERROR("Invalid pattern for key: " + std::to_string(key));
+        return false;
+    }
+    for (int step : pattern) {
+        if (step < MIN_STEP || step > MAX_STEP) {
+            LOG_ERROR("Invalid step " + std::to_string(step) + " in pattern for key: " + std::to_string(key));
+            return false;
+        }
+    }
+
+    // A replaced pattern's bytes stay in the arena; registration happens
+    // once at startup, so they are not worth reclaiming
+    Entry entry;
+    entry.offset = static_cast<uint32_t>(arena.size());
+    entry.steps = static_cast<uint16_t>(pattern.size());
+    encode(pattern, arena);
+    entry.wireLength = static_cast<uint16_t>(arena.size() - entry.offset);
+    entries[key] = entry;
+
+    LOG_INFO("Registered pattern for key: " + std::to_string(key) + " with " +
+             std::to_string(pattern.size()) + " steps");
+    return true;
+}
+
+size_t PatternRegistry::length(WORD key) const {
+    return key < KEYS ? entries[key].steps : 0;
+}
+
+std::string_view PatternRegistry::wire(WORD key) const {
+    if (key >= KEYS || entries[key].wireLength == 0) {
+        return std::string_view();
+    }
+    const Entry& entry = entries[key];
+    return std::string_view(arena.data() + entry.offset, entry.wireLength);
+}
+
+void PatternRegistry::encode(const std::vector<int>& pattern, std::vector<char>& out) {
+    static const char PREFIX[] = "PATTERN:";
+    out.insert(out.end(), PREFIX, PREFIX + sizeof(PREFIX) - 1);
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char digits[12];
+        std::to_chars_result end = std::to_chars(digits, digits + sizeof(digits), pattern[i]);
+        out.insert(out.end(), digits, end.ptr);
+        if (i < pattern.size() - 1) {
+            out.push_back(',');
+        }
+    }
+    out.push_back('\r');
+    out.push_back('\n');
+}
@@ -0,0 +1,42 @@
+// PatternRegistry.hpp
+#pragma once
+#include <windows.h>
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Simon patterns per trigger key, looked up by vkCode. Every pattern and
+// its wire form ("PATTERN:1,2,3\r\n") are encoded once at registration into
+// one shared arena, so sending a pattern is an indexed load and a write.
+//
+// Register all patterns before the triggers that use them: adding one may
+// move the arena and invalidate views handed out earlier.
+class PatternRegistry {
+public:
+    static constexpr size_t KEYS = 256;     // vkCodes are one byte
+    static constexpr int MIN_STEP = 1;      // the board's four buttons
+    static constexpr int MAX_STEP = 4;
+
+    // Replaces any pattern already registered for `key`. Returns false on
+    // an out-of-range key, an empty pattern or a step that is not a button.
+    bool add(WORD key, const std::vector<int>& pattern);
+
+    // Number of steps, or 0 if the key has no pattern
+    size_t length(WORD key) const;
+    // The encoded command, empty if the key has no pattern
+    std::string_view wire(WORD key) const;
+
+private:
+    struct Entry {
+        uint32_t offset = 0;        // into arena
+        uint16_t steps = 0;
+        uint16_t wireLength = 0;
+    };
+
+    // Appends the same command SerialCommunication::sendPattern sends
+    static void encode(const std::vector<int>& pattern, std::vector<char>& out);
+
+    std::array<Entry, KEYS> entries;
+    std::vector<char> arena;
+};
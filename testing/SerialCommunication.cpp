@@ -107,6 +107,25 @@ bool SerialCommunication::sendCommand(const std::string& cmd) {
     return true;
 }
 
+bool SerialCommunication::sendRaw(const char* data, size_t length) {
+    if (!connected) {
+        LOG_ERROR("Cannot send command - not connected to serial port");
+        return false;
+    }
+    
+    DWORD bytesWritten = 0;
+    if (!WriteFile(serialHandle, data, static_cast<DWORD>(length), &bytesWritten, NULL)) {
+        LOG_ERROR("Failed to write to serial port, error: " + std::to_string(GetLastError()));
+        return false;
+    }
+    
+    if (bytesWritten != length) {
+        LOG_WARNING("Incomplete write to serial port");
+    }
+    
+    return true;
+}
+
 bool SerialCommunication::sendPattern(const std::vector<int>& pattern) {
     std::stringstream ss;
     ss << "PATTERN:";
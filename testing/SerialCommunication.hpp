@@ -20,6 +20,8 @@ public:
     bool isConnected() const { return connected; }
     
     bool sendCommand(const std::string& cmd);
+    // Writes an already encoded command as is, e.g. from PatternRegistry
+    bool sendRaw(const char* data, size_t length);
     bool sendPattern(const std::vector<int>& pattern);
     std::string receiveResponse(int timeout = 2000);
     bool verifyPatternCompleted();
@@ -39,7 +39,7 @@ if ! command -v x86_64-w64-mingw32-g++ &> /dev/null; then
     exit 1
 fi
 
-if [ ! -f main.cpp ] || [ ! -f middleWhere.cpp ] || [ ! -f Logger.cpp ]; then
+if [ ! -f main.cpp ] || [ ! -f middleWhere.cpp ] || [ ! -f Logger.cpp ] || [ ! -f SerialCommunication.cpp ] || [ ! -f PatternRegistry.cpp ]; then
     log_error "Required source files not found!"
     exit 1
 fi
@@ -78,7 +78,7 @@ mkdir -p "$OUTPUT_DIR" 2>/dev/null || {
 }
 
 log_main "Compiling project..."
-x86_64-w64-mingw32-g++ main.cpp middleWhere.cpp Logger.cpp -o "$OUTPUT_DIR/main.exe" \
+x86_64-w64-mingw32-g++ main.cpp middleWhere.cpp Logger.cpp SerialCommunication.cpp PatternRegistry.cpp -o "$OUTPUT_DIR/main.exe" \
     -I. \
     -luser32 -lgdi32 \
     -static-libgcc -static-libstdc++ \
@@ -1,16 +1,13 @@
-#include <Windows.h>    // For Windows-specific APIs (BlockInput, console functions)
-#include <iostream>     // For console output (cout, endl)
-#include <thread>       // For thread sleep functionality
-#include <chrono>       // For time units (seconds)
+#include <Windows.h>    // For the admin privilege check
+#include <stdint.h>     // For UINT64_MAX
+#include "simon_game.h" // The screen lock itself lives in simon_game
 #include "screenLock.h" // Include our library header
 
 // Implementation of the screen lock function to be exported
-// This function will:
-// 1. Create a console window to show status
-// 2. Block all keyboard and mouse input
-// 3. Show a countdown for the specified number of seconds
-// 4. Restore normal input
-// 5. Return 1 for success, 0 for failure
+// Kept for existing callers that expect a blocking call:
+// 1. Start a lock in simon_game (it runs on a timer thread of its own)
+// 2. Wait for it to expire
+// 3. Return 1 for success, 0 for failure
 extern "C" __declspec(dllexport) int lock_screen_for_seconds(int seconds) {
     // Validate input - ensure we don't lock for too long or with negative values
     if (seconds <= 0) {
@@ -21,45 +18,15 @@ extern "C" __declspec(dllexport) int lock_screen_for_seconds(int seconds) {
         seconds = 3600;
     }
     
-    // Create console window to show status
-    // AllocConsole creates a new console for the current process
-    AllocConsole();
-    FILE* stream;
-    // Redirect stdout to the console
-    freopen_s(&stream, "CONOUT$", "w", stdout);
-    
-    std::cout << "=== SCREEN LOCK ACTIVATED ===" << std::endl;
-    std::cout << "All input will be blocked for " << seconds << " seconds" << std::endl;
-    
-    // Block input (keyboard and mouse)
-    // BlockInput(TRUE) prevents keyboard and mouse input from reaching applications
+    // Block input (keyboard and mouse) until the lock expires
     // NOTE: Requires admin privileges to work
-    if (!BlockInput(TRUE)) {
-        std::cout << "Failed to lock input. Error code: " << GetLastError() << std::endl;
-        BlockInput(FALSE); // Make sure input is restored in case of failure
-        FreeConsole();
+    screen_lock_t lock = lock_begin(seconds, NULL);
+    if (!lock) {
         return 0;
     }
     
-    // Countdown timer
-    // Loop for the specified number of seconds, updating the console each second
-    for (int i = seconds; i > 0; i--) {
-        std::cout << "Seconds remaining: " << i << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-    }
-    
-    // Unblock input - restore normal functionality
-    BlockInput(FALSE);
-    
-    std::cout << "=== SCREEN LOCK DEACTIVATED ===" << std::endl;
-    std::cout << "Input control returned" << std::endl;
-    std::cout << "Press any key to close this window..." << std::endl;
-    
-    // Wait for a keypress before closing
-    std::cin.get();
-    
-    // Clean up console when done
-    FreeConsole();
+    lock_wait_until(lock, UINT64_MAX);
+    lock_destroy(lock);
     return 1;
 }
 
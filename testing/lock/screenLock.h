@@ -10,8 +10,9 @@ extern "C" {  // Use C linkage when compiled with C++
 
 // Function that locks the screen for a specified number of seconds
 // @param seconds - Number of seconds to lock the screen
-// This function blocks all keyboard and mouse input using Windows BlockInput API
-// Displays a countdown in a console window
+// Blocks until the lock ends. This is a thin wrapper over lock_begin and
+// lock_wait_until from simon_game (simon_game.h), which lock without
+// blocking and can be ended early; new code should call those directly.
 // Returns 1 for success, 0 for failure
 // NOTE: Requires administrator privileges to work properly
 __declspec(dllexport) int lock_screen_for_seconds(int seconds);
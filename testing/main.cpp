@@ -1,43 +1,33 @@
 #include "middleWhere.hpp"
 #include "Logger.hpp"
 #include "SerialCommunication.hpp"
+#include "PatternRegistry.hpp"
 #include <iostream>
 #include <chrono>
 #include <thread>
-#include <map>
 
 // Global serial communication object
 SerialCommunication serialComm;
 
-// Define the key to pattern mapping
-std::map<WORD, std::vector<int>> keyPatterns = {
-    {'W', {1, 2, 3, 2, 1}},      // Example pattern for W key
-    {'A', {3, 1, 3, 1}},         // Example pattern for A key
-    {'S', {2, 4, 2, 1, 3, 4}},   // Example pattern for S key
-    {'D', {4, 3, 2, 1}},         // Example pattern for D key
-    {VK_SPACE, {1, 2, 3, 4, 4, 3, 2, 1}} // Example pattern for SPACE key
-};
+// Patterns per trigger key, encoded for the wire once at startup
+PatternRegistry patterns;
 
-void sendToHardware(int counter) {
-    LOG_INFO("Sending pattern to hardware with complexity: " + std::to_string(counter));
-    
-    WORD lastPressedKey = 0;
-    
-    // Find which key was last pressed (this is a simple approach - you might need to enhance this)
-    for (const auto& keyConfig : keyPatterns) {
-        if (keyConfig.second.size() == counter) {
-            lastPressedKey = keyConfig.first;
-            break;
-        }
-    }
-    
-    // If key pattern found, send it to the hardware
-    if (lastPressedKey != 0 && keyPatterns.find(lastPressedKey) != keyPatterns.end()) {
-        LOG_INFO("Sending pattern for key: " + std::to_string(lastPressedKey));
-        serialComm.sendPattern(keyPatterns[lastPressedKey]);
-    } else {
-        LOG_WARNING("No pattern defined for the pressed key with counter: " + std::to_string(counter));
+void registerPatterns() {
+    patterns.add('W', {1, 2, 3, 2, 1});      // Example pattern for W key
+    patterns.add('A', {3, 1, 3, 1});         // Example pattern for A key
+    patterns.add('S', {2, 4, 2, 1, 3, 4});   // Example pattern for S key
+    patterns.add('D', {4, 3, 2, 1});         // Example pattern for D key
+    patterns.add(VK_SPACE, {1, 2, 3, 4, 4, 3, 2, 1}); // Example pattern for SPACE key
+}
+
+// Runs for every trigger, so it only looks the key up and writes
+void sendToHardware(WORD key, [[maybe_unused]] int counter) {
+    std::string_view wire = patterns.wire(key);
+    if (wire.empty()) {
+        LOG_WARNING("No pattern defined for key: " + std::to_string(key));
+        return;
     }
+    serialComm.sendRaw(wire.data(), wire.size());
 }
 
 bool receiveFromHardware() {
@@ -113,12 +103,12 @@ int WINAPI WinMain([[maybe_unused]] HINSTANCE hInstance, [[maybe_unused]] HINSTA
         return 1;
     }
 
-    // Register keys with their pattern complexity
-    KeyboardMiddleware::RegisterKey('W', keyPatterns['W'].size()); 
-    KeyboardMiddleware::RegisterKey('A', keyPatterns['A'].size()); 
-    KeyboardMiddleware::RegisterKey('S', keyPatterns['S'].size());  
-    KeyboardMiddleware::RegisterKey('D', keyPatterns['D'].size()); 
-    KeyboardMiddleware::RegisterKey(VK_SPACE, keyPatterns[VK_SPACE].size());
+    // Register keys with their pattern complexity, before the first key
+    // event can reach sendToHardware
+    registerPatterns();
+    for (WORD key : {WORD('W'), WORD('A'), WORD('S'), WORD('D'), WORD(VK_SPACE)}) {
+        KeyboardMiddleware::RegisterKey(key, static_cast<int>(patterns.length(key)));
+    }
 
     // Register our hardware callbacks
     KeyboardMiddleware::RegisterHardwareCallbacks(sendToHardware, receiveFromHardware);
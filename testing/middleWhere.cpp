@@ -7,7 +7,7 @@ std::vector<KeyboardMiddleware::KeyConfig> KeyboardMiddleware::keyConfigs;
 bool KeyboardMiddleware::shouldExit = false;
 std::atomic<int> KeyboardMiddleware::targetCounter(0);
 std::mutex KeyboardMiddleware::counterMutex;
-std::function<void(int)> KeyboardMiddleware::sendToHardwareCallback;
+std::function<void(WORD, int)> KeyboardMiddleware::sendToHardwareCallback;
 std::function<bool()> KeyboardMiddleware::receiveFromHardwareCallback;
 
 void KeyboardMiddleware::LogMessage(const std::string& message) {
@@ -24,7 +24,7 @@ void KeyboardMiddleware::SendResponseToApplication(WORD key) {
                  " with target counter: " + std::to_string(keyConfig->targetCounter));
         
         if (sendToHardwareCallback) {
-            sendToHardwareCallback(keyConfig->targetCounter);
+            sendToHardwareCallback(key, keyConfig->targetCounter);
         }
         
         if (receiveFromHardwareCallback && receiveFromHardwareCallback()) {
@@ -98,7 +98,7 @@ void KeyboardMiddleware::SetTargetCounter(int counter) {
 }
 
 void KeyboardMiddleware::RegisterHardwareCallbacks(
-    std::function<void(int)> sendCallback,
+    std::function<void(WORD, int)> sendCallback,
     std::function<bool()> receiveCallback
 ) {
     sendToHardwareCallback = sendCallback;
@@ -22,7 +22,7 @@ private:
     static HHOOK keyboardHook;
     static std::vector<KeyConfig> keyConfigs;
     static bool shouldExit;
-    static std::function<void(int)> sendToHardwareCallback;
+    static std::function<void(WORD, int)> sendToHardwareCallback;
     static std::function<bool()> receiveFromHardwareCallback;
     static std::atomic<int> targetCounter;
     static std::mutex counterMutex;
@@ -35,8 +35,9 @@ public:
     static bool Initialize();
     static void RegisterKey(WORD key, int targetCount);
     static void SetTargetCounter(int counter);
+    // sendCallback receives the trigger key and its target count
     static void RegisterHardwareCallbacks(
-        std::function<void(int)> sendCallback,
+        std::function<void(WORD, int)> sendCallback,
         std::function<bool()> receiveCallback
     );
     static void Cleanup();